@@ -0,0 +1,120 @@
+#version 310 es
+
+// Like fragment_shader.glsl, but only for the active pixels of a list. Their state is updated in place,
+// and the ones that are still active afterwards are appended to the next list (so no lanes wait for pixels that are done).
+
+// One invocation per listed pixel (the dispatch program sizes the dispatch in groups of 64, wrapped into rows):
+layout(local_size_x = 64) in;
+
+// Input:
+// The active pixels (x | (y << 16)):
+layout(std430, binding = 0) readonly buffer active_pixel_block
+{
+    highp uint active_pixels[];
+};
+
+// The dispatch (and the length of the list it covers):
+layout(std430, binding = 2) readonly buffer dispatch_block
+{
+    highp uvec3 group_count;
+    highp uint active_pixel_count;
+};
+
+// Output:
+// The pixels that are still active and how many there are:
+layout(std430, binding = 1) writeonly buffer next_active_pixel_block
+{
+    highp uint next_active_pixels[];
+};
+
+layout(binding = 0) uniform atomic_uint next_active_pixel_count;
+
+// The state (iteration count and flags, z as float bits and the periodicity checkpoint):
+layout(binding = 0, r32ui) uniform highp uimage2D iteration_state;
+layout(binding = 1, rgba32ui) writeonly uniform highp uimage2D orbit_state;
+layout(binding = 2, rgba32ui) writeonly uniform highp uimage2D checkpoint_state;
+
+// Uniforms:
+// Half frame (Gaussian):
+uniform highp vec2 gaussian_half_frame;
+
+// Position (Gaussian):
+uniform highp vec2 gaussian_position;
+
+// Iterations:
+uniform highp uint iterations;
+
+// The maximum number of iterations for this pass:
+uniform highp uint iteration_slice;
+
+// The same textures as orbit_state and checkpoint_state (ES only lets us read and write single channel images):
+uniform highp usampler2D previous_orbit_state;
+uniform highp usampler2D previous_checkpoint_state;
+
+// Orbits that come back this close to the checkpoint are periodic (so the pixel is inside):
+uniform highp float periodicity_epsilon;
+
+// Layout of the iteration state:
+const highp uint ESCAPED_FLAG = 0x80000000u;
+const highp uint INTERIOR_FLAG = 0x40000000u;
+const highp uint ITERATION_MASK = 0x3FFFFFFFu;
+
+void main()
+{
+    // The groups come in rows (see the dispatch program), and the last one may reach past the list:
+    highp uint index = (((gl_WorkGroupID.y * gl_NumWorkGroups.x) + gl_WorkGroupID.x) * gl_WorkGroupSize.x) + gl_LocalInvocationID.x;
+
+    if (index >= active_pixel_count)
+        return;
+
+    highp uint packed_pixel = active_pixels[index];
+    highp ivec2 pixel = ivec2(packed_pixel & 0xFFFFu, packed_pixel >> 16);
+
+    // Restore the state (anything else may have finished the pixel since it was listed, e.g. a lowered limit):
+    highp uint state = imageLoad(iteration_state, pixel).x;
+    highp uint i = state & ITERATION_MASK;
+
+    if (((state & (ESCAPED_FLAG | INTERIOR_FLAG)) != 0u) || (i >= iterations))
+        return;
+
+    highp vec2 z = uintBitsToFloat(texelFetch(previous_orbit_state, pixel, 0).xy);
+    highp vec2 checkpoint = uintBitsToFloat(texelFetch(previous_checkpoint_state, pixel, 0).xy);
+
+    // Calculate c (at the pixel center, like the vertex shader):
+    highp vec2 c = gaussian_position + ((((2.0 * (vec2(pixel) + 0.5)) / vec2(imageSize(iteration_state))) - 1.0) * gaussian_half_frame);
+
+    // Iterate:
+    highp uint end = i + min(iterations - i, iteration_slice);
+
+    for (; i < end; i++)
+    {
+        // Condition:
+        if (dot(z, z) > 4.0)
+        {
+            state |= ESCAPED_FLAG;
+            break;
+        }
+
+        // Step:
+        z = vec2((z.x * z.x) - (z.y * z.y), 2.0 * z.x * z.y) + c;
+
+        // Periodicity (Brent): did we come back to the checkpoint (which moves on at every power of two)?
+        if (all(lessThanEqual(abs(z - checkpoint), vec2(periodicity_epsilon))))
+        {
+            state |= INTERIOR_FLAG;
+            break;
+        }
+
+        if ((i & (i + 1u)) == 0u)
+            checkpoint = z;
+    }
+
+    // Save the state:
+    imageStore(iteration_state, pixel, uvec4((state & ~ITERATION_MASK) | i, 0u, 0u, 0u));
+    imageStore(orbit_state, pixel, uvec4(floatBitsToUint(z), 0u, 0u));
+    imageStore(checkpoint_state, pixel, uvec4(floatBitsToUint(checkpoint), 0u, 0u));
+
+    // Still active?
+    if (((state & (ESCAPED_FLAG | INTERIOR_FLAG)) == 0u) && (i < iterations))
+        next_active_pixels[atomicCounterIncrement(next_active_pixel_count)] = packed_pixel;
+}
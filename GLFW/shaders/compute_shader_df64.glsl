@@ -0,0 +1,200 @@
+#version 310 es
+
+// Like fragment_shader_df64.glsl, but only for the active pixels of a list. Their state is updated in place,
+// and the ones that are still active afterwards are appended to the next list (so no lanes wait for pixels that are done).
+
+// One invocation per listed pixel (the dispatch program sizes the dispatch in groups of 64, wrapped into rows):
+layout(local_size_x = 64) in;
+
+// Input:
+// The active pixels (x | (y << 16)):
+layout(std430, binding = 0) readonly buffer active_pixel_block
+{
+    highp uint active_pixels[];
+};
+
+// The dispatch (and the length of the list it covers):
+layout(std430, binding = 2) readonly buffer dispatch_block
+{
+    highp uvec3 group_count;
+    highp uint active_pixel_count;
+};
+
+// Output:
+// The pixels that are still active and how many there are:
+layout(std430, binding = 1) writeonly buffer next_active_pixel_block
+{
+    highp uint next_active_pixels[];
+};
+
+layout(binding = 0) uniform atomic_uint next_active_pixel_count;
+
+// The state (iteration count and flags, z as float bits: x.hi, x.lo, y.hi, y.lo and the periodicity checkpoint):
+layout(binding = 0, r32ui) uniform highp uimage2D iteration_state;
+layout(binding = 1, rgba32ui) writeonly uniform highp uimage2D orbit_state;
+layout(binding = 2, rgba32ui) writeonly uniform highp uimage2D checkpoint_state;
+
+// Uniforms:
+// Half frame (Gaussian):
+uniform highp vec2 gaussian_half_frame;
+
+// Iterations:
+uniform highp uint iterations;
+
+// The maximum number of iterations for this pass:
+uniform highp uint iteration_slice;
+
+// The same textures as orbit_state and checkpoint_state (ES only lets us read and write single channel images):
+uniform highp usampler2D previous_orbit_state;
+uniform highp usampler2D previous_checkpoint_state;
+
+// Orbits that come back this close to the checkpoint are periodic (so the pixel is inside):
+uniform highp float periodicity_epsilon;
+
+// Layout of the iteration state:
+const highp uint ESCAPED_FLAG = 0x80000000u;
+const highp uint INTERIOR_FLAG = 0x40000000u;
+const highp uint ITERATION_MASK = 0x3FFFFFFFu;
+
+// Position (Gaussian), split into high and low float parts:
+uniform highp vec2 gaussian_position;
+uniform highp vec2 gaussian_position_lo;
+
+// Always 1.0 (we can't use `precise` in ES 3.1).
+// Multiplying with it hides the error-free transformations below from the compiler, which would otherwise fold them (e.g. (a + b) - a = b):
+uniform highp float df64_one;
+
+// Double-float arithmetic: a value is the unevaluated sum (hi, lo) of two floats (~48 bits of mantissa).
+highp vec2 df_two_sum(highp float a, highp float b)
+{
+    highp float sum = (a + b) * df64_one;
+    highp float b_virtual = sum - a;
+
+    return vec2(sum, (a - (sum - b_virtual)) + (b - b_virtual));
+}
+
+highp vec2 df_quick_two_sum(highp float a, highp float b)
+{
+    highp float sum = (a + b) * df64_one;
+
+    return vec2(sum, b - (sum - a));
+}
+
+highp vec2 df_split(highp float a)
+{
+    // 2^12 + 1:
+    highp float a_split = (4097.0 * a) * df64_one;
+    highp float a_hi = a_split - (a_split - a);
+
+    return vec2(a_hi, a - a_hi);
+}
+
+highp vec2 df_two_prod(highp float a, highp float b)
+{
+    highp float product = a * b;
+    highp vec2 a_split = df_split(a);
+    highp vec2 b_split = df_split(b);
+
+    highp float error = (((a_split.x * b_split.x) - product) + (a_split.x * b_split.y) + (a_split.y * b_split.x)) + (a_split.y * b_split.y);
+
+    return vec2(product, error);
+}
+
+highp vec2 df_add(highp vec2 a, highp vec2 b)
+{
+    highp vec2 sum = df_two_sum(a.x, b.x);
+    highp vec2 error = df_two_sum(a.y, b.y);
+
+    sum.y += error.x;
+    sum = df_quick_two_sum(sum.x, sum.y);
+    sum.y += error.y;
+
+    return df_quick_two_sum(sum.x, sum.y);
+}
+
+highp vec2 df_mul(highp vec2 a, highp vec2 b)
+{
+    highp vec2 product = df_two_prod(a.x, b.x);
+    product.y += (a.x * b.y) + (a.y * b.x);
+
+    return df_quick_two_sum(product.x, product.y);
+}
+
+void main()
+{
+    // The groups come in rows (see the dispatch program), and the last one may reach past the list:
+    highp uint index = (((gl_WorkGroupID.y * gl_NumWorkGroups.x) + gl_WorkGroupID.x) * gl_WorkGroupSize.x) + gl_LocalInvocationID.x;
+
+    if (index >= active_pixel_count)
+        return;
+
+    highp uint packed_pixel = active_pixels[index];
+    highp ivec2 pixel = ivec2(packed_pixel & 0xFFFFu, packed_pixel >> 16);
+
+    // Restore the state (anything else may have finished the pixel since it was listed, e.g. a lowered limit):
+    highp uint state = imageLoad(iteration_state, pixel).x;
+    highp uint i = state & ITERATION_MASK;
+
+    if (((state & (ESCAPED_FLAG | INTERIOR_FLAG)) != 0u) || (i >= iterations))
+        return;
+
+    highp vec4 z = uintBitsToFloat(texelFetch(previous_orbit_state, pixel, 0));
+    highp vec2 z_x = z.xy;
+    highp vec2 z_y = z.zw;
+
+    highp vec4 checkpoint = uintBitsToFloat(texelFetch(previous_checkpoint_state, pixel, 0));
+    highp vec2 checkpoint_x = checkpoint.xy;
+    highp vec2 checkpoint_y = checkpoint.zw;
+
+    // Calculate c = position + offset (at the pixel center, like the vertex shader):
+    highp vec2 offset = (((2.0 * (vec2(pixel) + 0.5)) / vec2(imageSize(iteration_state))) - 1.0) * gaussian_half_frame;
+
+    highp vec2 c_x = df_add(vec2(gaussian_position.x, gaussian_position_lo.x), vec2(offset.x, 0.0));
+    highp vec2 c_y = df_add(vec2(gaussian_position.y, gaussian_position_lo.y), vec2(offset.y, 0.0));
+
+    // Iterate:
+    highp uint end = i + min(iterations - i, iteration_slice);
+
+    for (; i < end; i++)
+    {
+        // Condition (the high parts are precise enough here):
+        if (((z_x.x * z_x.x) + (z_y.x * z_y.x)) > 4.0)
+        {
+            state |= ESCAPED_FLAG;
+            break;
+        }
+
+        // Step:
+        highp vec2 z_x_squared = df_mul(z_x, z_x);
+        highp vec2 z_y_squared = df_mul(z_y, z_y);
+        highp vec2 z_x_times_y = df_mul(z_x, z_y);
+
+        z_x = df_add(df_add(z_x_squared, -z_y_squared), c_x);
+        z_y = df_add(2.0 * z_x_times_y, c_y);
+
+        // Periodicity (Brent): did we come back to the checkpoint (which moves on at every power of two)?
+        highp float delta_x = df_add(z_x, -checkpoint_x).x;
+        highp float delta_y = df_add(z_y, -checkpoint_y).x;
+
+        if (max(abs(delta_x), abs(delta_y)) <= periodicity_epsilon)
+        {
+            state |= INTERIOR_FLAG;
+            break;
+        }
+
+        if ((i & (i + 1u)) == 0u)
+        {
+            checkpoint_x = z_x;
+            checkpoint_y = z_y;
+        }
+    }
+
+    // Save the state:
+    imageStore(iteration_state, pixel, uvec4((state & ~ITERATION_MASK) | i, 0u, 0u, 0u));
+    imageStore(orbit_state, pixel, uvec4(floatBitsToUint(z_x), floatBitsToUint(z_y)));
+    imageStore(checkpoint_state, pixel, uvec4(floatBitsToUint(checkpoint_x), floatBitsToUint(checkpoint_y)));
+
+    // Still active?
+    if (((state & (ESCAPED_FLAG | INTERIOR_FLAG)) == 0u) && (i < iterations))
+        next_active_pixels[atomicCounterIncrement(next_active_pixel_count)] = packed_pixel;
+}
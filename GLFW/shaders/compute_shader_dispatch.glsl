@@ -0,0 +1,33 @@
+#version 310 es
+
+// Sizes the next dispatch by the length of the list the last pass has written (so it never has to be read back).
+
+layout(local_size_x = 1) in;
+
+// Input:
+// How many pixels the last pass has listed:
+layout(binding = 0) uniform atomic_uint next_active_pixel_count;
+
+// Uniforms:
+// How many groups a dispatch may have along x (ES 3.1 only guarantees 65535):
+uniform highp uint max_group_count;
+
+// Output:
+// The dispatch (groups of 64 invocations, one per listed pixel, in rows of at most max_group_count) and the length of the list it covers:
+layout(std430, binding = 2) writeonly buffer dispatch_block
+{
+    highp uvec3 group_count;
+    highp uint active_pixel_count;
+};
+
+void main()
+{
+    highp uint count = atomicCounter(next_active_pixel_count);
+    highp uint groups = (count + 63u) / 64u;
+
+    // Large lists wrap into more rows (x and y have 16 bits, so a list has less than 2^26 groups, which takes ~1025 rows at most):
+    highp uint columns = min(groups, max_group_count);
+
+    group_count = uvec3(columns, (columns == 0u) ? 1u : ((groups + columns - 1u) / columns), 1u);
+    active_pixel_count = count;
+}
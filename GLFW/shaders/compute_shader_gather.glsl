@@ -0,0 +1,42 @@
+#version 310 es
+
+// Lists the active pixels of the whole escape state (after the fragment kernels have run, which don't keep the list).
+
+// One invocation per pixel:
+layout(local_size_x = 8, local_size_y = 8) in;
+
+// Output:
+// The active pixels (x | (y << 16)) and how many there are:
+layout(std430, binding = 1) writeonly buffer next_active_pixel_block
+{
+    highp uint next_active_pixels[];
+};
+
+layout(binding = 0) uniform atomic_uint next_active_pixel_count;
+
+// Uniforms:
+// Iterations:
+uniform highp uint iterations;
+
+// The escape state (iteration count and flags):
+uniform highp usampler2D iteration_state;
+
+// Layout of the iteration state:
+const highp uint ESCAPED_FLAG = 0x80000000u;
+const highp uint INTERIOR_FLAG = 0x40000000u;
+const highp uint ITERATION_MASK = 0x3FFFFFFFu;
+
+void main()
+{
+    highp ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
+
+    // The last groups may reach past the state:
+    if (any(greaterThanEqual(pixel, textureSize(iteration_state, 0))))
+        return;
+
+    highp uint state = texelFetch(iteration_state, pixel, 0).x;
+
+    // Like the probe pass (pending pixels have both flags, so they are skipped as well):
+    if (((state & (ESCAPED_FLAG | INTERIOR_FLAG)) == 0u) && ((state & ITERATION_MASK) < iterations))
+        next_active_pixels[atomicCounterIncrement(next_active_pixel_count)] = uint(pixel.x) | (uint(pixel.y) << 16);
+}
@@ -4,34 +4,123 @@
 in highp vec2 c;
 
 // Output:
-layout(location = 0) out lowp vec4 sample_renderbuffer;
+// Iteration count and flags:
+layout(location = 0) out highp uint iteration_state;
+
+// The orbit (z as float bits):
+layout(location = 1) out highp uvec4 orbit_state;
+
+// The periodicity checkpoint (an earlier z of the orbit as float bits):
+layout(location = 2) out highp uvec4 checkpoint_state;
 
 // Uniforms:
 // Iterations:
-uniform mediump uint iterations;
+uniform highp uint iterations;
+
+// The maximum number of iterations for this pass:
+uniform highp uint iteration_slice;
+
+// Start from z = c instead of continuing the previous state?
+uniform bool reset;
+
+// The previous state:
+uniform highp usampler2D previous_iteration_state;
+uniform highp usampler2D previous_orbit_state;
+uniform highp usampler2D previous_checkpoint_state;
+
+// Where to find the previous state of a pixel (panning shifts it by whole pixels, pixels shifted in from outside start over):
+uniform highp ivec2 pixel_shift;
+
+// Orbits that come back this close to the checkpoint are periodic (so the pixel is inside):
+uniform highp float periodicity_epsilon;
+
+// Layout of the iteration state:
+const highp uint ESCAPED_FLAG = 0x80000000u;
+const highp uint INTERIOR_FLAG = 0x40000000u;
+const highp uint ITERATION_MASK = 0x3FFFFFFFu;
+const highp uint PENDING_STATE = 0xFFFFFFFFu;
 
-// Hue texture:
-uniform mediump sampler2D hue_texture;
+// Is c inside the main cardioid or the period-2 bulb (then it never escapes)?
+// The margin keeps the test conservative despite rounding (pixels right at the boundary just iterate):
+const highp float INTERIOR_MARGIN = 1e-5;
+
+bool is_in_main_bulbs(highp vec2 c)
+{
+    // Main cardioid:
+    highp float x = c.x - 0.25;
+    highp float q = (x * x) + (c.y * c.y);
+
+    if ((q * (q + x)) < ((0.25 * c.y * c.y) - INTERIOR_MARGIN))
+        return true;
+
+    // Period-2 bulb (the disk of radius 1/4 around -1):
+    x = c.x + 1.0;
+
+    return ((x * x) + (c.y * c.y)) < (0.0625 - INTERIOR_MARGIN);
+}
 
 void main()
 {
-    // Iterate:
+    // Restore the state:
+    highp ivec2 pixel = ivec2(gl_FragCoord.xy);
+    highp uint state = 0u;
     highp vec2 z = c;
-    mediump uint i;
+    highp vec2 checkpoint = c;
+
+    highp ivec2 source = pixel + pixel_shift;
+    bool is_fresh = reset || any(lessThan(source, ivec2(0))) || any(greaterThanEqual(source, textureSize(previous_iteration_state, 0)));
 
-    for (i = 0u; i < iterations; i++)
+    // Pending pixels are iterated elsewhere (the CPU in hybrid mode), they keep their mark even when we start over:
+    if (reset && (texelFetch(previous_iteration_state, pixel, 0).x == PENDING_STATE))
     {
-        // Condition:
-        if (dot(z, z) > 4.0)
-            break;
-        
-        // Step:
-        z = vec2((z.x * z.x) - (z.y * z.y), 2.0 * z.x * z.y) + c;
+        source = pixel;
+        is_fresh = false;
     }
-    
-    // Get a relative, smooth hue value:
-    mediump float hue = float(i) / float(iterations);
-    
-    // Do a texture lookup:
-    sample_renderbuffer = texture(hue_texture, vec2(hue, 0.5));
+
+    if (!is_fresh)
+    {
+        state = texelFetch(previous_iteration_state, source, 0).x;
+        z = uintBitsToFloat(texelFetch(previous_orbit_state, source, 0).xy);
+        checkpoint = uintBitsToFloat(texelFetch(previous_checkpoint_state, source, 0).xy);
+    }
+    else if (is_in_main_bulbs(c))
+    {
+        state = INTERIOR_FLAG;
+    }
+
+    highp uint i = state & ITERATION_MASK;
+
+    // Iterate (pixels that are done just pass through):
+    if (((state & (ESCAPED_FLAG | INTERIOR_FLAG)) == 0u) && (i < iterations))
+    {
+        highp uint end = i + min(iterations - i, iteration_slice);
+
+        for (; i < end; i++)
+        {
+            // Condition:
+            if (dot(z, z) > 4.0)
+            {
+                state |= ESCAPED_FLAG;
+                break;
+            }
+
+            // Step:
+            z = vec2((z.x * z.x) - (z.y * z.y), 2.0 * z.x * z.y) + c;
+
+            // Periodicity (Brent): did we come back to the checkpoint (which moves on at every power of two)?
+            if (all(lessThanEqual(abs(z - checkpoint), vec2(periodicity_epsilon))))
+            {
+                state |= INTERIOR_FLAG;
+                break;
+            }
+
+            if ((i & (i + 1u)) == 0u)
+                checkpoint = z;
+        }
+    }
+
+    // Save the state:
+    iteration_state = (state & ~ITERATION_MASK) | i;
+    orbit_state = uvec4(floatBitsToUint(z), 0u, 0u);
+    checkpoint_state = uvec4(floatBitsToUint(checkpoint), 0u, 0u);
 }
@@ -0,0 +1,42 @@
+#version 300 es
+
+// Output:
+layout(location = 0) out lowp vec4 sample_renderbuffer;
+
+// Uniforms:
+// Iterations:
+uniform highp uint iterations;
+
+// Hue texture:
+uniform mediump sampler2D hue_texture;
+
+// The escape state (iteration count and flags):
+uniform highp usampler2D iteration_state;
+
+// How often the palette repeats over the iteration range:
+uniform highp float hue_density;
+
+// Shifts the palette (for cycling):
+uniform highp float hue_offset;
+
+// Layout of the iteration state:
+const highp uint ESCAPED_FLAG = 0x80000000u;
+const highp uint ITERATION_MASK = 0x3FFFFFFFu;
+
+void main()
+{
+    highp uint state = texelFetch(iteration_state, ivec2(gl_FragCoord.xy), 0).x;
+
+    // Get a relative, smooth hue value.
+    // Pixels that did not escape (yet) or only escaped beyond the current limit get the (fixed) end of the palette:
+    highp float hue = 1.0;
+    highp uint i = state & ITERATION_MASK;
+
+    if (((state & ESCAPED_FLAG) != 0u) && (i < iterations))
+    {
+        hue = fract((hue_density * (float(i) / float(iterations))) + hue_offset);
+    }
+
+    // Do a texture lookup:
+    sample_renderbuffer = texture(hue_texture, vec2(hue, 0.5));
+}
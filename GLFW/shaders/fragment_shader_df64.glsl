@@ -0,0 +1,215 @@
+#version 300 es
+
+// Input:
+// The offset of c to the Gaussian position:
+in highp vec2 offset;
+
+// Output:
+// Iteration count and flags:
+layout(location = 0) out highp uint iteration_state;
+
+// The orbit (z as float bits: x.hi, x.lo, y.hi, y.lo):
+layout(location = 1) out highp uvec4 orbit_state;
+
+// The periodicity checkpoint (an earlier z of the orbit as float bits):
+layout(location = 2) out highp uvec4 checkpoint_state;
+
+// Uniforms:
+// Iterations:
+uniform highp uint iterations;
+
+// The maximum number of iterations for this pass:
+uniform highp uint iteration_slice;
+
+// Start from z = c instead of continuing the previous state?
+uniform bool reset;
+
+// The previous state:
+uniform highp usampler2D previous_iteration_state;
+uniform highp usampler2D previous_orbit_state;
+uniform highp usampler2D previous_checkpoint_state;
+
+// Where to find the previous state of a pixel (panning shifts it by whole pixels, pixels shifted in from outside start over):
+uniform highp ivec2 pixel_shift;
+
+// Orbits that come back this close to the checkpoint are periodic (so the pixel is inside):
+uniform highp float periodicity_epsilon;
+
+// Layout of the iteration state:
+const highp uint ESCAPED_FLAG = 0x80000000u;
+const highp uint INTERIOR_FLAG = 0x40000000u;
+const highp uint ITERATION_MASK = 0x3FFFFFFFu;
+const highp uint PENDING_STATE = 0xFFFFFFFFu;
+
+// Position (Gaussian), split into high and low float parts:
+uniform highp vec2 gaussian_position;
+uniform highp vec2 gaussian_position_lo;
+
+// Always 1.0 (we can't use `precise` in ES 3.0).
+// Multiplying with it hides the error-free transformations below from the compiler, which would otherwise fold them (e.g. (a + b) - a = b):
+uniform highp float df64_one;
+
+// Double-float arithmetic: a value is the unevaluated sum (hi, lo) of two floats (~48 bits of mantissa).
+highp vec2 df_two_sum(highp float a, highp float b)
+{
+    highp float sum = (a + b) * df64_one;
+    highp float b_virtual = sum - a;
+
+    return vec2(sum, (a - (sum - b_virtual)) + (b - b_virtual));
+}
+
+highp vec2 df_quick_two_sum(highp float a, highp float b)
+{
+    highp float sum = (a + b) * df64_one;
+
+    return vec2(sum, b - (sum - a));
+}
+
+highp vec2 df_split(highp float a)
+{
+    // 2^12 + 1:
+    highp float a_split = (4097.0 * a) * df64_one;
+    highp float a_hi = a_split - (a_split - a);
+
+    return vec2(a_hi, a - a_hi);
+}
+
+highp vec2 df_two_prod(highp float a, highp float b)
+{
+    highp float product = a * b;
+    highp vec2 a_split = df_split(a);
+    highp vec2 b_split = df_split(b);
+
+    highp float error = (((a_split.x * b_split.x) - product) + (a_split.x * b_split.y) + (a_split.y * b_split.x)) + (a_split.y * b_split.y);
+
+    return vec2(product, error);
+}
+
+highp vec2 df_add(highp vec2 a, highp vec2 b)
+{
+    highp vec2 sum = df_two_sum(a.x, b.x);
+    highp vec2 error = df_two_sum(a.y, b.y);
+
+    sum.y += error.x;
+    sum = df_quick_two_sum(sum.x, sum.y);
+    sum.y += error.y;
+
+    return df_quick_two_sum(sum.x, sum.y);
+}
+
+highp vec2 df_mul(highp vec2 a, highp vec2 b)
+{
+    highp vec2 product = df_two_prod(a.x, b.x);
+    product.y += (a.x * b.y) + (a.y * b.x);
+
+    return df_quick_two_sum(product.x, product.y);
+}
+
+// Is c inside the main cardioid or the period-2 bulb (then it never escapes)?
+// The margin keeps the test conservative despite rounding (pixels right at the boundary just iterate):
+const highp float INTERIOR_MARGIN = 1e-5;
+
+bool is_in_main_bulbs(highp vec2 c)
+{
+    // Main cardioid:
+    highp float x = c.x - 0.25;
+    highp float q = (x * x) + (c.y * c.y);
+
+    if ((q * (q + x)) < ((0.25 * c.y * c.y) - INTERIOR_MARGIN))
+        return true;
+
+    // Period-2 bulb (the disk of radius 1/4 around -1):
+    x = c.x + 1.0;
+
+    return ((x * x) + (c.y * c.y)) < (0.0625 - INTERIOR_MARGIN);
+}
+
+void main()
+{
+    // Calculate c = position + offset:
+    highp vec2 c_x = df_add(vec2(gaussian_position.x, gaussian_position_lo.x), vec2(offset.x, 0.0));
+    highp vec2 c_y = df_add(vec2(gaussian_position.y, gaussian_position_lo.y), vec2(offset.y, 0.0));
+
+    // Restore the state:
+    highp ivec2 pixel = ivec2(gl_FragCoord.xy);
+    highp uint state = 0u;
+    highp vec2 z_x = c_x;
+    highp vec2 z_y = c_y;
+    highp vec2 checkpoint_x = c_x;
+    highp vec2 checkpoint_y = c_y;
+
+    highp ivec2 source = pixel + pixel_shift;
+    bool is_fresh = reset || any(lessThan(source, ivec2(0))) || any(greaterThanEqual(source, textureSize(previous_iteration_state, 0)));
+
+    // Pending pixels are iterated elsewhere (the CPU in hybrid mode), they keep their mark even when we start over:
+    if (reset && (texelFetch(previous_iteration_state, pixel, 0).x == PENDING_STATE))
+    {
+        source = pixel;
+        is_fresh = false;
+    }
+
+    if (!is_fresh)
+    {
+        state = texelFetch(previous_iteration_state, source, 0).x;
+
+        highp vec4 z = uintBitsToFloat(texelFetch(previous_orbit_state, source, 0));
+        z_x = z.xy;
+        z_y = z.zw;
+
+        highp vec4 checkpoint = uintBitsToFloat(texelFetch(previous_checkpoint_state, source, 0));
+        checkpoint_x = checkpoint.xy;
+        checkpoint_y = checkpoint.zw;
+    }
+    else if (is_in_main_bulbs(vec2(c_x.x, c_y.x)))
+    {
+        // (The high parts are precise enough for this.)
+        state = INTERIOR_FLAG;
+    }
+
+    highp uint i = state & ITERATION_MASK;
+
+    // Iterate (pixels that are done just pass through):
+    if (((state & (ESCAPED_FLAG | INTERIOR_FLAG)) == 0u) && (i < iterations))
+    {
+        highp uint end = i + min(iterations - i, iteration_slice);
+
+        for (; i < end; i++)
+        {
+            // Condition (the high parts are precise enough here):
+            if (((z_x.x * z_x.x) + (z_y.x * z_y.x)) > 4.0)
+            {
+                state |= ESCAPED_FLAG;
+                break;
+            }
+
+            // Step:
+            highp vec2 z_x_squared = df_mul(z_x, z_x);
+            highp vec2 z_y_squared = df_mul(z_y, z_y);
+            highp vec2 z_x_times_y = df_mul(z_x, z_y);
+
+            z_x = df_add(df_add(z_x_squared, -z_y_squared), c_x);
+            z_y = df_add(2.0 * z_x_times_y, c_y);
+
+            // Periodicity (Brent): did we come back to the checkpoint (which moves on at every power of two)?
+            highp float delta_x = df_add(z_x, -checkpoint_x).x;
+            highp float delta_y = df_add(z_y, -checkpoint_y).x;
+
+            if (max(abs(delta_x), abs(delta_y)) <= periodicity_epsilon)
+            {
+                state |= INTERIOR_FLAG;
+                break;
+            }
+
+            if ((i & (i + 1u)) == 0u)
+            {
+                checkpoint_x = z_x;
+                checkpoint_y = z_y;
+            }
+        }
+    }
+
+    // Save the state:
+    iteration_state = (state & ~ITERATION_MASK) | i;
+    orbit_state = uvec4(floatBitsToUint(z_x), floatBitsToUint(z_y));
+    checkpoint_state = uvec4(floatBitsToUint(checkpoint_x), floatBitsToUint(checkpoint_y));
+}
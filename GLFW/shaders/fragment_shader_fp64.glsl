@@ -0,0 +1,146 @@
+#version 400 core
+
+// Native double precision (desktop GL 4), like fragment_shader.glsl but with c and z in double.
+
+// Output:
+// Iteration count and flags:
+layout(location = 0) out uint iteration_state;
+
+// The orbit (z as double bits: x.lo, x.hi, y.lo, y.hi):
+layout(location = 1) out uvec4 orbit_state;
+
+// The periodicity checkpoint (an earlier z of the orbit as double bits):
+layout(location = 2) out uvec4 checkpoint_state;
+
+// Uniforms:
+// Half frame (Gaussian):
+uniform dvec2 gaussian_half_frame;
+
+// Position (Gaussian):
+uniform dvec2 gaussian_position;
+
+// Iterations:
+uniform uint iterations;
+
+// The maximum number of iterations for this pass:
+uniform uint iteration_slice;
+
+// Start from z = c instead of continuing the previous state?
+uniform bool reset;
+
+// The previous state:
+uniform usampler2D previous_iteration_state;
+uniform usampler2D previous_orbit_state;
+uniform usampler2D previous_checkpoint_state;
+
+// Where to find the previous state of a pixel (panning shifts it by whole pixels, pixels shifted in from outside start over):
+uniform ivec2 pixel_shift;
+
+// Orbits that come back this close to the checkpoint are periodic (so the pixel is inside):
+uniform float periodicity_epsilon;
+
+// Layout of the iteration state:
+const uint ESCAPED_FLAG = 0x80000000u;
+const uint INTERIOR_FLAG = 0x40000000u;
+const uint ITERATION_MASK = 0x3FFFFFFFu;
+const uint PENDING_STATE = 0xFFFFFFFFu;
+
+// Is c inside the main cardioid or the period-2 bulb (then it never escapes)?
+// The margin keeps the test conservative despite rounding (pixels right at the boundary just iterate):
+const double INTERIOR_MARGIN = 1e-5;
+
+bool is_in_main_bulbs(dvec2 c)
+{
+    // Main cardioid:
+    double x = c.x - 0.25;
+    double q = (x * x) + (c.y * c.y);
+
+    if ((q * (q + x)) < ((0.25 * c.y * c.y) - INTERIOR_MARGIN))
+        return true;
+
+    // Period-2 bulb (the disk of radius 1/4 around -1):
+    x = c.x + 1.0;
+
+    return ((x * x) + (c.y * c.y)) < (0.0625 - INTERIOR_MARGIN);
+}
+
+dvec2 unpack_double2(uvec4 bits)
+{
+    return dvec2(packDouble2x32(bits.xy), packDouble2x32(bits.zw));
+}
+
+uvec4 pack_double2(dvec2 value)
+{
+    return uvec4(unpackDouble2x32(value.x), unpackDouble2x32(value.y));
+}
+
+void main()
+{
+    // Calculate c (a varying would only be float, so we go from the pixel center, which is exact):
+    ivec2 size = textureSize(previous_iteration_state, 0);
+    dvec2 c = gaussian_position + (((2.0 * dvec2(gl_FragCoord.xy) / dvec2(size)) - 1.0) * gaussian_half_frame);
+
+    // Restore the state:
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    uint state = 0u;
+    dvec2 z = c;
+    dvec2 checkpoint = c;
+
+    ivec2 source = pixel + pixel_shift;
+    bool is_fresh = reset || any(lessThan(source, ivec2(0))) || any(greaterThanEqual(source, size));
+
+    // Pending pixels are iterated elsewhere (the CPU in hybrid mode), they keep their mark even when we start over:
+    if (reset && (texelFetch(previous_iteration_state, pixel, 0).x == PENDING_STATE))
+    {
+        source = pixel;
+        is_fresh = false;
+    }
+
+    if (!is_fresh)
+    {
+        state = texelFetch(previous_iteration_state, source, 0).x;
+        z = unpack_double2(texelFetch(previous_orbit_state, source, 0));
+        checkpoint = unpack_double2(texelFetch(previous_checkpoint_state, source, 0));
+    }
+    else if (is_in_main_bulbs(c))
+    {
+        state = INTERIOR_FLAG;
+    }
+
+    uint i = state & ITERATION_MASK;
+
+    // Iterate (pixels that are done just pass through):
+    if (((state & (ESCAPED_FLAG | INTERIOR_FLAG)) == 0u) && (i < iterations))
+    {
+        uint end = i + min(iterations - i, iteration_slice);
+
+        for (; i < end; i++)
+        {
+            // Condition:
+            if (dot(z, z) > 4.0)
+            {
+                state |= ESCAPED_FLAG;
+                break;
+            }
+
+            // Step (precise keeps the compiler from fusing it into FMAs, so we round like the CPU renderer):
+            precise dvec2 next_z = dvec2((z.x * z.x) - (z.y * z.y), 2.0 * z.x * z.y) + c;
+            z = next_z;
+
+            // Periodicity (Brent): did we come back to the checkpoint (which moves on at every power of two)?
+            if (all(lessThanEqual(abs(z - checkpoint), dvec2(periodicity_epsilon))))
+            {
+                state |= INTERIOR_FLAG;
+                break;
+            }
+
+            if ((i & (i + 1u)) == 0u)
+                checkpoint = z;
+        }
+    }
+
+    // Save the state:
+    iteration_state = (state & ~ITERATION_MASK) | i;
+    orbit_state = pack_double2(z);
+    checkpoint_state = pack_double2(checkpoint);
+}
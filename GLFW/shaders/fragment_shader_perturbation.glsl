@@ -0,0 +1,154 @@
+#version 300 es
+
+// Input:
+// The offset of c to the reference point (the Gaussian position of the vertex shader is relative to the reference here):
+in highp vec2 c;
+
+// Output:
+// Iteration count and flags:
+layout(location = 0) out highp uint iteration_state;
+
+// The orbit (dz as float bits and the index into the reference orbit):
+layout(location = 1) out highp uvec4 orbit_state;
+
+// The periodicity checkpoint (an earlier z = X_n + dz_n of the orbit as float bits):
+layout(location = 2) out highp uvec4 checkpoint_state;
+
+// Uniforms:
+// Iterations:
+uniform highp uint iterations;
+
+// The maximum number of iterations for this pass:
+uniform highp uint iteration_slice;
+
+// Start from z = c instead of continuing the previous state?
+uniform bool reset;
+
+// The previous state:
+uniform highp usampler2D previous_iteration_state;
+uniform highp usampler2D previous_orbit_state;
+uniform highp usampler2D previous_checkpoint_state;
+
+// Where to find the previous state of a pixel (panning shifts it by whole pixels, pixels shifted in from outside start over):
+uniform highp ivec2 pixel_shift;
+
+// Orbits that come back this close to the checkpoint are periodic (so the pixel is inside):
+uniform highp float periodicity_epsilon;
+
+// Layout of the iteration state:
+const highp uint ESCAPED_FLAG = 0x80000000u;
+const highp uint INTERIOR_FLAG = 0x40000000u;
+const highp uint ITERATION_MASK = 0x3FFFFFFFu;
+
+// Reference orbit X_n (RG32F, stored row by row and starting with X_0 = 0):
+uniform highp sampler2D reference_orbit;
+
+// The number of valid points in the reference orbit:
+uniform highp int reference_orbit_length;
+
+highp vec2 fetch_reference(highp int n)
+{
+    highp int row_length = textureSize(reference_orbit, 0).x;
+    return texelFetch(reference_orbit, ivec2(n % row_length, n / row_length), 0).xy;
+}
+
+// Is c inside the main cardioid or the period-2 bulb (then it never escapes)?
+// The margin keeps the test conservative despite rounding (pixels right at the boundary just iterate):
+const highp float INTERIOR_MARGIN = 1e-5;
+
+bool is_in_main_bulbs(highp vec2 c)
+{
+    // Main cardioid:
+    highp float x = c.x - 0.25;
+    highp float q = (x * x) + (c.y * c.y);
+
+    if ((q * (q + x)) < ((0.25 * c.y * c.y) - INTERIOR_MARGIN))
+        return true;
+
+    // Period-2 bulb (the disk of radius 1/4 around -1):
+    x = c.x + 1.0;
+
+    return ((x * x) + (c.y * c.y)) < (0.0625 - INTERIOR_MARGIN);
+}
+
+void main()
+{
+    // We only iterate the delta to the reference orbit: z_n = X_n + dz_n.
+    // We start at z = c (as the plain shader does), which is X_1 + dc:
+    highp vec2 dc = c;
+    highp ivec2 pixel = ivec2(gl_FragCoord.xy);
+    highp uint state = 0u;
+    highp vec2 dz = dc;
+    highp int n = 1;
+    highp vec2 checkpoint = vec2(0.0);
+
+    // Restore the state:
+    highp ivec2 source = pixel + pixel_shift;
+    bool is_fresh = reset || any(lessThan(source, ivec2(0))) || any(greaterThanEqual(source, textureSize(previous_iteration_state, 0)));
+
+    if (!is_fresh)
+    {
+        state = texelFetch(previous_iteration_state, source, 0).x;
+
+        highp uvec4 orbit = texelFetch(previous_orbit_state, source, 0);
+        dz = uintBitsToFloat(orbit.xy);
+        n = int(orbit.z);
+
+        checkpoint = uintBitsToFloat(texelFetch(previous_checkpoint_state, source, 0).xy);
+    }
+    else if (is_in_main_bulbs(fetch_reference(1) + dc))
+    {
+        // (X_1 = C, so this is c up to float rounding, which the margin covers.)
+        state = INTERIOR_FLAG;
+    }
+
+    highp uint i = state & ITERATION_MASK;
+
+    // Iterate (pixels that are done just pass through):
+    if (((state & (ESCAPED_FLAG | INTERIOR_FLAG)) == 0u) && (i < iterations))
+    {
+        highp uint end = i + min(iterations - i, iteration_slice);
+
+        for (; i < end; i++)
+        {
+            highp vec2 reference = fetch_reference(n);
+            highp vec2 z = reference + dz;
+
+            // Condition:
+            if (dot(z, z) > 4.0)
+            {
+                state |= ESCAPED_FLAG;
+                break;
+            }
+
+            // Periodicity (Brent): did we come back to the checkpoint (which moves on at every power of two)?
+            // We compare the full z, so this is limited by float precision (deep down it only catches orbits that repeat exactly):
+            if ((i > 0u) && all(lessThanEqual(abs(z - checkpoint), vec2(periodicity_epsilon))))
+            {
+                state |= INTERIOR_FLAG;
+                break;
+            }
+
+            if ((i & (i - 1u)) == 0u)
+                checkpoint = z;
+
+            // Rebase onto X_0 = 0 if the delta dominates (or if the reference runs out):
+            if ((dot(z, z) < dot(dz, dz)) || (n == (reference_orbit_length - 1)))
+            {
+                dz = z;
+                reference = vec2(0.0);
+                n = 0;
+            }
+
+            // Step (dz' = 2 X dz + dz^2 + dc = (2 X + dz) dz + dc):
+            highp vec2 factor = (2.0 * reference) + dz;
+            dz = vec2((factor.x * dz.x) - (factor.y * dz.y), (factor.x * dz.y) + (factor.y * dz.x)) + dc;
+            n++;
+        }
+    }
+
+    // Save the state:
+    iteration_state = (state & ~ITERATION_MASK) | i;
+    orbit_state = uvec4(floatBitsToUint(dz), uint(n), 0u);
+    checkpoint_state = uvec4(floatBitsToUint(checkpoint), 0u, 0u);
+}
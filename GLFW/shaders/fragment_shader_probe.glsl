@@ -0,0 +1,22 @@
+#version 300 es
+
+// Uniforms:
+// Iterations:
+uniform highp uint iterations;
+
+// The escape state (iteration count and flags):
+uniform highp usampler2D iteration_state;
+
+// Layout of the iteration state:
+const highp uint ESCAPED_FLAG = 0x80000000u;
+const highp uint INTERIOR_FLAG = 0x40000000u;
+const highp uint ITERATION_MASK = 0x3FFFFFFFu;
+
+void main()
+{
+    highp uint state = texelFetch(iteration_state, ivec2(gl_FragCoord.xy), 0).x;
+
+    // Only pixels that still have to iterate pass (and are counted by the occlusion query):
+    if (((state & (ESCAPED_FLAG | INTERIOR_FLAG)) != 0u) || ((state & ITERATION_MASK) >= iterations))
+        discard;
+}
@@ -0,0 +1,22 @@
+#version 300 es
+
+// Input:
+// Vertex data:
+layout(location = 0) in vec4 position;
+
+// Output:
+// The offset of c to the Gaussian position (the fragment shader adds the double-float position itself):
+out vec2 offset;
+
+// Uniforms:
+// Half frame (Gaussian):
+uniform vec2 gaussian_half_frame;
+
+void main()
+{
+    // Set the current position (this is always (-1 | 1)^2):
+    gl_Position = position;
+
+    // Calculate the offset:
+    offset = position.xy * gaussian_half_frame;
+}
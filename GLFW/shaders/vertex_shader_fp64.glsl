@@ -0,0 +1,11 @@
+#version 400 core
+
+// Input:
+// Vertex data:
+layout(location = 0) in vec4 position;
+
+void main()
+{
+    // Set the current position (this is always (-1 | 1)^2), the fragment shader computes c itself (in double):
+    gl_Position = position;
+}
@@ -0,0 +1,11 @@
+#version 300 es
+
+// Input:
+// Vertex data:
+layout(location = 0) in vec4 position;
+
+void main()
+{
+    // Just a full-screen-quad (the passes using this only look at gl_FragCoord):
+    gl_Position = position;
+}
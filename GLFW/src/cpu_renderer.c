@@ -0,0 +1,599 @@
+#include "cpu_renderer.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "tile_scheduler.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+    #define CPU_RENDERER_X86
+    #include <immintrin.h>
+#endif
+
+// The cardioid / bulb test is conservative by this margin (double rounding stays far below it):
+#define CPU_INTERIOR_MARGIN 1e-12
+
+// Macros:
+#define MIN(a, b) (((a) < (b)) ? (a) : (b))
+#define MAX(a, b) (((a) > (b)) ? (a) : (b))
+
+// Everything a kernel needs besides the pixels:
+typedef struct _escape_params_t_
+{
+    unsigned int iterations;
+    double periodicity_epsilon;
+} escape_params_t;
+
+// The pixels a kernel iterates (a tile of the image):
+typedef struct _escape_tile_t_
+{
+    // The real parts of the columns and the imaginary parts of the rows:
+    const double* c_x;
+    const double* c_y;
+
+    int width;
+    int height;
+
+    // Where the results go (rows are stride values apart):
+    uint32_t* states;
+    int stride;
+} escape_tile_t;
+
+// Every kernel does exactly the same double operations per pixel as the scalar one, so they all give the same results:
+typedef void (*escape_kernel_t)(const escape_tile_t* tile, const escape_params_t* params);
+
+// What the tile function needs:
+typedef struct _render_context_t_
+{
+    const double* c_x;
+    const double* c_y;
+    escape_kernel_t kernel;
+    const escape_params_t* params;
+    uint32_t* iteration_state;
+    int width;
+} render_context_t;
+
+static int is_in_main_bulbs(double c_x, double c_y)
+{
+    double y_squared = c_y * c_y;
+
+    // Main cardioid:
+    double x = c_x - 0.25;
+    double q = (x * x) + y_squared;
+
+    if ((q * (q + x)) < (((0.25 * c_y) * c_y) - CPU_INTERIOR_MARGIN))
+    {
+        return 1;
+    }
+
+    // Period-2 bulb (the disk of radius 1/4 around -1):
+    x = c_x + 1.0;
+
+    return ((x * x) + y_squared) < (0.0625 - CPU_INTERIOR_MARGIN);
+}
+
+static void escape_pixel_scalar(double c_x, double c_y, const escape_params_t* params, uint32_t* state)
+{
+    // Points inside the main cardioid or bulb never escape:
+    if (is_in_main_bulbs(c_x, c_y))
+    {
+        *state = INTERIOR_FLAG;
+        return;
+    }
+
+    double z_x = c_x;
+    double z_y = c_y;
+    double checkpoint_x = z_x;
+    double checkpoint_y = z_y;
+    uint32_t flags = 0;
+    unsigned int i;
+
+    for (i = 0; i < params->iterations; i++)
+    {
+        double x_squared = z_x * z_x;
+        double y_squared = z_y * z_y;
+
+        // Condition:
+        if ((x_squared + y_squared) > 4.0)
+        {
+            flags = ESCAPED_FLAG;
+            break;
+        }
+
+        // Step:
+        z_y = ((2.0 * z_x) * z_y) + c_y;
+        z_x = (x_squared - y_squared) + c_x;
+
+        // Periodicity (Brent): did we come back to the checkpoint (which moves on at every power of two)?
+        if ((fabs(z_x - checkpoint_x) <= params->periodicity_epsilon) && (fabs(z_y - checkpoint_y) <= params->periodicity_epsilon))
+        {
+            flags = INTERIOR_FLAG;
+            break;
+        }
+
+        if ((i & (i + 1)) == 0)
+        {
+            checkpoint_x = z_x;
+            checkpoint_y = z_y;
+        }
+    }
+
+    *state = flags | i;
+}
+
+static void escape_tile_scalar(const escape_tile_t* tile, const escape_params_t* params)
+{
+    for (int y = 0; y < tile->height; y++)
+    {
+        for (int x = 0; x < tile->width; x++)
+        {
+            escape_pixel_scalar(tile->c_x[x], tile->c_y[y], params, &tile->states[(y * tile->stride) + x]);
+        }
+    }
+}
+
+#ifdef CPU_RENDERER_X86
+// The per-lane state of a vector kernel. Whenever a lane finishes, we store the vectors here,
+// write out the result and refill the lane with the next pixel (so no lane waits for the slowest one of its vector):
+typedef struct _lanes_t_
+{
+    double c_x[8];
+    double c_y[8];
+    double z_x[8];
+    double z_y[8];
+    double checkpoint_x[8];
+    double checkpoint_y[8];
+
+    // The iteration count and the count at which the checkpoint moves on next (as doubles, which are exact here):
+    double count[8];
+    double next_checkpoint[8];
+
+    // Where the result of the lane goes:
+    uint32_t* state[8];
+} lanes_t;
+
+// Put the next pixel that needs iterating into a lane (pixels inside the main cardioid or bulb are done right away).
+// Returns 0 if there are no pixels left (the lane then iterates z = 0 harmlessly):
+static int refill_lane(lanes_t* lanes, int lane, const escape_tile_t* tile, int* next_pixel)
+{
+    while (next_pixel[1] < tile->height)
+    {
+        int x = next_pixel[0];
+        int y = next_pixel[1];
+        double c_x = tile->c_x[x];
+        double c_y = tile->c_y[y];
+        uint32_t* state = &tile->states[(y * tile->stride) + x];
+
+        // Row by row:
+        if (++next_pixel[0] == tile->width)
+        {
+            next_pixel[0] = 0;
+            next_pixel[1]++;
+        }
+
+        if (is_in_main_bulbs(c_x, c_y))
+        {
+            *state = INTERIOR_FLAG;
+            continue;
+        }
+
+        lanes->state[lane] = state;
+        lanes->c_x[lane] = c_x;
+        lanes->c_y[lane] = c_y;
+        lanes->z_x[lane] = c_x;
+        lanes->z_y[lane] = c_y;
+        lanes->checkpoint_x[lane] = c_x;
+        lanes->checkpoint_y[lane] = c_y;
+        lanes->count[lane] = 0;
+        lanes->next_checkpoint[lane] = 1;
+
+        return 1;
+    }
+
+    lanes->c_x[lane] = 0;
+    lanes->c_y[lane] = 0;
+    lanes->z_x[lane] = 0;
+    lanes->z_y[lane] = 0;
+
+    return 0;
+}
+
+// Write out the finished lanes and refill them. Returns the new mask of active lanes:
+static int retire_lanes(lanes_t* lanes, int active_bits, int finished_bits, int escaped_bits, int periodic_bits, const escape_tile_t* tile, int* next_pixel)
+{
+    for (int lane = 0; finished_bits; lane++, finished_bits >>= 1)
+    {
+        if (!(finished_bits & 1))
+        {
+            continue;
+        }
+
+        uint32_t flags = 0;
+
+        if (escaped_bits & (1 << lane))
+        {
+            flags = ESCAPED_FLAG;
+        }
+        else if (periodic_bits & (1 << lane))
+        {
+            flags = INTERIOR_FLAG;
+        }
+
+        *lanes->state[lane] = flags | (uint32_t)lanes->count[lane];
+
+        if (!refill_lane(lanes, lane, tile, next_pixel))
+        {
+            active_bits &= ~(1 << lane);
+        }
+    }
+
+    return active_bits;
+}
+
+// Fill all lanes for the start. Returns the mask of active lanes:
+static int start_lanes(lanes_t* lanes, int width, const escape_tile_t* tile, int* next_pixel)
+{
+    int active_bits = 0;
+
+    for (int lane = 0; lane < width; lane++)
+    {
+        if (refill_lane(lanes, lane, tile, next_pixel))
+        {
+            active_bits |= 1 << lane;
+        }
+    }
+
+    return active_bits;
+}
+
+// Select b where the mask is set (SSE2 has no blend):
+__attribute__((target("sse2")))
+static __m128d select_sse2(__m128d mask, __m128d a, __m128d b)
+{
+    return _mm_or_pd(_mm_and_pd(mask, b), _mm_andnot_pd(mask, a));
+}
+
+__attribute__((target("sse2")))
+static void escape_tile_sse2(const escape_tile_t* tile, const escape_params_t* params)
+{
+    const __m128d sign_mask = _mm_set1_pd(-0.0);
+    const __m128d epsilon = _mm_set1_pd(params->periodicity_epsilon);
+    const __m128d iterations = _mm_set1_pd((double)params->iterations);
+
+    lanes_t lanes;
+    int next_pixel[2] = { 0, 0 };
+    int active_bits = start_lanes(&lanes, 2, tile, next_pixel);
+
+    while (active_bits)
+    {
+        __m128d c_x_vector = _mm_loadu_pd(lanes.c_x);
+        __m128d c_y_vector = _mm_loadu_pd(lanes.c_y);
+        __m128d z_x = _mm_loadu_pd(lanes.z_x);
+        __m128d z_y = _mm_loadu_pd(lanes.z_y);
+        __m128d checkpoint_x = _mm_loadu_pd(lanes.checkpoint_x);
+        __m128d checkpoint_y = _mm_loadu_pd(lanes.checkpoint_y);
+        __m128d counts = _mm_loadu_pd(lanes.count);
+        __m128d next_checkpoint = _mm_loadu_pd(lanes.next_checkpoint);
+
+        __m128d escaping, periodic;
+        int finished_bits;
+
+        // Iterate until a lane is done:
+        do
+        {
+            __m128d x_squared = _mm_mul_pd(z_x, z_x);
+            __m128d y_squared = _mm_mul_pd(z_y, z_y);
+
+            // Condition:
+            escaping = _mm_cmpgt_pd(_mm_add_pd(x_squared, y_squared), _mm_set1_pd(4.0));
+
+            // Step:
+            z_y = _mm_add_pd(_mm_mul_pd(_mm_mul_pd(_mm_set1_pd(2.0), z_x), z_y), c_y_vector);
+            z_x = _mm_add_pd(_mm_sub_pd(x_squared, y_squared), c_x_vector);
+
+            // Periodicity:
+            __m128d delta_x = _mm_andnot_pd(sign_mask, _mm_sub_pd(z_x, checkpoint_x));
+            __m128d delta_y = _mm_andnot_pd(sign_mask, _mm_sub_pd(z_y, checkpoint_y));
+
+            periodic = _mm_andnot_pd(escaping, _mm_and_pd(_mm_cmple_pd(delta_x, epsilon), _mm_cmple_pd(delta_y, epsilon)));
+
+            __m128d next_counts = _mm_add_pd(counts, _mm_set1_pd(1.0));
+            __m128d is_checkpoint = _mm_cmpeq_pd(next_counts, next_checkpoint);
+
+            checkpoint_x = select_sse2(is_checkpoint, checkpoint_x, z_x);
+            checkpoint_y = select_sse2(is_checkpoint, checkpoint_y, z_y);
+            next_checkpoint = select_sse2(is_checkpoint, next_checkpoint, _mm_add_pd(next_checkpoint, next_checkpoint));
+
+            // Lanes that escaped or turned out periodic keep their count, the others move on:
+            __m128d is_stopped = _mm_or_pd(escaping, periodic);
+
+            finished_bits = _mm_movemask_pd(_mm_or_pd(is_stopped, _mm_cmpge_pd(next_counts, iterations))) & active_bits;
+            counts = select_sse2(is_stopped, next_counts, counts);
+        }
+        while (!finished_bits);
+
+        _mm_storeu_pd(lanes.z_x, z_x);
+        _mm_storeu_pd(lanes.z_y, z_y);
+        _mm_storeu_pd(lanes.checkpoint_x, checkpoint_x);
+        _mm_storeu_pd(lanes.checkpoint_y, checkpoint_y);
+        _mm_storeu_pd(lanes.count, counts);
+        _mm_storeu_pd(lanes.next_checkpoint, next_checkpoint);
+
+        active_bits = retire_lanes(&lanes, active_bits, finished_bits, _mm_movemask_pd(escaping), _mm_movemask_pd(periodic), tile, next_pixel);
+    }
+}
+
+__attribute__((target("avx2")))
+static void escape_tile_avx2(const escape_tile_t* tile, const escape_params_t* params)
+{
+    const __m256d sign_mask = _mm256_set1_pd(-0.0);
+    const __m256d epsilon = _mm256_set1_pd(params->periodicity_epsilon);
+    const __m256d iterations = _mm256_set1_pd((double)params->iterations);
+
+    lanes_t lanes;
+    int next_pixel[2] = { 0, 0 };
+    int active_bits = start_lanes(&lanes, 4, tile, next_pixel);
+
+    while (active_bits)
+    {
+        __m256d c_x_vector = _mm256_loadu_pd(lanes.c_x);
+        __m256d c_y_vector = _mm256_loadu_pd(lanes.c_y);
+        __m256d z_x = _mm256_loadu_pd(lanes.z_x);
+        __m256d z_y = _mm256_loadu_pd(lanes.z_y);
+        __m256d checkpoint_x = _mm256_loadu_pd(lanes.checkpoint_x);
+        __m256d checkpoint_y = _mm256_loadu_pd(lanes.checkpoint_y);
+        __m256d counts = _mm256_loadu_pd(lanes.count);
+        __m256d next_checkpoint = _mm256_loadu_pd(lanes.next_checkpoint);
+
+        __m256d escaping, periodic;
+        int finished_bits;
+
+        // Iterate until a lane is done:
+        do
+        {
+            __m256d x_squared = _mm256_mul_pd(z_x, z_x);
+            __m256d y_squared = _mm256_mul_pd(z_y, z_y);
+
+            // Condition:
+            escaping = _mm256_cmp_pd(_mm256_add_pd(x_squared, y_squared), _mm256_set1_pd(4.0), _CMP_GT_OQ);
+
+            // Step:
+            z_y = _mm256_add_pd(_mm256_mul_pd(_mm256_mul_pd(_mm256_set1_pd(2.0), z_x), z_y), c_y_vector);
+            z_x = _mm256_add_pd(_mm256_sub_pd(x_squared, y_squared), c_x_vector);
+
+            // Periodicity:
+            __m256d delta_x = _mm256_andnot_pd(sign_mask, _mm256_sub_pd(z_x, checkpoint_x));
+            __m256d delta_y = _mm256_andnot_pd(sign_mask, _mm256_sub_pd(z_y, checkpoint_y));
+
+            periodic = _mm256_andnot_pd(escaping, _mm256_and_pd(_mm256_cmp_pd(delta_x, epsilon, _CMP_LE_OQ), _mm256_cmp_pd(delta_y, epsilon, _CMP_LE_OQ)));
+
+            __m256d next_counts = _mm256_add_pd(counts, _mm256_set1_pd(1.0));
+            __m256d is_checkpoint = _mm256_cmp_pd(next_counts, next_checkpoint, _CMP_EQ_OQ);
+
+            checkpoint_x = _mm256_blendv_pd(checkpoint_x, z_x, is_checkpoint);
+            checkpoint_y = _mm256_blendv_pd(checkpoint_y, z_y, is_checkpoint);
+            next_checkpoint = _mm256_blendv_pd(next_checkpoint, _mm256_add_pd(next_checkpoint, next_checkpoint), is_checkpoint);
+
+            // Lanes that escaped or turned out periodic keep their count, the others move on:
+            __m256d is_stopped = _mm256_or_pd(escaping, periodic);
+
+            finished_bits = _mm256_movemask_pd(_mm256_or_pd(is_stopped, _mm256_cmp_pd(next_counts, iterations, _CMP_GE_OQ))) & active_bits;
+            counts = _mm256_blendv_pd(next_counts, counts, is_stopped);
+        }
+        while (!finished_bits);
+
+        _mm256_storeu_pd(lanes.z_x, z_x);
+        _mm256_storeu_pd(lanes.z_y, z_y);
+        _mm256_storeu_pd(lanes.checkpoint_x, checkpoint_x);
+        _mm256_storeu_pd(lanes.checkpoint_y, checkpoint_y);
+        _mm256_storeu_pd(lanes.count, counts);
+        _mm256_storeu_pd(lanes.next_checkpoint, next_checkpoint);
+
+        active_bits = retire_lanes(&lanes, active_bits, finished_bits, _mm256_movemask_pd(escaping), _mm256_movemask_pd(periodic), tile, next_pixel);
+    }
+}
+
+__attribute__((target("avx512f")))
+static void escape_tile_avx512(const escape_tile_t* tile, const escape_params_t* params)
+{
+    const __m512d epsilon = _mm512_set1_pd(params->periodicity_epsilon);
+    const __m512d iterations = _mm512_set1_pd((double)params->iterations);
+
+    lanes_t lanes;
+    int next_pixel[2] = { 0, 0 };
+    int active_bits = start_lanes(&lanes, 8, tile, next_pixel);
+
+    while (active_bits)
+    {
+        __m512d c_x_vector = _mm512_loadu_pd(lanes.c_x);
+        __m512d c_y_vector = _mm512_loadu_pd(lanes.c_y);
+        __m512d z_x = _mm512_loadu_pd(lanes.z_x);
+        __m512d z_y = _mm512_loadu_pd(lanes.z_y);
+        __m512d checkpoint_x = _mm512_loadu_pd(lanes.checkpoint_x);
+        __m512d checkpoint_y = _mm512_loadu_pd(lanes.checkpoint_y);
+        __m512d counts = _mm512_loadu_pd(lanes.count);
+        __m512d next_checkpoint = _mm512_loadu_pd(lanes.next_checkpoint);
+
+        __mmask8 escaping, periodic;
+        int finished_bits;
+
+        // Iterate until a lane is done:
+        do
+        {
+            __m512d x_squared = _mm512_mul_pd(z_x, z_x);
+            __m512d y_squared = _mm512_mul_pd(z_y, z_y);
+
+            // Condition:
+            escaping = _mm512_cmp_pd_mask(_mm512_add_pd(x_squared, y_squared), _mm512_set1_pd(4.0), _CMP_GT_OQ);
+
+            // Step:
+            z_y = _mm512_add_pd(_mm512_mul_pd(_mm512_mul_pd(_mm512_set1_pd(2.0), z_x), z_y), c_y_vector);
+            z_x = _mm512_add_pd(_mm512_sub_pd(x_squared, y_squared), c_x_vector);
+
+            // Periodicity:
+            __m512d delta_x = _mm512_abs_pd(_mm512_sub_pd(z_x, checkpoint_x));
+            __m512d delta_y = _mm512_abs_pd(_mm512_sub_pd(z_y, checkpoint_y));
+
+            periodic = _mm512_cmp_pd_mask(delta_x, epsilon, _CMP_LE_OQ) & _mm512_cmp_pd_mask(delta_y, epsilon, _CMP_LE_OQ) & (__mmask8)~escaping;
+
+            __m512d next_counts = _mm512_add_pd(counts, _mm512_set1_pd(1.0));
+            __mmask8 is_checkpoint = _mm512_cmp_pd_mask(next_counts, next_checkpoint, _CMP_EQ_OQ);
+
+            checkpoint_x = _mm512_mask_blend_pd(is_checkpoint, checkpoint_x, z_x);
+            checkpoint_y = _mm512_mask_blend_pd(is_checkpoint, checkpoint_y, z_y);
+            next_checkpoint = _mm512_mask_blend_pd(is_checkpoint, next_checkpoint, _mm512_add_pd(next_checkpoint, next_checkpoint));
+
+            // Lanes that escaped or turned out periodic keep their count, the others move on:
+            __mmask8 is_stopped = escaping | periodic;
+
+            finished_bits = (is_stopped | _mm512_cmp_pd_mask(next_counts, iterations, _CMP_GE_OQ)) & active_bits;
+            counts = _mm512_mask_blend_pd(is_stopped, next_counts, counts);
+        }
+        while (!finished_bits);
+
+        _mm512_storeu_pd(lanes.z_x, z_x);
+        _mm512_storeu_pd(lanes.z_y, z_y);
+        _mm512_storeu_pd(lanes.checkpoint_x, checkpoint_x);
+        _mm512_storeu_pd(lanes.checkpoint_y, checkpoint_y);
+        _mm512_storeu_pd(lanes.count, counts);
+        _mm512_storeu_pd(lanes.next_checkpoint, next_checkpoint);
+
+        active_bits = retire_lanes(&lanes, active_bits, finished_bits, escaping, periodic, tile, next_pixel);
+    }
+}
+#endif
+
+// Pick the widest kernel the CPU (and OS) supports:
+static escape_kernel_t select_escape_kernel(const char** name)
+{
+#ifdef CPU_RENDERER_X86
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx512f"))
+    {
+        *name = "avx512";
+        return escape_tile_avx512;
+    }
+
+    if (__builtin_cpu_supports("avx2"))
+    {
+        *name = "avx2";
+        return escape_tile_avx2;
+    }
+
+    if (__builtin_cpu_supports("sse2"))
+    {
+        *name = "sse2";
+        return escape_tile_sse2;
+    }
+#endif
+
+    *name = "scalar";
+    return escape_tile_scalar;
+}
+
+const char* cpu_renderer_simd_name(void)
+{
+    const char* name;
+    select_escape_kernel(&name);
+
+    return name;
+}
+
+int cpu_thread_count(void)
+{
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return (count > 0) ? (int)count : 1;
+}
+
+static void render_tile(const tile_t* tile, void* context)
+{
+    const render_context_t* render_context = context;
+
+    escape_tile_t escape_tile =
+    {
+        .c_x = render_context->c_x + tile->x,
+        .c_y = render_context->c_y + tile->y,
+        .width = tile->width,
+        .height = tile->height,
+        .states = render_context->iteration_state + (((size_t)tile->y * render_context->width) + tile->x),
+        .stride = render_context->width
+    };
+
+    render_context->kernel(&escape_tile, render_context->params);
+}
+
+void cpu_render_escape(const viewport_t* viewport, uint32_t* iteration_state, int thread_count)
+{
+    int width = viewport->size[0];
+    int height = viewport->size[1];
+
+    // The real parts are the same for every row, the imaginary parts for every column (rows go from top to bottom):
+    double* c_x = malloc(width * sizeof(double));
+    double* c_y = malloc(height * sizeof(double));
+
+    if (!c_x || !c_y)
+    {
+        fprintf(stderr, "Failed to allocate memory: %d bytes\n", (int)((width + height) * sizeof(double)));
+        exit(EXIT_FAILURE);
+    }
+
+    for (int x = 0; x < width; x++)
+    {
+        c_x[x] = dd_to_double(dd_add_double(viewport->position[0], ((x + 0.5) - (0.5 * width)) / viewport->scale));
+    }
+
+    for (int y = 0; y < height; y++)
+    {
+        c_y[y] = dd_to_double(dd_add_double(viewport->position[1], -(((y + 0.5) - (0.5 * height)) / viewport->scale)));
+    }
+
+    escape_params_t params = { .iterations = (unsigned int)viewport->iterations, .periodicity_epsilon = PERIODICITY_EPSILON_FACTOR / viewport->scale };
+
+    const char* kernel_name;
+    escape_kernel_t kernel = select_escape_kernel(&kernel_name);
+
+    // The vector kernels take a step before they check the limit:
+    if (params.iterations == 0)
+    {
+        kernel = escape_tile_scalar;
+    }
+
+    render_context_t render_context = { .c_x = c_x, .c_y = c_y, .kernel = kernel, .params = &params, .iteration_state = iteration_state, .width = width };
+
+    run_tiles(width, height, thread_count, render_tile, &render_context);
+
+    free(c_y);
+    free(c_x);
+}
+
+void cpu_colorize(const uint32_t* iteration_state, int pixel_count, int iterations, const hue_table_t* hue_table, double hue_density, double hue_offset, uint8_t* pixels)
+{
+    // The shader works with floats, so we do as well:
+    float density = (float)hue_density;
+    float offset = (float)hue_offset;
+
+    for (int p = 0; p < pixel_count; p++)
+    {
+        uint32_t state = iteration_state[p];
+        uint32_t i = state & ITERATION_MASK;
+
+        // Pixels that did not escape (yet) or only escaped beyond the current limit get the (fixed) end of the palette:
+        float hue = 1.0f;
+
+        if ((state & ESCAPED_FLAG) && (i < (uint32_t)iterations))
+        {
+            float value = (density * ((float)i / (float)iterations)) + offset;
+            hue = value - floorf(value);
+        }
+
+        // Nearest texel, clamped to the edge:
+        int texel = MIN((int)floorf(hue * hue_table->length), hue_table->length - 1);
+
+        memcpy(pixels + (4 * (size_t)p), hue_table->texels + (4 * texel), 4);
+    }
+}
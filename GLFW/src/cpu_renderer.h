@@ -0,0 +1,25 @@
+#ifndef CPU_RENDERER_H
+#define CPU_RENDERER_H
+
+#include <stdint.h>
+
+#include "hue_table.h"
+#include "viewport.h"
+
+// The CPU renderer mirrors the GL passes: an escape pass producing the iteration state (same layout as the shaders use)
+// and a colorize pass mapping it through a palette. It iterates in native double precision, vectorized with AVX-512, AVX2 or SSE2
+// (picked at runtime) and spread over all cores in tiles (see tile_scheduler.h). The results don't depend on the SIMD width or the number of threads.
+
+// The SIMD flavour in use ("avx512", "avx2", "sse2" or "scalar"):
+const char* cpu_renderer_simd_name(void);
+
+// The number of threads to use by default (one per core):
+int cpu_thread_count(void);
+
+// Iterate all pixels of the viewport into iteration_state (size[0] * size[1] values, rows from top to bottom):
+void cpu_render_escape(const viewport_t* viewport, uint32_t* iteration_state, int thread_count);
+
+// Map the iteration state to RGBA8 pixels exactly like the colorize shader does:
+void cpu_colorize(const uint32_t* iteration_state, int pixel_count, int iterations, const hue_table_t* hue_table, double hue_density, double hue_offset, uint8_t* pixels);
+
+#endif
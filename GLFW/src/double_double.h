@@ -0,0 +1,221 @@
+#ifndef DOUBLE_DOUBLE_H
+#define DOUBLE_DOUBLE_H
+
+// A double-double number is the unevaluated sum of two doubles (hi + lo with |lo| <= ulp(hi) / 2).
+// This gives us ~106 bits of mantissa, enough to address single pixels at scales beyond 1e30.
+// All of this relies on strict IEEE 754 double arithmetic, so don't build it with -ffast-math (or let the compiler contract into FMAs).
+typedef struct _double_double_t_
+{
+    double hi;
+    double lo;
+} double_double_t;
+
+static inline double_double_t dd_from_double(double value)
+{
+    return (double_double_t){ .hi = value, .lo = 0 };
+}
+
+static inline double dd_to_double(double_double_t value)
+{
+    return value.hi + value.lo;
+}
+
+// Exact sum of two doubles (Knuth):
+static inline double_double_t dd_two_sum(double a, double b)
+{
+    double sum = a + b;
+    double b_virtual = sum - a;
+    double error = (a - (sum - b_virtual)) + (b - b_virtual);
+
+    return (double_double_t){ .hi = sum, .lo = error };
+}
+
+// Exact sum of two doubles, requires |a| >= |b|:
+static inline double_double_t dd_quick_two_sum(double a, double b)
+{
+    double sum = a + b;
+    double error = b - (sum - a);
+
+    return (double_double_t){ .hi = sum, .lo = error };
+}
+
+// Exact product of two doubles (Dekker / Veltkamp split):
+static inline double_double_t dd_two_prod(double a, double b)
+{
+    const double splitter = 134217729.0; // 2^27 + 1
+
+    double a_split = splitter * a;
+    double a_hi = a_split - (a_split - a);
+    double a_lo = a - a_hi;
+
+    double b_split = splitter * b;
+    double b_hi = b_split - (b_split - b);
+    double b_lo = b - b_hi;
+
+    double product = a * b;
+    double error = (((a_hi * b_hi) - product) + (a_hi * b_lo) + (a_lo * b_hi)) + (a_lo * b_lo);
+
+    return (double_double_t){ .hi = product, .lo = error };
+}
+
+static inline double_double_t dd_add(double_double_t a, double_double_t b)
+{
+    double_double_t sum = dd_two_sum(a.hi, b.hi);
+    double_double_t error = dd_two_sum(a.lo, b.lo);
+
+    sum.lo += error.hi;
+    sum = dd_quick_two_sum(sum.hi, sum.lo);
+    sum.lo += error.lo;
+
+    return dd_quick_two_sum(sum.hi, sum.lo);
+}
+
+static inline double_double_t dd_add_double(double_double_t a, double b)
+{
+    double_double_t sum = dd_two_sum(a.hi, b);
+    sum.lo += a.lo;
+
+    return dd_quick_two_sum(sum.hi, sum.lo);
+}
+
+static inline double_double_t dd_neg(double_double_t a)
+{
+    return (double_double_t){ .hi = -a.hi, .lo = -a.lo };
+}
+
+static inline double_double_t dd_sub(double_double_t a, double_double_t b)
+{
+    return dd_add(a, dd_neg(b));
+}
+
+static inline double_double_t dd_mul(double_double_t a, double_double_t b)
+{
+    double_double_t product = dd_two_prod(a.hi, b.hi);
+    product.lo += (a.hi * b.lo) + (a.lo * b.hi);
+
+    return dd_quick_two_sum(product.hi, product.lo);
+}
+
+static inline double_double_t dd_mul_double(double_double_t a, double b)
+{
+    double_double_t product = dd_two_prod(a.hi, b);
+    product.lo += a.lo * b;
+
+    return dd_quick_two_sum(product.hi, product.lo);
+}
+
+static inline double_double_t dd_sqr(double_double_t a)
+{
+    double_double_t product = dd_two_prod(a.hi, a.hi);
+    product.lo += 2.0 * a.hi * a.lo;
+
+    return dd_quick_two_sum(product.hi, product.lo);
+}
+
+static inline double_double_t dd_div_double(double_double_t a, double b)
+{
+    // Long division: the first quotient plus a correction from the (exact) remainder:
+    double quotient = a.hi / b;
+    double_double_t remainder = dd_sub(a, dd_two_prod(quotient, b));
+
+    return dd_quick_two_sum(quotient, remainder.hi / b);
+}
+
+// Parse a decimal number like "-0.74364388703715870475" or "1.5e-7" with full double-double precision.
+// Returns 0 if the text is not a number:
+static inline int dd_parse(const char* text, double_double_t* value)
+{
+    double_double_t mantissa = dd_from_double(0);
+    int is_negative = 0;
+    int digits = 0;
+    int exponent = 0;
+
+    if ((*text == '+') || (*text == '-'))
+    {
+        is_negative = (*text++ == '-');
+    }
+
+    for (; (*text >= '0') && (*text <= '9'); text++, digits++)
+    {
+        mantissa = dd_add_double(dd_mul_double(mantissa, 10.0), *text - '0');
+    }
+
+    if (*text == '.')
+    {
+        for (text++; (*text >= '0') && (*text <= '9'); text++, digits++, exponent--)
+        {
+            mantissa = dd_add_double(dd_mul_double(mantissa, 10.0), *text - '0');
+        }
+    }
+
+    if (!digits)
+    {
+        return 0;
+    }
+
+    if ((*text == 'e') || (*text == 'E'))
+    {
+        int is_exponent_negative = 0;
+        int exponent_digits = 0;
+        int explicit_exponent = 0;
+
+        text++;
+
+        if ((*text == '+') || (*text == '-'))
+        {
+            is_exponent_negative = (*text++ == '-');
+        }
+
+        for (; (*text >= '0') && (*text <= '9'); text++, exponent_digits++)
+        {
+            // Way beyond the range of doubles anyway:
+            if (explicit_exponent < 10000)
+            {
+                explicit_exponent = (10 * explicit_exponent) + (*text - '0');
+            }
+        }
+
+        if (!exponent_digits)
+        {
+            return 0;
+        }
+
+        exponent += is_exponent_negative ? -explicit_exponent : explicit_exponent;
+    }
+
+    if (*text)
+    {
+        return 0;
+    }
+
+    // Scale by powers of ten (which are exact doubles up to 10^22):
+    while (exponent != 0)
+    {
+        int step = (exponent > 0) ? exponent : -exponent;
+        double power = 1.0;
+
+        step = (step > 22) ? 22 : step;
+
+        for (int i = 0; i < step; i++)
+        {
+            power *= 10.0;
+        }
+
+        if (exponent > 0)
+        {
+            mantissa = dd_mul_double(mantissa, power);
+            exponent -= step;
+        }
+        else
+        {
+            mantissa = dd_div_double(mantissa, power);
+            exponent += step;
+        }
+    }
+
+    *value = is_negative ? dd_neg(mantissa) : mantissa;
+
+    return 1;
+}
+
+#endif
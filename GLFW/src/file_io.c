@@ -0,0 +1,67 @@
+#include "file_io.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+int read_all_bytes(const char* file_path, int insert_trailing_zero, uint8_t** ptr)
+{
+    // Try to open the file:
+    FILE* file = fopen(file_path, "rb");
+
+    if (!file)
+    {
+        fprintf(stderr, "Failed to open file: %s\n", file_path);
+        exit(EXIT_FAILURE);
+    }
+
+    // Seek the end:
+    if (fseek(file, 0, SEEK_END))
+    {
+        fprintf(stderr, "Failed to seek end of file: %s\n", file_path);
+        exit(EXIT_FAILURE);
+    }
+
+    // Get the file length:
+    int file_length = ftell(file);
+    int buffer_length;
+
+    // Do we have to insert a trailing zero?
+    if (insert_trailing_zero)
+    {
+        buffer_length = file_length + 1;
+    }
+    else
+    {
+        buffer_length = file_length;
+    }
+
+    // Rewind the file to the start:
+    rewind(file);
+
+    // Allocate space:
+    *ptr = (uint8_t*)malloc(buffer_length);
+
+    if (!*ptr)
+    {
+        fprintf(stderr, "Failed to allocate memory: %d bytes\n", buffer_length);
+        exit(EXIT_FAILURE);
+    }
+
+    // Read all the bytes:
+    if (fread(*ptr, 1, file_length, file) != file_length)
+    {
+        fprintf(stderr, "Failed to read file contents: %s\n", file_path);
+        exit(EXIT_FAILURE);
+    }
+
+    // Close the file:
+    fclose(file);
+
+    // Set the trailing zero:
+    if (insert_trailing_zero)
+    {
+        (*ptr)[buffer_length - 1] = 0;
+    }
+
+    return buffer_length;
+}
@@ -0,0 +1,10 @@
+#ifndef FILE_IO_H
+#define FILE_IO_H
+
+#include <stdint.h>
+
+// Read all bytes from a given file path (exits on failure).
+// The resulting pointer must be freed!
+int read_all_bytes(const char* file_path, int insert_trailing_zero, uint8_t** ptr);
+
+#endif
@@ -0,0 +1,1741 @@
+#include "gl_renderer.h"
+
+#include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cpu_renderer.h"
+#include "file_io.h"
+
+// Do we currently debug?
+// Uncomment for OpenGL error checking!
+#define DEBUG
+
+// The vertex data (pretty simple):
+#define VERTEX_DATA_POSITION_ATTRIBUTE 0
+
+// Texture units:
+#define HUE_TEXTURE_UNIT 0
+#define REFERENCE_ORBIT_TEXTURE_UNIT 1
+#define ITERATION_STATE_TEXTURE_UNIT 2
+#define ORBIT_STATE_TEXTURE_UNIT 3
+#define CHECKPOINT_STATE_TEXTURE_UNIT 4
+
+// Image units, buffer bindings and work group size of the compute path (as in the compute shaders):
+#define ITERATION_STATE_IMAGE_UNIT 0
+#define ORBIT_STATE_IMAGE_UNIT 1
+#define CHECKPOINT_STATE_IMAGE_UNIT 2
+
+#define ACTIVE_PIXEL_BINDING 0
+#define NEXT_ACTIVE_PIXEL_BINDING 1
+#define DISPATCH_BINDING 2
+#define ACTIVE_PIXEL_COUNTER_BINDING 0
+
+#define GATHER_GROUP_SIZE 8
+
+// The reference orbit is stored in rows of this many points (ES 3.0 guarantees 2048 texels):
+#define REFERENCE_ORBIT_ROW_LENGTH 1024
+
+// Longer orbits are truncated (the shader rebases at the end, which gets glitchy for deep interior pixels):
+#define MAX_REFERENCE_ORBIT_LENGTH (1 << 22)
+
+// In progressive mode, every frame advances the pixels by this many iterations:
+#define PROGRESSIVE_ITERATION_SLICE 200
+
+// A precision tier is accurate enough if a pixel spans at least this many ulps of the largest |c| or |z| in the view.
+// This leaves some headroom for the rounding errors that pile up while iterating:
+#define PRECISION_TIER_SAFETY_FACTOR 32.0
+
+// A pan reuses the escape state only if it moves by whole pixels, up to this fraction of a pixel (rounding noise):
+#define PIXEL_SHIFT_TOLERANCE 1e-3
+
+// Macros:
+#define MIN(a, b) (((a) < (b)) ? (a) : (b))
+#define MAX(a, b) (((a) > (b)) ? (a) : (b))
+
+typedef struct _vertex_data_t_
+{
+    GLfloat x;
+    GLfloat y;
+} vertex_data_t;
+
+const char* precision_tier_names[PRECISION_TIER_COUNT] = { "float", "fp64", "df64", "perturbation" };
+
+// The relative precision of each tier (perturbation only iterates relative deltas, so it is never limited here):
+const double precision_tier_epsilons[PRECISION_TIER_COUNT] = { 0x1p-24, 0x1p-53, 0x1p-46, 0 };
+
+// Check for an OpenGL error if we are not debugging:
+void check_error(const char* dbg_domain, const char* error_text)
+{
+#ifdef DEBUG
+    GLenum error = glGetError();
+
+    if (error != GL_NO_ERROR)
+    {
+        printf("[%s] %s: %d\n", dbg_domain, error_text, error);
+        exit(EXIT_FAILURE);
+    }
+#endif
+}
+
+void init_gl_features(void)
+{
+    printf("Initializing some GL features ...\n");
+    const char dbg_domain[] = "Initializing GL features";
+
+    // Disable alpha blending:
+    glDisable(GL_BLEND);
+    check_error(dbg_domain, "Failed to disable alpha blending");
+
+    // Disable the depth test:
+    glDisable(GL_DEPTH_TEST);
+    check_error(dbg_domain, "Failed to disable the depth test");
+
+    glDepthMask(GL_FALSE);
+    check_error(dbg_domain, "Failed to disable the depth mask");
+
+    // Disable the scissor test:
+    glDisable(GL_SCISSOR_TEST);
+    check_error(dbg_domain, "Failed to disable the scissor test");
+
+    // Disable the stencil test:
+    glDisable(GL_STENCIL_TEST);
+    check_error(dbg_domain, "Failed to disable the stencil test");
+
+    // Disable dithering:
+    glDisable(GL_DITHER);
+    check_error(dbg_domain, "Failed to disable dithering");
+}
+
+void init_vertex_data(GLuint* vertex_buffer_object, GLuint* vertex_array_object)
+{
+    printf("Uploading vertex data ...\n");
+    const char dbg_domain[] = "Initializing vertex data";
+
+    // Create and bind a dummy VAO (this is actually needed in desktop GL):
+    glGenVertexArrays(1, vertex_array_object);
+    check_error(dbg_domain, "Failed to generate VAO");
+
+    glBindVertexArray(*vertex_array_object);
+    check_error(dbg_domain, "Failed to bind VAO");
+
+    // Generate a VBO:
+    glGenBuffers(1, vertex_buffer_object);
+    check_error(dbg_domain, "Failed to generate VBO");
+
+    // Bind it:
+    glBindBuffer(GL_ARRAY_BUFFER, *vertex_buffer_object);
+    check_error(dbg_domain, "Failed to bind VBO");
+
+    // Create simple vertex data for the corners:
+    vertex_data_t vertex_data[] =
+    {
+        { .x = -1, .y = -1 },
+        { .x = +1, .y = -1 },
+        { .x = -1, .y = +1 },
+        { .x = +1, .y = +1 }
+    };
+
+    // Upload it:
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertex_data), (const GLvoid*)vertex_data, GL_STATIC_DRAW);
+    check_error(dbg_domain, "Failed to buffer vertex data");
+
+    // Enable the array:
+    glEnableVertexAttribArray(VERTEX_DATA_POSITION_ATTRIBUTE);
+    check_error(dbg_domain, "Failed to enable position attribute");
+
+    // Specify the vertex data:
+    glVertexAttribPointer(VERTEX_DATA_POSITION_ATTRIBUTE, 2, GL_FLOAT, GL_FALSE, sizeof(vertex_data_t), (GLvoid*)offsetof(vertex_data_t, x));
+    check_error(dbg_domain, "Failed to specify position attribute");
+}
+
+static GLuint create_shader(GLenum shader_type, const char* file_path)
+{
+    const char dbg_domain[] = "Creating shader";
+
+    // Read all the bytes:
+    uint8_t* shader_source;
+    read_all_bytes(file_path, 1, &shader_source);
+
+    // Create a shader of our type:
+    GLuint shader_handle = glCreateShader(shader_type);
+    check_error(dbg_domain, "Failed to generate shader handle");
+
+    // Pass the shader source down to OpenGL:
+    glShaderSource(shader_handle, 1, (const GLchar**)&shader_source, NULL);
+    check_error(dbg_domain, "Failed to provide shader source code");
+
+    // Free the shader source:
+    free(shader_source);
+
+    // Compile the shader:
+    glCompileShader(shader_handle);
+    check_error(dbg_domain, "Failed to compile shader");
+
+    // Check if we had success:
+    GLint compilation_success;
+
+    glGetShaderiv(shader_handle, GL_COMPILE_STATUS, &compilation_success);
+    check_error(dbg_domain, "Failed to retrieve shader parameter");
+
+    if (compilation_success != (GLint)GL_TRUE)
+    {
+        // Retrieve the error message:
+        char error_message[256];
+
+        glGetShaderInfoLog(shader_handle, 256, NULL, error_message);
+        check_error(dbg_domain, "Failed to retrieve shader info log");
+
+        // Print it and fail:
+        fprintf(stderr, "[%s] Failed to compile a shader: %s\n", dbg_domain, error_message);
+        exit(EXIT_FAILURE);
+    }
+
+    // Return the shader handle:
+    return shader_handle;
+}
+
+static GLuint link_shader_program(const char* vertex_shader_path, const char* fragment_shader_path)
+{
+    printf("Compiling shaders (%s) ...\n", fragment_shader_path);
+    const char dbg_domain[] = "Initializing shaders";
+
+    // Create the vertex shader:
+    GLuint vertex_shader_handle = create_shader(GL_VERTEX_SHADER, vertex_shader_path);
+
+    // Create the fragment shader:
+    GLuint fragment_shader_handle = create_shader(GL_FRAGMENT_SHADER, fragment_shader_path);
+
+    // Create the program:
+    GLuint program_handle = glCreateProgram();
+    check_error(dbg_domain, "Failed to generate shader program handle");
+
+    // Attach the shaders:
+    glAttachShader(program_handle, vertex_shader_handle);
+    check_error(dbg_domain, "Failed to attach vertex shader");
+
+    glAttachShader(program_handle, fragment_shader_handle);
+    check_error(dbg_domain, "Failed to attach fragment shader");
+
+    // Link the program:
+    glLinkProgram(program_handle);
+    check_error(dbg_domain, "Failed to link shader program");
+
+    // Check if we had success:
+    GLint linking_success;
+
+    glGetProgramiv(program_handle, GL_LINK_STATUS, &linking_success);
+    check_error(dbg_domain, "Failed to retrieve shader program parameter");
+
+    if (linking_success != (GLint)GL_TRUE)
+    {
+        // Retrieve the error message:
+        char error_message[256];
+
+        glGetProgramInfoLog(program_handle, 256, NULL, error_message);
+        check_error(dbg_domain, "Failed to retrieve shader program info log");
+
+        // Print it and fail:
+        fprintf(stderr, "[%s] Failed to link shader program: %s\n", dbg_domain, error_message);
+        exit(EXIT_FAILURE);
+    }
+
+    // After we have linked the program, it's a good idea to detach the shaders from it:
+    glDetachShader(program_handle, vertex_shader_handle);
+    check_error(dbg_domain, "Failed to detach vertex shader");
+
+    glDetachShader(program_handle, fragment_shader_handle);
+    check_error(dbg_domain, "Failed to detach fragment shader");
+
+    // We don't need the shaders anymore, so we can delete them right here:
+    glDeleteShader(vertex_shader_handle);
+    check_error(dbg_domain, "Failed to delete vertex shader");
+
+    glDeleteShader(fragment_shader_handle);
+    check_error(dbg_domain, "Failed to delete fragment shader");
+
+    // Use our program (at least for the constant uniforms the caller sets):
+    glUseProgram(program_handle);
+    check_error(dbg_domain, "Failed to enable shader program");
+
+    return program_handle;
+}
+
+static GLuint link_compute_program(const char* compute_shader_path)
+{
+    printf("Compiling shaders (%s) ...\n", compute_shader_path);
+    const char dbg_domain[] = "Initializing shaders";
+
+    GLuint compute_shader_handle = create_shader(GL_COMPUTE_SHADER, compute_shader_path);
+
+    GLuint program_handle = glCreateProgram();
+    check_error(dbg_domain, "Failed to generate shader program handle");
+
+    glAttachShader(program_handle, compute_shader_handle);
+    check_error(dbg_domain, "Failed to attach compute shader");
+
+    glLinkProgram(program_handle);
+    check_error(dbg_domain, "Failed to link shader program");
+
+    GLint linking_success;
+
+    glGetProgramiv(program_handle, GL_LINK_STATUS, &linking_success);
+    check_error(dbg_domain, "Failed to retrieve shader program parameter");
+
+    if (linking_success != (GLint)GL_TRUE)
+    {
+        char error_message[256];
+
+        glGetProgramInfoLog(program_handle, 256, NULL, error_message);
+        check_error(dbg_domain, "Failed to retrieve shader program info log");
+
+        fprintf(stderr, "[%s] Failed to link shader program: %s\n", dbg_domain, error_message);
+        exit(EXIT_FAILURE);
+    }
+
+    glDetachShader(program_handle, compute_shader_handle);
+    check_error(dbg_domain, "Failed to detach compute shader");
+
+    glDeleteShader(compute_shader_handle);
+    check_error(dbg_domain, "Failed to delete compute shader");
+
+    // Use our program (at least for the constant uniforms the caller sets):
+    glUseProgram(program_handle);
+    check_error(dbg_domain, "Failed to enable shader program");
+
+    return program_handle;
+}
+
+// Retrieve the location of a uniform the program must have:
+static GLint get_uniform_location(GLuint program_handle, const char* name)
+{
+    const char dbg_domain[] = "Retrieving uniform";
+
+    GLint location = glGetUniformLocation(program_handle, name);
+    check_error(dbg_domain, "Failed to retrieve uniform");
+
+    if (location < 0)
+    {
+        fprintf(stderr, "[%s] Uniform is not available: %s\n", dbg_domain, name);
+        exit(EXIT_FAILURE);
+    }
+
+    return location;
+}
+
+void init_shader_program(shader_program_t* shader_program, const char* vertex_shader_path, const char* fragment_shader_path)
+{
+    const char dbg_domain[] = "Initializing shaders";
+
+    // Compile and link:
+    shader_program->handle = link_shader_program(vertex_shader_path, fragment_shader_path);
+
+    // Retrieve the uniforms:
+    shader_program->gaussian_position_uniform = get_uniform_location(shader_program->handle, "gaussian_position");
+    shader_program->gaussian_half_frame_uniform = get_uniform_location(shader_program->handle, "gaussian_half_frame");
+    shader_program->iterations_uniform = get_uniform_location(shader_program->handle, "iterations");
+    shader_program->iteration_slice_uniform = get_uniform_location(shader_program->handle, "iteration_slice");
+    shader_program->reset_uniform = get_uniform_location(shader_program->handle, "reset");
+    shader_program->pixel_shift_uniform = get_uniform_location(shader_program->handle, "pixel_shift");
+    shader_program->periodicity_epsilon_uniform = get_uniform_location(shader_program->handle, "periodicity_epsilon");
+
+    // Assign the state textures (const):
+    glUniform1i(get_uniform_location(shader_program->handle, "previous_iteration_state"), ITERATION_STATE_TEXTURE_UNIT);
+    check_error(dbg_domain, "Failed to assign to constant uniform (previous_iteration_state)");
+
+    glUniform1i(get_uniform_location(shader_program->handle, "previous_orbit_state"), ORBIT_STATE_TEXTURE_UNIT);
+    check_error(dbg_domain, "Failed to assign to constant uniform (previous_orbit_state)");
+
+    glUniform1i(get_uniform_location(shader_program->handle, "previous_checkpoint_state"), CHECKPOINT_STATE_TEXTURE_UNIT);
+    check_error(dbg_domain, "Failed to assign to constant uniform (previous_checkpoint_state)");
+
+    // Double-float programs get the low part of the position as well:
+    shader_program->gaussian_position_lo_uniform = glGetUniformLocation(shader_program->handle, "gaussian_position_lo");
+    check_error(dbg_domain, "Failed to retrieve uniform (gaussian_position_lo)");
+
+    if (shader_program->gaussian_position_lo_uniform >= 0)
+    {
+        // This keeps the compiler from optimizing away the double-float error terms:
+        glUniform1f(get_uniform_location(shader_program->handle, "df64_one"), 1.0f);
+        check_error(dbg_domain, "Failed to assign to constant uniform (df64_one)");
+    }
+
+    // Perturbation programs also sample the reference orbit:
+    shader_program->reference_orbit_length_uniform = glGetUniformLocation(shader_program->handle, "reference_orbit_length");
+    check_error(dbg_domain, "Failed to retrieve uniform (reference_orbit_length)");
+
+    if (shader_program->reference_orbit_length_uniform >= 0)
+    {
+        glUniform1i(get_uniform_location(shader_program->handle, "reference_orbit"), REFERENCE_ORBIT_TEXTURE_UNIT);
+        check_error(dbg_domain, "Failed to assign to constant uniform (reference_orbit)");
+    }
+}
+
+void init_state_program(state_program_t* state_program, const char* fragment_shader_path)
+{
+    const char dbg_domain[] = "Initializing shaders";
+
+    // Compile and link (these passes only need gl_FragCoord):
+    state_program->handle = link_shader_program("shaders/vertex_shader_quad.glsl", fragment_shader_path);
+
+    // Retrieve the uniforms:
+    state_program->iterations_uniform = get_uniform_location(state_program->handle, "iterations");
+
+    glUniform1i(get_uniform_location(state_program->handle, "iteration_state"), ITERATION_STATE_TEXTURE_UNIT);
+    check_error(dbg_domain, "Failed to assign to constant uniform (iteration_state)");
+
+    // The colorize pass does the hue lookup:
+    GLint hue_texture_uniform = glGetUniformLocation(state_program->handle, "hue_texture");
+    check_error(dbg_domain, "Failed to retrieve uniform (hue_texture)");
+
+    state_program->hue_density_uniform = -1;
+    state_program->hue_offset_uniform = -1;
+
+    if (hue_texture_uniform >= 0)
+    {
+        glUniform1i(hue_texture_uniform, HUE_TEXTURE_UNIT);
+        check_error(dbg_domain, "Failed to assign to constant uniform (hue_texture)");
+
+        state_program->hue_density_uniform = get_uniform_location(state_program->handle, "hue_density");
+        state_program->hue_offset_uniform = get_uniform_location(state_program->handle, "hue_offset");
+    }
+}
+
+// The escape kernel of a tier for the compute path (its images and buffers have fixed bindings in the shader):
+static void init_compute_program(shader_program_t* shader_program, const char* compute_shader_path)
+{
+    const char dbg_domain[] = "Initializing shaders";
+
+    shader_program->handle = link_compute_program(compute_shader_path);
+
+    shader_program->gaussian_position_uniform = get_uniform_location(shader_program->handle, "gaussian_position");
+    shader_program->gaussian_half_frame_uniform = get_uniform_location(shader_program->handle, "gaussian_half_frame");
+    shader_program->iterations_uniform = get_uniform_location(shader_program->handle, "iterations");
+    shader_program->iteration_slice_uniform = get_uniform_location(shader_program->handle, "iteration_slice");
+    shader_program->periodicity_epsilon_uniform = get_uniform_location(shader_program->handle, "periodicity_epsilon");
+
+    // Compute kernels only continue pixels:
+    shader_program->reset_uniform = -1;
+    shader_program->pixel_shift_uniform = -1;
+    shader_program->reference_orbit_length_uniform = -1;
+
+    // They read the orbit and the checkpoint through textures:
+    glUniform1i(get_uniform_location(shader_program->handle, "previous_orbit_state"), ORBIT_STATE_TEXTURE_UNIT);
+    check_error(dbg_domain, "Failed to assign to constant uniform (previous_orbit_state)");
+
+    glUniform1i(get_uniform_location(shader_program->handle, "previous_checkpoint_state"), CHECKPOINT_STATE_TEXTURE_UNIT);
+    check_error(dbg_domain, "Failed to assign to constant uniform (previous_checkpoint_state)");
+
+    // Double-float programs get the low part of the position as well:
+    shader_program->gaussian_position_lo_uniform = glGetUniformLocation(shader_program->handle, "gaussian_position_lo");
+    check_error(dbg_domain, "Failed to retrieve uniform (gaussian_position_lo)");
+
+    if (shader_program->gaussian_position_lo_uniform >= 0)
+    {
+        glUniform1f(get_uniform_location(shader_program->handle, "df64_one"), 1.0f);
+        check_error(dbg_domain, "Failed to assign to constant uniform (df64_one)");
+    }
+}
+
+static void init_compute_programs(compute_programs_t* compute_programs)
+{
+    const char dbg_domain[] = "Initializing shaders";
+
+    // The tiers without a compute kernel stay with their fragment kernel (deleting program 0 is a no-op):
+    for (int i = 0; i < PRECISION_TIER_COUNT; i++)
+    {
+        compute_programs->escape_programs[i].handle = 0;
+    }
+
+    init_compute_program(&compute_programs->escape_programs[PRECISION_TIER_FLOAT], "shaders/compute_shader.glsl");
+    init_compute_program(&compute_programs->escape_programs[PRECISION_TIER_DF64], "shaders/compute_shader_df64.glsl");
+
+    compute_programs->gather_program = link_compute_program("shaders/compute_shader_gather.glsl");
+    compute_programs->gather_iterations_uniform = get_uniform_location(compute_programs->gather_program, "iterations");
+
+    glUniform1i(get_uniform_location(compute_programs->gather_program, "iteration_state"), ITERATION_STATE_TEXTURE_UNIT);
+    check_error(dbg_domain, "Failed to assign to constant uniform (iteration_state)");
+
+    compute_programs->dispatch_program = link_compute_program("shaders/compute_shader_dispatch.glsl");
+
+    // Lists of large frames have more groups than a dispatch may have along x, so they wrap into rows of this many:
+    GLint max_group_count;
+
+    glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_COUNT, 0, &max_group_count);
+    check_error(dbg_domain, "Failed to retrieve maximum work group count");
+
+    glUniform1ui(get_uniform_location(compute_programs->dispatch_program, "max_group_count"), (GLuint)max_group_count);
+    check_error(dbg_domain, "Failed to assign to constant uniform (max_group_count)");
+}
+
+static GLuint create_hue_texture(const char* file_path)
+{
+    const char dbg_domain[] = "Creating texture";
+
+    // Read all the bytes:
+    uint8_t* texture_data;
+    int length = read_all_bytes(file_path, 0, &texture_data);
+
+    // How many pixels are there?
+    GLsizei pixels_count = length / 4;
+
+    // TODO: Check PoT
+
+    // Generate a texture handle:
+    GLuint texture_handle;
+
+    glGenTextures(1, &texture_handle);
+    check_error(dbg_domain, "Failed to generate texture handle");
+
+    // Bind our texture:
+    glBindTexture(GL_TEXTURE_2D, texture_handle);
+    check_error(dbg_domain, "Failed to bind texture");
+
+    // Set wrapping mode:
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    check_error(dbg_domain, "Failed to set wrapping for s");
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    check_error(dbg_domain, "Failed to set wrapping for t");
+
+    // Provide the bytes:
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, pixels_count, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, (const GLvoid*)texture_data);
+    check_error(dbg_domain, "Failed to push texture data (2D)");
+
+    // Free the texture data:
+    free(texture_data);
+
+    // Set min filter:
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    check_error(dbg_domain, "Failed to set texture minification filter");
+
+    // Set mag filter:
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    check_error(dbg_domain, "Failed to set texture magnification filter");
+
+    return texture_handle;
+}
+
+void init_textures(GLuint* hue_texture_handles)
+{
+    printf("Uploading textures ...\n");
+
+    // Activate the texture unit:
+    glActiveTexture(GL_TEXTURE0 + HUE_TEXTURE_UNIT);
+    check_error("Initializing textures", "Failed to activate texture unit");
+
+    // Create the textures:
+    for (int i = 0; i < PALETTE_COUNT; i++)
+    {
+        hue_texture_handles[i] = create_hue_texture(palette_file_paths[i]);
+    }
+}
+
+static GLuint create_reference_orbit_texture(void)
+{
+    const char dbg_domain[] = "Creating reference orbit texture";
+
+    // Generate a texture handle:
+    GLuint texture_handle;
+
+    glGenTextures(1, &texture_handle);
+    check_error(dbg_domain, "Failed to generate texture handle");
+
+    // Bind it on its own unit, so the hue texture binding stays untouched:
+    glActiveTexture(GL_TEXTURE0 + REFERENCE_ORBIT_TEXTURE_UNIT);
+    check_error(dbg_domain, "Failed to activate texture unit");
+
+    glBindTexture(GL_TEXTURE_2D, texture_handle);
+    check_error(dbg_domain, "Failed to bind texture");
+
+    // Float textures are not filterable, so we have to go with nearest (the shader uses texelFetch anyway):
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    check_error(dbg_domain, "Failed to set texture minification filter");
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    check_error(dbg_domain, "Failed to set texture magnification filter");
+
+    glActiveTexture(GL_TEXTURE0 + HUE_TEXTURE_UNIT);
+    check_error(dbg_domain, "Failed to reactivate hue texture unit");
+
+    return texture_handle;
+}
+
+// Returns whether the reference has changed (which invalidates all deltas iterated so far):
+static int update_reference_orbit(user_info_t* user_info)
+{
+    const char dbg_domain[] = "Updating reference orbit";
+    reference_orbit_t* orbit = &user_info->reference_orbit;
+
+    // Where is the reference relative to the view?
+    double offset_x = dd_to_double(dd_sub(user_info->position[0], orbit->position[0]));
+    double offset_y = dd_to_double(dd_sub(user_info->position[1], orbit->position[1]));
+
+    double half_frame_x = (0.5 * user_info->window_size[0]) / user_info->scale;
+    double half_frame_y = (0.5 * user_info->window_size[1]) / user_info->scale;
+
+    // Very long orbits are truncated:
+    int orbit_iterations = MIN(user_info->iterations, user_info->max_reference_orbit_length - 1);
+
+    // Any reference in (or close to) the view will do, thanks to rebasing.
+    // We only replace it if it left the view:
+    int is_outdated = (orbit->length == 0) ||
+        (fabs(offset_x) > half_frame_x) ||
+        (fabs(offset_y) > half_frame_y);
+
+    // If it is just too short for the current iterations, we extend it (which keeps all deltas valid):
+    int is_too_short = !orbit->has_escaped && (orbit->iterations < orbit_iterations);
+
+    if (is_outdated)
+    {
+        // Take the view center as the new reference:
+        compute_reference_orbit(orbit, user_info->position, orbit_iterations, REFERENCE_ORBIT_ROW_LENGTH);
+    }
+    else if (is_too_short)
+    {
+        extend_reference_orbit(orbit, orbit_iterations, REFERENCE_ORBIT_ROW_LENGTH);
+    }
+    else
+    {
+        return 0;
+    }
+
+    // Upload it:
+    GLsizei rows = (orbit->length + (REFERENCE_ORBIT_ROW_LENGTH - 1)) / REFERENCE_ORBIT_ROW_LENGTH;
+
+    glActiveTexture(GL_TEXTURE0 + REFERENCE_ORBIT_TEXTURE_UNIT);
+    check_error(dbg_domain, "Failed to activate texture unit");
+
+    glBindTexture(GL_TEXTURE_2D, user_info->reference_orbit_texture_handle);
+    check_error(dbg_domain, "Failed to bind texture");
+
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32F, REFERENCE_ORBIT_ROW_LENGTH, rows, 0, GL_RG, GL_FLOAT, (const GLvoid*)orbit->points);
+    check_error(dbg_domain, "Failed to push reference orbit (2D)");
+
+    glActiveTexture(GL_TEXTURE0 + HUE_TEXTURE_UNIT);
+    check_error(dbg_domain, "Failed to reactivate hue texture unit");
+
+    return is_outdated;
+}
+
+static void bind_texture(GLuint texture_handle)
+{
+    // Bind the new texture:
+    glBindTexture(GL_TEXTURE_2D, texture_handle);
+    check_error("Binding hue texture", "Failed to bind hue texture");
+}
+
+void select_palette(user_info_t* user_info, int palette)
+{
+    user_info->palette = palette;
+
+    // The CPU renderer looks the colors up itself:
+    if (!user_info->is_cpu_rendering)
+    {
+        bind_texture(user_info->hue_texture_handles[palette]);
+    }
+}
+
+static void init_escape_state(escape_state_t* escape_state, int is_compute_supported)
+{
+    const char dbg_domain[] = "Initializing escape state";
+
+    glGenFramebuffers(2, escape_state->framebuffers);
+    check_error(dbg_domain, "Failed to generate framebuffers");
+
+    glGenTextures(2, escape_state->iteration_state_textures);
+    check_error(dbg_domain, "Failed to generate iteration state textures");
+
+    glGenTextures(2, escape_state->orbit_state_textures);
+    check_error(dbg_domain, "Failed to generate orbit state textures");
+
+    glGenTextures(2, escape_state->checkpoint_state_textures);
+    check_error(dbg_domain, "Failed to generate checkpoint state textures");
+
+    glGenQueries(1, &escape_state->convergence_query);
+    check_error(dbg_domain, "Failed to generate convergence query");
+
+    escape_state->current = 0;
+    escape_state->size[0] = 0;
+    escape_state->size[1] = 0;
+
+    escape_state->is_valid = 0;
+    escape_state->is_converged = 0;
+    escape_state->is_hybrid = 0;
+    escape_state->generation = 0;
+    escape_state->is_convergence_query_pending = 0;
+    escape_state->convergence_query_generation = 0;
+
+    // The compute path (the lists are allocated along with the textures):
+    escape_state->active_pixel_buffers[0] = 0;
+    escape_state->active_pixel_buffers[1] = 0;
+    escape_state->active_pixel_counter = 0;
+    escape_state->dispatch_buffer = 0;
+    escape_state->active_pixel_list = 0;
+    escape_state->is_active_pixel_list_valid = 0;
+
+    if (is_compute_supported)
+    {
+        glGenBuffers(2, escape_state->active_pixel_buffers);
+        check_error(dbg_domain, "Failed to generate active pixel buffers");
+
+        glGenBuffers(1, &escape_state->active_pixel_counter);
+        check_error(dbg_domain, "Failed to generate active pixel counter");
+
+        glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, escape_state->active_pixel_counter);
+        check_error(dbg_domain, "Failed to bind active pixel counter");
+
+        glBufferData(GL_ATOMIC_COUNTER_BUFFER, sizeof(GLuint), NULL, GL_DYNAMIC_DRAW);
+        check_error(dbg_domain, "Failed to allocate active pixel counter");
+
+        // The group counts (x, y and z) and the length of the list:
+        const GLuint empty_dispatch[4] = { 0, 1, 1, 0 };
+
+        glGenBuffers(1, &escape_state->dispatch_buffer);
+        check_error(dbg_domain, "Failed to generate dispatch buffer");
+
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, escape_state->dispatch_buffer);
+        check_error(dbg_domain, "Failed to bind dispatch buffer");
+
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(empty_dispatch), empty_dispatch, GL_DYNAMIC_DRAW);
+        check_error(dbg_domain, "Failed to allocate dispatch buffer");
+    }
+}
+
+static void resize_escape_state(escape_state_t* escape_state, int width, int height)
+{
+    const char dbg_domain[] = "Resizing escape state";
+
+    // Integer textures must not be filtered:
+    GLuint* textures[3] = { escape_state->iteration_state_textures, escape_state->orbit_state_textures, escape_state->checkpoint_state_textures };
+    GLenum internal_formats[3] = { GL_R32UI, GL_RGBA32UI, GL_RGBA32UI };
+
+    // Image units (compute path) need immutable textures, so we replace them instead of reallocating:
+    for (int kind = 0; kind < 3; kind++)
+    {
+        glDeleteTextures(2, textures[kind]);
+        check_error(dbg_domain, "Failed to delete state textures");
+
+        glGenTextures(2, textures[kind]);
+        check_error(dbg_domain, "Failed to generate state textures");
+    }
+
+    glActiveTexture(GL_TEXTURE0 + ITERATION_STATE_TEXTURE_UNIT);
+    check_error(dbg_domain, "Failed to activate texture unit");
+
+    for (int side = 0; side < 2; side++)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, escape_state->framebuffers[side]);
+        check_error(dbg_domain, "Failed to bind framebuffer");
+
+        for (int kind = 0; kind < 3; kind++)
+        {
+            glBindTexture(GL_TEXTURE_2D, textures[kind][side]);
+            check_error(dbg_domain, "Failed to bind texture");
+
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            check_error(dbg_domain, "Failed to set texture minification filter");
+
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            check_error(dbg_domain, "Failed to set texture magnification filter");
+
+            glTexStorage2D(GL_TEXTURE_2D, 1, internal_formats[kind], width, height);
+            check_error(dbg_domain, "Failed to allocate state texture");
+
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + kind, GL_TEXTURE_2D, textures[kind][side], 0);
+            check_error(dbg_domain, "Failed to attach state texture");
+        }
+
+        // Render into all state textures:
+        GLenum draw_buffers[3] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
+
+        glDrawBuffers(3, draw_buffers);
+        check_error(dbg_domain, "Failed to specify draw buffers");
+
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        {
+            fprintf(stderr, "[%s] Escape state framebuffer is incomplete.\n", dbg_domain);
+            exit(EXIT_FAILURE);
+        }
+
+        // New textures are undefined, but the escape pass looks for pending marks even on a reset:
+        const GLuint cleared_state[4] = { 0, 0, 0, 0 };
+
+        glClearBufferuiv(GL_COLOR, 0, cleared_state);
+        check_error(dbg_domain, "Failed to clear iteration state");
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    check_error(dbg_domain, "Failed to bind default framebuffer");
+
+    glActiveTexture(GL_TEXTURE0 + HUE_TEXTURE_UNIT);
+    check_error(dbg_domain, "Failed to reactivate hue texture unit");
+
+    // A list can hold every pixel:
+    if (escape_state->active_pixel_buffers[0])
+    {
+        for (int list = 0; list < 2; list++)
+        {
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, escape_state->active_pixel_buffers[list]);
+            check_error(dbg_domain, "Failed to bind active pixel buffer");
+
+            glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint) * (size_t)width * height, NULL, GL_DYNAMIC_COPY);
+            check_error(dbg_domain, "Failed to allocate active pixel buffer");
+        }
+    }
+
+    escape_state->size[0] = width;
+    escape_state->size[1] = height;
+    escape_state->is_valid = 0;
+    escape_state->is_active_pixel_list_valid = 0;
+}
+
+static void delete_escape_state(escape_state_t* escape_state)
+{
+    const char dbg_domain[] = "Deleting escape state";
+
+    glDeleteFramebuffers(2, escape_state->framebuffers);
+    check_error(dbg_domain, "Failed to delete framebuffers");
+
+    glDeleteTextures(2, escape_state->iteration_state_textures);
+    check_error(dbg_domain, "Failed to delete iteration state textures");
+
+    glDeleteTextures(2, escape_state->orbit_state_textures);
+    check_error(dbg_domain, "Failed to delete orbit state textures");
+
+    glDeleteTextures(2, escape_state->checkpoint_state_textures);
+    check_error(dbg_domain, "Failed to delete checkpoint state textures");
+
+    glDeleteQueries(1, &escape_state->convergence_query);
+    check_error(dbg_domain, "Failed to delete convergence query");
+
+    // (Deleting buffer 0 is a no-op, so this is fine without the compute path.)
+    glDeleteBuffers(2, escape_state->active_pixel_buffers);
+    check_error(dbg_domain, "Failed to delete active pixel buffers");
+
+    glDeleteBuffers(1, &escape_state->active_pixel_counter);
+    check_error(dbg_domain, "Failed to delete active pixel counter");
+
+    glDeleteBuffers(1, &escape_state->dispatch_buffer);
+    check_error(dbg_domain, "Failed to delete dispatch buffer");
+}
+
+// Bind one side of the escape state for reading:
+static void bind_escape_state(const escape_state_t* escape_state, int side)
+{
+    const char dbg_domain[] = "Binding escape state";
+
+    glActiveTexture(GL_TEXTURE0 + ITERATION_STATE_TEXTURE_UNIT);
+    check_error(dbg_domain, "Failed to activate texture unit");
+
+    glBindTexture(GL_TEXTURE_2D, escape_state->iteration_state_textures[side]);
+    check_error(dbg_domain, "Failed to bind iteration state texture");
+
+    glActiveTexture(GL_TEXTURE0 + ORBIT_STATE_TEXTURE_UNIT);
+    check_error(dbg_domain, "Failed to activate texture unit");
+
+    glBindTexture(GL_TEXTURE_2D, escape_state->orbit_state_textures[side]);
+    check_error(dbg_domain, "Failed to bind orbit state texture");
+
+    glActiveTexture(GL_TEXTURE0 + CHECKPOINT_STATE_TEXTURE_UNIT);
+    check_error(dbg_domain, "Failed to activate texture unit");
+
+    glBindTexture(GL_TEXTURE_2D, escape_state->checkpoint_state_textures[side]);
+    check_error(dbg_domain, "Failed to bind checkpoint state texture");
+
+    glActiveTexture(GL_TEXTURE0 + HUE_TEXTURE_UNIT);
+    check_error(dbg_domain, "Failed to reactivate hue texture unit");
+}
+
+// Write a rectangle of iteration state (rows from bottom to top) into the current side, as far as it is inside:
+static void write_iteration_state(escape_state_t* escape_state, int x, int y, int width, int height, const uint32_t* iteration_state)
+{
+    const char dbg_domain[] = "Writing iteration state";
+
+    int x0 = MAX(x, 0);
+    int y0 = MAX(y, 0);
+    int x1 = MIN(x + width, escape_state->size[0]);
+    int y1 = MIN(y + height, escape_state->size[1]);
+
+    if ((x0 >= x1) || (y0 >= y1))
+    {
+        return;
+    }
+
+    glActiveTexture(GL_TEXTURE0 + ITERATION_STATE_TEXTURE_UNIT);
+    check_error(dbg_domain, "Failed to activate texture unit");
+
+    glBindTexture(GL_TEXTURE_2D, escape_state->iteration_state_textures[escape_state->current]);
+    check_error(dbg_domain, "Failed to bind iteration state texture");
+
+    // Skip the part that is outside:
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, width);
+    glPixelStorei(GL_UNPACK_SKIP_PIXELS, x0 - x);
+    glPixelStorei(GL_UNPACK_SKIP_ROWS, y0 - y);
+    check_error(dbg_domain, "Failed to set unpack parameters");
+
+    glTexSubImage2D(GL_TEXTURE_2D, 0, x0, y0, x1 - x0, y1 - y0, GL_RED_INTEGER, GL_UNSIGNED_INT, iteration_state);
+    check_error(dbg_domain, "Failed to upload iteration state");
+
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+    glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+    check_error(dbg_domain, "Failed to reset unpack parameters");
+
+    glActiveTexture(GL_TEXTURE0 + HUE_TEXTURE_UNIT);
+    check_error(dbg_domain, "Failed to reactivate hue texture unit");
+}
+
+// A new view: hand a share of the tiles to the CPU and mark them as pending (so the escape pass leaves them alone):
+static void start_hybrid_tiles(user_info_t* user_info, int is_hybrid)
+{
+    const char dbg_domain[] = "Starting hybrid tiles";
+    escape_state_t* escape_state = &user_info->escape_state;
+
+    // The marks of the last view must not survive the reset:
+    if (escape_state->is_hybrid)
+    {
+        const GLuint cleared_state[4] = { 0, 0, 0, 0 };
+
+        glBindFramebuffer(GL_FRAMEBUFFER, escape_state->framebuffers[escape_state->current]);
+        check_error(dbg_domain, "Failed to bind escape state framebuffer");
+
+        glClearBufferuiv(GL_COLOR, 0, cleared_state);
+        check_error(dbg_domain, "Failed to clear iteration state");
+
+        glBindFramebuffer(GL_FRAMEBUFFER, user_info->target_framebuffer);
+        check_error(dbg_domain, "Failed to bind target framebuffer");
+    }
+
+    escape_state->is_hybrid = is_hybrid;
+
+    if (!is_hybrid)
+    {
+        // The CPU may still be busy with the last view:
+        stop_hybrid_view(&user_info->hybrid_renderer);
+
+        return;
+    }
+
+    viewport_t viewport = get_viewport(user_info);
+    int tile_count;
+    const hybrid_tile_t* tiles = start_hybrid_view(&user_info->hybrid_renderer, &viewport, &tile_count);
+
+    static uint32_t pending_states[HYBRID_TILE_SIZE * HYBRID_TILE_SIZE];
+    memset(pending_states, 0xFF, sizeof(pending_states));
+
+    for (int i = 0; i < tile_count; i++)
+    {
+        write_iteration_state(escape_state, tiles[i].x, tiles[i].y, tiles[i].width, tiles[i].height, pending_states);
+    }
+}
+
+// Write the tiles the CPU has finished into the escape state (they have moved along if we have panned since):
+static void collect_hybrid_tiles(user_info_t* user_info)
+{
+    hybrid_renderer_t* hybrid_renderer = &user_info->hybrid_renderer;
+
+    if (user_info->escape_state.is_converged)
+    {
+        finish_hybrid_gpu_tiles(hybrid_renderer);
+    }
+
+    hybrid_result_t* result = take_hybrid_results(hybrid_renderer);
+
+    while (result)
+    {
+        const hybrid_tile_t* tile = &result->tile;
+        hybrid_result_t* next = result->next;
+
+        write_iteration_state(&user_info->escape_state, tile->x - hybrid_renderer->offset[0], tile->y - hybrid_renderer->offset[1], tile->width, tile->height, result->iteration_state);
+
+        free(result);
+        result = next;
+    }
+}
+
+int is_frame_complete(const user_info_t* user_info)
+{
+    return user_info->escape_state.is_converged && (!user_info->escape_state.is_hybrid || (user_info->hybrid_renderer.pending_tile_count == 0));
+}
+
+static precision_tier_t select_precision_tier(const user_info_t* user_info)
+{
+    // How large is a (framebuffer) pixel in the Gaussian plane?
+    double pixel_size = user_info->window_size[0] / (user_info->framebuffer_size[0] * user_info->scale);
+
+    // How large do |c| and |z| get in the view? z stays within the escape radius until it breaks out:
+    double half_frame_x = (0.5 * user_info->window_size[0]) / user_info->scale;
+    double half_frame_y = (0.5 * user_info->window_size[1]) / user_info->scale;
+
+    double max_magnitude = MAX(hypot(fabs(user_info->position[0].hi) + half_frame_x, fabs(user_info->position[1].hi) + half_frame_y), 2.0);
+
+    // The tiers are ordered by cost, so take the first one that resolves a pixel (and that we have):
+    for (int tier = 0; tier < PRECISION_TIER_COUNT; tier++)
+    {
+        if (((tier != PRECISION_TIER_FP64) || user_info->is_fp64_supported) && pixel_size >= (PRECISION_TIER_SAFETY_FACTOR * precision_tier_epsilons[tier] * max_magnitude))
+        {
+            return (precision_tier_t)tier;
+        }
+    }
+
+    return PRECISION_TIER_PERTURBATION;
+}
+
+// Panning by whole pixels keeps most of the escape state valid, just shifted.
+// Returns whether the state can be reused this way (anything else would put the old pixels off the requested grid):
+static int compute_pixel_shift(const user_info_t* user_info, int* pixel_shift)
+{
+    const escape_state_t* escape_state = &user_info->escape_state;
+
+    pixel_shift[0] = 0;
+    pixel_shift[1] = 0;
+
+    // Zooming or switching tiers changes every pixel:
+    if (!escape_state->is_valid || (escape_state->scale != user_info->scale) || (escape_state->precision_tier != user_info->precision_tier))
+    {
+        return 0;
+    }
+
+    for (int axis = 0; axis < 2; axis++)
+    {
+        // How many (framebuffer) pixels did we move?
+        double pixel_size = user_info->window_size[axis] / (user_info->framebuffer_size[axis] * user_info->scale);
+        double offset = dd_to_double(dd_sub(user_info->position[axis], escape_state->position[axis])) / pixel_size;
+        double shift = round(offset);
+
+        // Nothing left to reuse, or not on the grid of the state?
+        if ((fabs(shift) >= escape_state->size[axis]) || (fabs(offset - shift) > PIXEL_SHIFT_TOLERANCE))
+        {
+            return 0;
+        }
+
+        pixel_shift[axis] = (int)shift;
+    }
+
+    return 1;
+}
+
+// Provide the view uniforms an escape kernel (fragment or compute) of the current tier needs:
+static void provide_view_uniforms(user_info_t* user_info, const shader_program_t* shader_program, GLuint iteration_slice)
+{
+    char dbg_domain[] = "Providing view uniforms";
+    double gaussian_position[2];
+
+    if (user_info->precision_tier == PRECISION_TIER_PERTURBATION)
+    {
+        // The shader iterates the delta to the reference, so it gets the position relative to it.
+        // This is tiny at deep zooms, but float has plenty of exponent range for it:
+        gaussian_position[0] = dd_to_double(dd_sub(user_info->position[0], user_info->reference_orbit.position[0]));
+        gaussian_position[1] = dd_to_double(dd_sub(user_info->position[1], user_info->reference_orbit.position[1]));
+    }
+    else
+    {
+        gaussian_position[0] = dd_to_double(user_info->position[0]);
+        gaussian_position[1] = dd_to_double(user_info->position[1]);
+    }
+
+    // Provide Gaussian position and half frame as uniforms (as doubles for the fp64 tier):
+    double gaussian_half_frame[2] = { (0.5 * user_info->window_size[0]) / user_info->scale, (0.5 * user_info->window_size[1]) / user_info->scale };
+
+    if (user_info->precision_tier == PRECISION_TIER_FP64)
+    {
+        user_info->uniform_2d(shader_program->gaussian_position_uniform, gaussian_position[0], gaussian_position[1]);
+        check_error(dbg_domain, "Failed to provide uniform (gaussian_position)");
+
+        user_info->uniform_2d(shader_program->gaussian_half_frame_uniform, gaussian_half_frame[0], gaussian_half_frame[1]);
+        check_error(dbg_domain, "Failed to provide uniform (gaussian_half_frame)");
+    }
+    else
+    {
+        glUniform2f(shader_program->gaussian_position_uniform, (GLfloat)(gaussian_position[0]), (GLfloat)(gaussian_position[1]));
+        check_error(dbg_domain, "Failed to provide uniform (gaussian_position)");
+
+        glUniform2f(shader_program->gaussian_half_frame_uniform, (GLfloat)(gaussian_half_frame[0]), (GLfloat)(gaussian_half_frame[1]));
+        check_error(dbg_domain, "Failed to provide uniform (gaussian_half_frame)");
+    }
+
+    glUniform1ui(shader_program->iterations_uniform, (GLuint)(user_info->iterations));
+    check_error(dbg_domain, "Failed to provide uniform (iterations)");
+
+    glUniform1ui(shader_program->iteration_slice_uniform, iteration_slice);
+    check_error(dbg_domain, "Failed to provide uniform (iteration_slice)");
+
+    // A (framebuffer) pixel in the Gaussian plane:
+    double pixel_size = user_info->window_size[0] / (user_info->framebuffer_size[0] * user_info->scale);
+
+    glUniform1f(shader_program->periodicity_epsilon_uniform, (GLfloat)(PERIODICITY_EPSILON_FACTOR * pixel_size));
+    check_error(dbg_domain, "Failed to provide uniform (periodicity_epsilon)");
+
+    if (user_info->precision_tier == PRECISION_TIER_DF64)
+    {
+        // Split the position into two floats (hi + lo), so we keep ~48 bits of it:
+        GLfloat gaussian_position_hi[2] = { (GLfloat)(gaussian_position[0]), (GLfloat)(gaussian_position[1]) };
+        GLfloat gaussian_position_lo[2] =
+        {
+            (GLfloat)dd_to_double(dd_add_double(user_info->position[0], -gaussian_position_hi[0])),
+            (GLfloat)dd_to_double(dd_add_double(user_info->position[1], -gaussian_position_hi[1]))
+        };
+
+        glUniform2f(shader_program->gaussian_position_lo_uniform, gaussian_position_lo[0], gaussian_position_lo[1]);
+        check_error(dbg_domain, "Failed to provide uniform (gaussian_position_lo)");
+    }
+    else if (user_info->precision_tier == PRECISION_TIER_PERTURBATION)
+    {
+        glUniform1i(shader_program->reference_orbit_length_uniform, (GLint)(user_info->reference_orbit.length));
+        check_error(dbg_domain, "Failed to provide uniform (reference_orbit_length)");
+    }
+}
+
+// Run the escape kernel of the current tier once, advancing every active pixel by up to iteration_slice iterations.
+// The previous state is read shifted by pixel_shift (if we have panned since the last pass):
+static void run_escape_pass(user_info_t* user_info, int reset, const int* pixel_shift, GLuint iteration_slice)
+{
+    char dbg_domain[] = "Running escape pass";
+    escape_state_t* escape_state = &user_info->escape_state;
+
+    shader_program_t* shader_program = &user_info->shader_programs[user_info->precision_tier];
+
+    glUseProgram(shader_program->handle);
+    check_error(dbg_domain, "Failed to enable shader program");
+
+    provide_view_uniforms(user_info, shader_program, iteration_slice);
+
+    glUniform1i(shader_program->reset_uniform, reset);
+    check_error(dbg_domain, "Failed to provide uniform (reset)");
+
+    glUniform2i(shader_program->pixel_shift_uniform, pixel_shift[0], pixel_shift[1]);
+    check_error(dbg_domain, "Failed to provide uniform (pixel_shift)");
+
+    // Read from the current side and render into the other one:
+    bind_escape_state(escape_state, escape_state->current);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, escape_state->framebuffers[1 - escape_state->current]);
+    check_error(dbg_domain, "Failed to bind escape state framebuffer");
+
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    check_error(dbg_domain, "Failed to draw");
+
+    glBindFramebuffer(GL_FRAMEBUFFER, user_info->target_framebuffer);
+    check_error(dbg_domain, "Failed to bind target framebuffer");
+
+    escape_state->current = 1 - escape_state->current;
+
+    // This may have moved, finished or started any pixel, so the compute path has to list them again:
+    escape_state->is_active_pixel_list_valid = 0;
+}
+
+// The compute passes append to the list the current one doesn't read (starting from an empty one):
+static void bind_next_active_pixel_list(escape_state_t* escape_state)
+{
+    char dbg_domain[] = "Binding active pixel list";
+    const GLuint zero = 0;
+
+    glBindBufferBase(GL_ATOMIC_COUNTER_BUFFER, ACTIVE_PIXEL_COUNTER_BINDING, escape_state->active_pixel_counter);
+    check_error(dbg_domain, "Failed to bind active pixel counter");
+
+    glBufferSubData(GL_ATOMIC_COUNTER_BUFFER, 0, sizeof(GLuint), &zero);
+    check_error(dbg_domain, "Failed to reset active pixel counter");
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, NEXT_ACTIVE_PIXEL_BINDING, escape_state->active_pixel_buffers[1 - escape_state->active_pixel_list]);
+    check_error(dbg_domain, "Failed to bind next active pixel list");
+}
+
+// Size the next dispatch by the list we have just written (on the GPU, so we never wait for it) and make that list the current one:
+static void finish_active_pixel_list(user_info_t* user_info)
+{
+    char dbg_domain[] = "Finishing active pixel list";
+    escape_state_t* escape_state = &user_info->escape_state;
+
+    // The counter (and the state, for everything that reads it next) has to be written first:
+    glMemoryBarrier(GL_ATOMIC_COUNTER_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT |
+        GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+    check_error(dbg_domain, "Failed to insert memory barrier");
+
+    glUseProgram(user_info->compute_programs.dispatch_program);
+    check_error(dbg_domain, "Failed to enable shader program");
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DISPATCH_BINDING, escape_state->dispatch_buffer);
+    check_error(dbg_domain, "Failed to bind dispatch buffer");
+
+    glDispatchCompute(1, 1, 1);
+    check_error(dbg_domain, "Failed to dispatch");
+
+    // The next dispatch reads its size from there:
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+    check_error(dbg_domain, "Failed to insert memory barrier");
+
+    escape_state->active_pixel_list = 1 - escape_state->active_pixel_list;
+}
+
+// List the active pixels of the whole escape state (after the fragment kernels, which don't keep the list):
+static void gather_active_pixels(user_info_t* user_info)
+{
+    char dbg_domain[] = "Gathering active pixels";
+    escape_state_t* escape_state = &user_info->escape_state;
+
+    glUseProgram(user_info->compute_programs.gather_program);
+    check_error(dbg_domain, "Failed to enable shader program");
+
+    glUniform1ui(user_info->compute_programs.gather_iterations_uniform, (GLuint)(user_info->iterations));
+    check_error(dbg_domain, "Failed to provide uniform (iterations)");
+
+    bind_escape_state(escape_state, escape_state->current);
+    bind_next_active_pixel_list(escape_state);
+
+    glDispatchCompute((escape_state->size[0] + GATHER_GROUP_SIZE - 1) / GATHER_GROUP_SIZE, (escape_state->size[1] + GATHER_GROUP_SIZE - 1) / GATHER_GROUP_SIZE, 1);
+    check_error(dbg_domain, "Failed to dispatch");
+
+    finish_active_pixel_list(user_info);
+
+    escape_state->is_active_pixel_list_valid = 1;
+}
+
+// Like run_escape_pass (without reset or pixel shift), but with the compute kernel of the current tier, which only runs the active pixels.
+// Pixels that are done drop out of the list, so the lanes of the dispatch stay busy even where only a few pixels are left:
+static void run_compute_pass(user_info_t* user_info, GLuint iteration_slice)
+{
+    char dbg_domain[] = "Running compute pass";
+    escape_state_t* escape_state = &user_info->escape_state;
+
+    if (!escape_state->is_active_pixel_list_valid)
+    {
+        gather_active_pixels(user_info);
+    }
+
+    shader_program_t* shader_program = &user_info->compute_programs.escape_programs[user_info->precision_tier];
+
+    glUseProgram(shader_program->handle);
+    check_error(dbg_domain, "Failed to enable shader program");
+
+    provide_view_uniforms(user_info, shader_program, iteration_slice);
+
+    // The kernel updates the current side in place (reading the orbit and the checkpoint through their textures):
+    bind_escape_state(escape_state, escape_state->current);
+
+    glBindImageTexture(ITERATION_STATE_IMAGE_UNIT, escape_state->iteration_state_textures[escape_state->current], 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32UI);
+    check_error(dbg_domain, "Failed to bind iteration state image");
+
+    glBindImageTexture(ORBIT_STATE_IMAGE_UNIT, escape_state->orbit_state_textures[escape_state->current], 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32UI);
+    check_error(dbg_domain, "Failed to bind orbit state image");
+
+    glBindImageTexture(CHECKPOINT_STATE_IMAGE_UNIT, escape_state->checkpoint_state_textures[escape_state->current], 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32UI);
+    check_error(dbg_domain, "Failed to bind checkpoint state image");
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, ACTIVE_PIXEL_BINDING, escape_state->active_pixel_buffers[escape_state->active_pixel_list]);
+    check_error(dbg_domain, "Failed to bind active pixel list");
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DISPATCH_BINDING, escape_state->dispatch_buffer);
+    check_error(dbg_domain, "Failed to bind dispatch buffer");
+
+    bind_next_active_pixel_list(escape_state);
+
+    // One invocation per active pixel (the dispatch buffer has the size):
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, escape_state->dispatch_buffer);
+    check_error(dbg_domain, "Failed to bind dispatch indirect buffer");
+
+    glDispatchComputeIndirect(0);
+    check_error(dbg_domain, "Failed to dispatch");
+
+    finish_active_pixel_list(user_info);
+}
+
+// Ask the GPU whether any pixels are still active after the last escape pass:
+static void run_probe_pass(user_info_t* user_info)
+{
+    char dbg_domain[] = "Running probe pass";
+    escape_state_t* escape_state = &user_info->escape_state;
+
+    glUseProgram(user_info->probe_program.handle);
+    check_error(dbg_domain, "Failed to enable shader program");
+
+    glUniform1ui(user_info->probe_program.iterations_uniform, (GLuint)(user_info->iterations));
+    check_error(dbg_domain, "Failed to provide uniform (iterations)");
+
+    bind_escape_state(escape_state, escape_state->current);
+
+    // We only want the query result, so don't touch any pixels:
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    check_error(dbg_domain, "Failed to disable color writes");
+
+    glBeginQuery(GL_ANY_SAMPLES_PASSED_CONSERVATIVE, escape_state->convergence_query);
+    check_error(dbg_domain, "Failed to begin query");
+
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    check_error(dbg_domain, "Failed to draw");
+
+    glEndQuery(GL_ANY_SAMPLES_PASSED_CONSERVATIVE);
+    check_error(dbg_domain, "Failed to end query");
+
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    check_error(dbg_domain, "Failed to enable color writes");
+
+    escape_state->is_convergence_query_pending = 1;
+    escape_state->convergence_query_generation = escape_state->generation;
+}
+
+// Check (without blocking) whether the last probe found all pixels done:
+static void poll_convergence_query(escape_state_t* escape_state)
+{
+    char dbg_domain[] = "Polling convergence query";
+
+    if (!escape_state->is_convergence_query_pending)
+    {
+        return;
+    }
+
+    GLuint is_available;
+
+    glGetQueryObjectuiv(escape_state->convergence_query, GL_QUERY_RESULT_AVAILABLE, &is_available);
+    check_error(dbg_domain, "Failed to retrieve query availability");
+
+    if (!is_available)
+    {
+        return;
+    }
+
+    GLuint any_active;
+
+    glGetQueryObjectuiv(escape_state->convergence_query, GL_QUERY_RESULT, &any_active);
+    check_error(dbg_domain, "Failed to retrieve query result");
+
+    escape_state->is_convergence_query_pending = 0;
+
+    // Results from before the last reset don't tell us anything:
+    if (!any_active && (escape_state->convergence_query_generation == escape_state->generation))
+    {
+        escape_state->is_converged = 1;
+    }
+}
+
+static void run_colorize_pass(user_info_t* user_info)
+{
+    char dbg_domain[] = "Running colorize pass";
+
+    glUseProgram(user_info->colorize_program.handle);
+    check_error(dbg_domain, "Failed to enable shader program");
+
+    glUniform1ui(user_info->colorize_program.iterations_uniform, (GLuint)(user_info->iterations));
+    check_error(dbg_domain, "Failed to provide uniform (iterations)");
+
+    glUniform1f(user_info->colorize_program.hue_density_uniform, (GLfloat)(user_info->hue_density));
+    check_error(dbg_domain, "Failed to provide uniform (hue_density)");
+
+    glUniform1f(user_info->colorize_program.hue_offset_uniform, (GLfloat)(user_info->hue_offset));
+    check_error(dbg_domain, "Failed to provide uniform (hue_offset)");
+
+    bind_escape_state(&user_info->escape_state, user_info->escape_state.current);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, user_info->target_framebuffer);
+    check_error(dbg_domain, "Failed to bind target framebuffer");
+
+    // Clear the renderbuffer with the given clear color:
+    glClear(GL_COLOR_BUFFER_BIT);
+    check_error(dbg_domain, "Failed to clear renderbuffer");
+
+    // Draw a full-screen-quad:
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    check_error(dbg_domain, "Failed to draw");
+}
+
+// The current view in framebuffer pixels:
+viewport_t get_viewport(const user_info_t* user_info)
+{
+    viewport_t viewport;
+
+    viewport.position[0] = user_info->position[0];
+    viewport.position[1] = user_info->position[1];
+    viewport.scale = (user_info->scale * user_info->framebuffer_size[0]) / user_info->window_size[0];
+    viewport.size[0] = user_info->framebuffer_size[0];
+    viewport.size[1] = user_info->framebuffer_size[1];
+    viewport.iterations = user_info->iterations;
+
+    return viewport;
+}
+
+// Compare the frame we have just rendered with the CPU renderer (which iterates in double precision):
+void validate_frame(user_info_t* user_info)
+{
+    char dbg_domain[] = "Validating frame";
+    escape_state_t* escape_state = &user_info->escape_state;
+
+    viewport_t viewport = get_viewport(user_info);
+    int pixel_count = viewport.size[0] * viewport.size[1];
+
+    // Finish all iterations first:
+    if (!escape_state->is_converged)
+    {
+        int no_pixel_shift[2] = { 0, 0 };
+
+        run_escape_pass(user_info, 0, no_pixel_shift, (GLuint)(user_info->iterations));
+        escape_state->is_converged = 1;
+
+        run_colorize_pass(user_info);
+    }
+
+    uint32_t* iteration_state = malloc(pixel_count * sizeof(uint32_t));
+    uint8_t* gpu_pixels = malloc(4 * pixel_count);
+    uint8_t* cpu_pixels = malloc(4 * pixel_count);
+
+    if (!iteration_state || !gpu_pixels || !cpu_pixels)
+    {
+        fprintf(stderr, "[%s] Failed to allocate memory for %d pixels\n", dbg_domain, pixel_count);
+        exit(EXIT_FAILURE);
+    }
+
+    read_frame_pixels(user_info, gpu_pixels);
+
+    cpu_render_escape(&viewport, iteration_state, cpu_thread_count());
+    cpu_colorize(iteration_state, pixel_count, user_info->iterations, &user_info->hue_tables[user_info->palette], user_info->hue_density, user_info->hue_offset, cpu_pixels);
+
+    // Compare the colors:
+    int mismatches = 0;
+
+    for (int p = 0; p < pixel_count; p++)
+    {
+        if (memcmp(gpu_pixels + (4 * p), cpu_pixels + (4 * p), 3))
+        {
+            mismatches++;
+        }
+    }
+
+    printf("Validation (%s vs. CPU %s): %d of %d pixels differ\n", precision_tier_names[user_info->precision_tier], cpu_renderer_simd_name(), mismatches, pixel_count);
+
+    free(cpu_pixels);
+    free(gpu_pixels);
+    free(iteration_state);
+}
+
+void render_frame(user_info_t* user_info)
+{
+    escape_state_t* escape_state = &user_info->escape_state;
+
+    // Pick the cheapest tier that is still pixel-accurate:
+    if (!user_info->is_precision_tier_forced)
+    {
+        precision_tier_t precision_tier = select_precision_tier(user_info);
+
+        if (precision_tier != user_info->precision_tier)
+        {
+            user_info->precision_tier = precision_tier;
+            printf("Precision: %s\n", precision_tier_names[precision_tier]);
+        }
+    }
+
+    // The state has to match the framebuffer:
+    if ((escape_state->size[0] != user_info->framebuffer_size[0]) || (escape_state->size[1] != user_info->framebuffer_size[1]))
+    {
+        resize_escape_state(escape_state, user_info->framebuffer_size[0], user_info->framebuffer_size[1]);
+    }
+
+    // Did we just pan (then we keep whatever is still visible)?
+    int pixel_shift[2];
+    int is_shifted = compute_pixel_shift(user_info, pixel_shift) && ((pixel_shift[0] != 0) || (pixel_shift[1] != 0));
+
+    // Make sure the reference orbit is usable (a new one invalidates the state):
+    if ((user_info->precision_tier == PRECISION_TIER_PERTURBATION) && update_reference_orbit(user_info))
+    {
+        escape_state->is_valid = 0;
+    }
+
+    // Does the state still belong to the current view?
+    int is_moved = (escape_state->position[0].hi != user_info->position[0].hi) || (escape_state->position[0].lo != user_info->position[0].lo) ||
+        (escape_state->position[1].hi != user_info->position[1].hi) || (escape_state->position[1].lo != user_info->position[1].lo);
+
+    // The CPU helps while doubles are enough (they run out a few bits after df64, where perturbation takes over):
+    int is_hybrid = user_info->is_hybrid_rendering && (user_info->precision_tier != PRECISION_TIER_PERTURBATION);
+
+    // (The CPU doesn't keep the orbits of its pixels, so they can't continue at a raised limit.)
+    int reset = !escape_state->is_valid ||
+        (is_moved && !is_shifted) ||
+        (escape_state->scale != user_info->scale) ||
+        (escape_state->precision_tier != user_info->precision_tier) ||
+        (escape_state->is_hybrid != is_hybrid) ||
+        (is_hybrid && (user_info->iterations > escape_state->iterations));
+
+    if (reset)
+    {
+        escape_state->is_valid = 1;
+        escape_state->position[0] = user_info->position[0];
+        escape_state->position[1] = user_info->position[1];
+        escape_state->scale = user_info->scale;
+        escape_state->precision_tier = user_info->precision_tier;
+
+        escape_state->is_converged = 0;
+        escape_state->generation++;
+
+        start_hybrid_tiles(user_info, is_hybrid);
+    }
+    else if (is_shifted || (user_info->iterations > escape_state->iterations))
+    {
+        // The state keeps z and the count of every pixel, so raising the limit just continues the active ones.
+        // (Lowering it needs no iterations at all, the colorize pass clamps the counts.)
+        // Panning only leaves the newly exposed pixels to iterate:
+        escape_state->position[0] = user_info->position[0];
+        escape_state->position[1] = user_info->position[1];
+
+        escape_state->is_converged = 0;
+        escape_state->generation++;
+
+        // Pixels at the old limit are active again, but not on the list:
+        escape_state->is_active_pixel_list_valid = 0;
+
+        // The pending tiles move along:
+        if (escape_state->is_hybrid)
+        {
+            user_info->hybrid_renderer.offset[0] += pixel_shift[0];
+            user_info->hybrid_renderer.offset[1] += pixel_shift[1];
+        }
+    }
+    else
+    {
+        poll_convergence_query(escape_state);
+    }
+
+    escape_state->iterations = user_info->iterations;
+
+    // Advance the pixels that are still active:
+    if (!escape_state->is_converged)
+    {
+        if (user_info->is_progressive)
+        {
+            // The compute kernels only continue pixels, starting over and panning need the fragment kernels:
+            int is_compute_pass = user_info->is_compute_enabled && !reset && !is_shifted &&
+                user_info->compute_programs.escape_programs[user_info->precision_tier].handle;
+
+            if (is_compute_pass)
+            {
+                run_compute_pass(user_info, PROGRESSIVE_ITERATION_SLICE);
+            }
+            else
+            {
+                run_escape_pass(user_info, reset, pixel_shift, PROGRESSIVE_ITERATION_SLICE);
+            }
+
+            // One query at a time is plenty:
+            if (!escape_state->is_convergence_query_pending)
+            {
+                run_probe_pass(user_info);
+            }
+        }
+        else
+        {
+            // Everything at once, so we are done afterwards:
+            run_escape_pass(user_info, reset, pixel_shift, (GLuint)(user_info->iterations));
+            escape_state->is_converged = 1;
+        }
+    }
+
+    // Take over what the CPU has done:
+    if (escape_state->is_hybrid)
+    {
+        collect_hybrid_tiles(user_info);
+    }
+
+    // Map the escape state to colors (this is all we do if only the coloring has changed):
+    run_colorize_pass(user_info);
+
+    // Check it against the CPU renderer (if asked to):
+    if (user_info->is_validation_requested)
+    {
+        user_info->is_validation_requested = 0;
+        validate_frame(user_info);
+    }
+}
+
+void read_frame_pixels(user_info_t* user_info, uint8_t* pixels)
+{
+    char dbg_domain[] = "Reading frame";
+    int width = user_info->framebuffer_size[0];
+    int height = user_info->framebuffer_size[1];
+
+    glBindFramebuffer(GL_FRAMEBUFFER, user_info->target_framebuffer);
+    check_error(dbg_domain, "Failed to bind target framebuffer");
+
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    check_error(dbg_domain, "Failed to read pixels");
+
+    // GL rows go from bottom to top, ours from top to bottom:
+    uint8_t* row = malloc(4 * (size_t)width);
+
+    if (!row)
+    {
+        fprintf(stderr, "[%s] Failed to allocate memory for %d pixels\n", dbg_domain, width);
+        exit(EXIT_FAILURE);
+    }
+
+    for (int y = 0; y < (height / 2); y++)
+    {
+        uint8_t* top = pixels + (4 * (size_t)y * width);
+        uint8_t* bottom = pixels + (4 * (size_t)(height - 1 - y) * width);
+
+        memcpy(row, top, 4 * (size_t)width);
+        memcpy(top, bottom, 4 * (size_t)width);
+        memcpy(bottom, row, 4 * (size_t)width);
+    }
+
+    free(row);
+}
+
+void read_iteration_state(user_info_t* user_info, uint32_t* iteration_state)
+{
+    char dbg_domain[] = "Reading iteration state";
+    escape_state_t* escape_state = &user_info->escape_state;
+    int width = escape_state->size[0];
+    int height = escape_state->size[1];
+
+    // Integer attachments can only be read as RGBA (we keep the red channel):
+    uint32_t* texels = malloc(4 * sizeof(uint32_t) * (size_t)width * height);
+
+    if (!texels)
+    {
+        fprintf(stderr, "[%s] Failed to allocate memory for %d x %d pixels\n", dbg_domain, width, height);
+        exit(EXIT_FAILURE);
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, escape_state->framebuffers[escape_state->current]);
+    check_error(dbg_domain, "Failed to bind escape state framebuffer");
+
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    check_error(dbg_domain, "Failed to select iteration state");
+
+    glReadPixels(0, 0, width, height, GL_RGBA_INTEGER, GL_UNSIGNED_INT, texels);
+    check_error(dbg_domain, "Failed to read iteration state");
+
+    // GL rows go from bottom to top, ours from top to bottom:
+    for (int y = 0; y < height; y++)
+    {
+        const uint32_t* source = texels + (4 * (size_t)(height - 1 - y) * width);
+
+        for (int x = 0; x < width; x++)
+        {
+            iteration_state[((size_t)y * width) + x] = source[4 * x];
+        }
+    }
+
+    free(texels);
+}
+
+void init_gl_renderer(user_info_t* user_info)
+{
+    // Initialize our vertex data:
+    init_vertex_data(&user_info->vertex_buffer_object, &user_info->vertex_array_object);
+
+    // Initialize our shader programs and retrieve the uniform locations:
+    init_shader_program(&user_info->shader_programs[PRECISION_TIER_FLOAT], "shaders/vertex_shader.glsl", "shaders/fragment_shader.glsl");
+    init_shader_program(&user_info->shader_programs[PRECISION_TIER_DF64], "shaders/vertex_shader_df64.glsl", "shaders/fragment_shader_df64.glsl");
+
+    // Native doubles need a desktop GL 4 context (ES has none) and its entry point for double uniforms:
+    const char* version = (const char*)glGetString(GL_VERSION);
+
+    int is_es = version && !strncmp(version, "OpenGL ES", strlen("OpenGL ES"));
+
+    user_info->is_fp64_supported = user_info->uniform_2d && version && !is_es && (atoi(version) >= 4);
+
+    if (user_info->is_fp64_supported)
+    {
+        init_shader_program(&user_info->shader_programs[PRECISION_TIER_FP64], "shaders/vertex_shader_fp64.glsl", "shaders/fragment_shader_fp64.glsl");
+    }
+    else
+    {
+        // Deleting program 0 is a no-op:
+        user_info->shader_programs[PRECISION_TIER_FP64].handle = 0;
+    }
+    init_shader_program(&user_info->shader_programs[PRECISION_TIER_PERTURBATION], "shaders/vertex_shader.glsl", "shaders/fragment_shader_perturbation.glsl");
+
+    init_state_program(&user_info->colorize_program, "shaders/fragment_shader_colorize.glsl");
+    init_state_program(&user_info->probe_program, "shaders/fragment_shader_probe.glsl");
+
+    // Compute shaders need ES 3.1 (or desktop GL 4.5, which runs ES 3.1 shaders), WebGL 2 has none:
+    int version_number = (GLVersion.major * 10) + GLVersion.minor;
+
+    user_info->is_compute_supported = version && (is_es ? (version_number >= 31) : (version_number >= 45));
+    user_info->is_compute_enabled = user_info->is_compute_supported;
+
+    if (user_info->is_compute_supported)
+    {
+        init_compute_programs(&user_info->compute_programs);
+    }
+
+    // Release the shader compiler:
+    glReleaseShaderCompiler();
+    check_error("Initializing", "Failed to release the shader compiler");
+
+    // Create the escape state (allocated on the first frame):
+    init_escape_state(&user_info->escape_state, user_info->is_compute_supported);
+
+    // The CPU side of hybrid rendering (the workers start with the first hybrid view):
+    init_hybrid_renderer(&user_info->hybrid_renderer);
+
+    // Initialize the hue textures:
+    init_textures(user_info->hue_texture_handles);
+
+    // Create the (still empty) reference orbit texture:
+    user_info->reference_orbit_texture_handle = create_reference_orbit_texture();
+
+    // How long may the reference orbit get?
+    GLint max_texture_size;
+
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_texture_size);
+    check_error("Initializing", "Failed to retrieve maximum texture size");
+
+    user_info->max_reference_orbit_length = MIN(REFERENCE_ORBIT_ROW_LENGTH * max_texture_size, MAX_REFERENCE_ORBIT_LENGTH);
+
+    // Bind the selected palette:
+    select_palette(user_info, user_info->palette);
+}
+
+void delete_gl_renderer(user_info_t* user_info)
+{
+    // Delete the VAO:
+    glDeleteVertexArrays(1, &user_info->vertex_array_object);
+    check_error("Closing", "Failed to delete vertex array object");
+
+    // Delete the VBO:
+    glDeleteBuffers(1, &user_info->vertex_buffer_object);
+    check_error("Closing", "Failed to delete vertex buffer object");
+
+    // Delete the shader programs:
+    for (int i = 0; i < PRECISION_TIER_COUNT; i++)
+    {
+        glDeleteProgram(user_info->shader_programs[i].handle);
+        check_error("Closing", "Failed to delete shader program");
+    }
+
+    glDeleteProgram(user_info->colorize_program.handle);
+    check_error("Closing", "Failed to delete colorize program");
+
+    if (user_info->is_compute_supported)
+    {
+        for (int i = 0; i < PRECISION_TIER_COUNT; i++)
+        {
+            glDeleteProgram(user_info->compute_programs.escape_programs[i].handle);
+            check_error("Closing", "Failed to delete compute program");
+        }
+
+        glDeleteProgram(user_info->compute_programs.gather_program);
+        check_error("Closing", "Failed to delete gather program");
+
+        glDeleteProgram(user_info->compute_programs.dispatch_program);
+        check_error("Closing", "Failed to delete dispatch program");
+    }
+
+    glDeleteProgram(user_info->probe_program.handle);
+    check_error("Closing", "Failed to delete probe program");
+
+    // Delete the escape state:
+    delete_escape_state(&user_info->escape_state);
+
+    // Stop the hybrid workers:
+    delete_hybrid_renderer(&user_info->hybrid_renderer);
+
+    // Delete hue textures:
+    glDeleteTextures(PALETTE_COUNT, user_info->hue_texture_handles);
+    check_error("Closing", "Failed to delete hue textures");
+
+    // Delete the reference orbit:
+    glDeleteTextures(1, &user_info->reference_orbit_texture_handle);
+    check_error("Closing", "Failed to delete reference orbit texture");
+}
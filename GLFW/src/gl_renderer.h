@@ -0,0 +1,47 @@
+#ifndef GL_RENDERER_H
+#define GL_RENDERER_H
+
+#include <stdint.h>
+
+#include <glad/glad.h>
+
+#include "user_info.h"
+#include "viewport.h"
+
+// The GL renderer works on whatever OpenGL ES 3 context is current (a window or an offscreen one).
+// It iterates into the escape state and colorizes into user_info->target_framebuffer.
+
+// Check for an OpenGL error if we are debugging (exits on failure):
+void check_error(const char* dbg_domain, const char* error_text);
+
+void init_gl_features(void);
+void init_vertex_data(GLuint* vertex_buffer_object, GLuint* vertex_array_object);
+void init_shader_program(shader_program_t* shader_program, const char* vertex_shader_path, const char* fragment_shader_path);
+void init_state_program(state_program_t* state_program, const char* fragment_shader_path);
+void init_textures(GLuint* hue_texture_handles);
+
+// Create everything the renderer needs on the GPU (shaders, escape state, textures) and release it again:
+void init_gl_renderer(user_info_t* user_info);
+void delete_gl_renderer(user_info_t* user_info);
+
+void select_palette(user_info_t* user_info, int palette);
+
+// The current view in framebuffer pixels:
+viewport_t get_viewport(const user_info_t* user_info);
+
+// Render a frame (in progressive mode, the escape state only advances by a slice, so call it until escape_state.is_converged):
+void render_frame(user_info_t* user_info);
+
+// Is every pixel of the frame done (on the GPU and, in hybrid mode, on the CPU)? Until then, keep calling render_frame:
+int is_frame_complete(const user_info_t* user_info);
+
+// Read the rendered frame back as RGBA8 (rows from top to bottom):
+void read_frame_pixels(user_info_t* user_info, uint8_t* pixels);
+
+// Read the escape state back as iteration state (same layout as the CPU renderer's, rows from top to bottom):
+void read_iteration_state(user_info_t* user_info, uint32_t* iteration_state);
+
+// Compare the frame we have just rendered with the CPU renderer (which iterates in double precision):
+void validate_frame(user_info_t* user_info);
+
+#endif
@@ -0,0 +1,45 @@
+#include "hue_table.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "file_io.h"
+
+const char* const palette_names[PALETTE_COUNT] = { "fire", "ice", "ash", "psychedelic" };
+
+const char* const palette_file_paths[PALETTE_COUNT] =
+{
+    "textures/fire.rgba",
+    "textures/ice.rgba",
+    "textures/ash.rgba",
+    "textures/psychedelic.rgba"
+};
+
+void load_hue_table(hue_table_t* hue_table, const char* file_path)
+{
+    int length = read_all_bytes(file_path, 0, &hue_table->texels);
+
+    // How many texels are there?
+    hue_table->length = length / 4;
+}
+
+int find_palette(const char* name)
+{
+    for (int i = 0; i < PALETTE_COUNT; i++)
+    {
+        if (!strcmp(name, palette_names[i]))
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+void free_hue_table(hue_table_t* hue_table)
+{
+    free(hue_table->texels);
+
+    hue_table->texels = NULL;
+    hue_table->length = 0;
+}
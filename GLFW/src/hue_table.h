@@ -0,0 +1,31 @@
+#ifndef HUE_TABLE_H
+#define HUE_TABLE_H
+
+#include <stdint.h>
+
+// The palettes (.rgba files with one row of RGBA8 texels, also uploaded as hue textures):
+#define PALETTE_COUNT 4
+
+extern const char* const palette_names[PALETTE_COUNT];
+extern const char* const palette_file_paths[PALETTE_COUNT];
+
+// A palette on the CPU side:
+typedef struct _hue_table_t_
+{
+    // RGBA8 texels:
+    uint8_t* texels;
+
+    // The number of texels:
+    int length;
+} hue_table_t;
+
+// Load a palette from its .rgba file (exits on failure):
+void load_hue_table(hue_table_t* hue_table, const char* file_path);
+
+// Look up a palette by name (returns -1 if there is none):
+int find_palette(const char* name);
+
+// Release the palette's memory:
+void free_hue_table(hue_table_t* hue_table);
+
+#endif
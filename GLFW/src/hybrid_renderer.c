@@ -0,0 +1,326 @@
+#include "hybrid_renderer.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "cpu_renderer.h"
+
+// The CPU starts with this share of the pixels, and always keeps a bit of work on both sides (so we can still measure them):
+#define INITIAL_CPU_SHARE 0.25
+#define MIN_CPU_SHARE 0.05
+#define MAX_CPU_SHARE 0.95
+
+// How much a finished view moves the share towards its measured balance (the rest is history, which smooths out odd views):
+#define CPU_SHARE_ADAPTATION 0.5
+
+// Macros:
+#define MIN(a, b) (((a) < (b)) ? (a) : (b))
+#define MAX(a, b) (((a) > (b)) ? (a) : (b))
+
+static double get_time(void)
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return time.tv_sec + (1e-9 * time.tv_nsec);
+}
+
+static void* run_worker(void* arg)
+{
+    hybrid_renderer_t* renderer = arg;
+
+    for (;;)
+    {
+        // Wait for a tile:
+        pthread_mutex_lock(&renderer->mutex);
+
+        while (!renderer->is_stopping && (renderer->next_tile >= renderer->tile_count))
+        {
+            pthread_cond_wait(&renderer->condition, &renderer->mutex);
+        }
+
+        if (renderer->is_stopping)
+        {
+            pthread_mutex_unlock(&renderer->mutex);
+            return NULL;
+        }
+
+        hybrid_tile_t tile = renderer->tiles[renderer->next_tile++];
+        viewport_t viewport = renderer->viewport;
+        unsigned int generation = renderer->generation;
+
+        pthread_mutex_unlock(&renderer->mutex);
+
+        // Render it (the viewport's rows go from top to bottom, the tile's from bottom to top):
+        hybrid_result_t* result = malloc(sizeof(hybrid_result_t) + (sizeof(uint32_t) * tile.width * tile.height));
+
+        if (!result)
+        {
+            fprintf(stderr, "Failed to allocate memory for a %d x %d tile\n", tile.width, tile.height);
+            exit(EXIT_FAILURE);
+        }
+
+        result->generation = generation;
+        result->tile = tile;
+
+        viewport_t tile_viewport = get_sub_viewport(&viewport, tile.x, viewport.size[1] - tile.y - tile.height, tile.width, tile.height);
+        cpu_render_escape(&tile_viewport, result->iteration_state, 1);
+
+        for (int y = 0; y < (tile.height / 2); y++)
+        {
+            uint32_t* top = result->iteration_state + ((size_t)y * tile.width);
+            uint32_t* bottom = result->iteration_state + ((size_t)(tile.height - 1 - y) * tile.width);
+
+            for (int x = 0; x < tile.width; x++)
+            {
+                uint32_t state = top[x];
+                top[x] = bottom[x];
+                bottom[x] = state;
+            }
+        }
+
+        // Push it (on failure, next is reloaded and we try again):
+        result->next = atomic_load(&renderer->results);
+
+        while (!atomic_compare_exchange_weak(&renderer->results, &result->next, result));
+    }
+}
+
+void init_hybrid_renderer(hybrid_renderer_t* renderer)
+{
+    renderer->threads = NULL;
+    renderer->thread_count = 0;
+
+    pthread_mutex_init(&renderer->mutex, NULL);
+    pthread_cond_init(&renderer->condition, NULL);
+
+    renderer->tiles = NULL;
+    renderer->tile_count = 0;
+    renderer->tile_capacity = 0;
+    renderer->next_tile = 0;
+    renderer->generation = 0;
+    renderer->is_stopping = 0;
+
+    atomic_init(&renderer->results, NULL);
+
+    renderer->cpu_share = INITIAL_CPU_SHARE;
+    renderer->pending_tile_count = 0;
+    renderer->assigned_share = 0;
+    renderer->start_time = 0;
+    renderer->cpu_end_time = 0;
+    renderer->gpu_end_time = 0;
+    renderer->offset[0] = 0;
+    renderer->offset[1] = 0;
+}
+
+void delete_hybrid_renderer(hybrid_renderer_t* renderer)
+{
+    pthread_mutex_lock(&renderer->mutex);
+    renderer->is_stopping = 1;
+    pthread_cond_broadcast(&renderer->condition);
+    pthread_mutex_unlock(&renderer->mutex);
+
+    for (int t = 0; t < renderer->thread_count; t++)
+    {
+        pthread_join(renderer->threads[t], NULL);
+    }
+
+    // Drop what nobody has picked up:
+    hybrid_result_t* result = atomic_exchange(&renderer->results, NULL);
+
+    while (result)
+    {
+        hybrid_result_t* next = result->next;
+        free(result);
+        result = next;
+    }
+
+    pthread_cond_destroy(&renderer->condition);
+    pthread_mutex_destroy(&renderer->mutex);
+
+    free(renderer->threads);
+    free(renderer->tiles);
+}
+
+static void start_workers(hybrid_renderer_t* renderer)
+{
+    // The GL thread keeps a core to feed the GPU:
+    int thread_count = MAX(1, cpu_thread_count() - 1);
+
+    renderer->threads = malloc(thread_count * sizeof(pthread_t));
+
+    if (!renderer->threads)
+    {
+        fprintf(stderr, "Failed to allocate memory for %d hybrid render threads\n", thread_count);
+        exit(EXIT_FAILURE);
+    }
+
+    // If we can't get threads (e.g. on the web), the GPU keeps all the tiles:
+    while ((renderer->thread_count < thread_count) && !pthread_create(&renderer->threads[renderer->thread_count], NULL, run_worker, renderer))
+    {
+        renderer->thread_count++;
+    }
+
+    printf("Hybrid rendering: %d CPU threads (%s)\n", renderer->thread_count, cpu_renderer_simd_name());
+}
+
+// Once both sides of a view are done, move the share towards the one where they would have finished at the same time:
+static void rebalance(hybrid_renderer_t* renderer)
+{
+    if ((renderer->cpu_end_time == 0) || (renderer->gpu_end_time == 0) || (renderer->assigned_share <= 0) || (renderer->assigned_share >= 1))
+    {
+        return;
+    }
+
+    // Pixels per second (a tiny epsilon keeps us finite if a side was done at once):
+    double cpu_rate = renderer->assigned_share / MAX(renderer->cpu_end_time - renderer->start_time, 1e-6);
+    double gpu_rate = (1 - renderer->assigned_share) / MAX(renderer->gpu_end_time - renderer->start_time, 1e-6);
+
+    double balanced_share = cpu_rate / (cpu_rate + gpu_rate);
+    double cpu_share = ((1 - CPU_SHARE_ADAPTATION) * renderer->cpu_share) + (CPU_SHARE_ADAPTATION * balanced_share);
+
+    renderer->cpu_share = MIN(MAX(cpu_share, MIN_CPU_SHARE), MAX_CPU_SHARE);
+
+    // Only once per view:
+    renderer->assigned_share = 0;
+}
+
+const hybrid_tile_t* start_hybrid_view(hybrid_renderer_t* renderer, const viewport_t* viewport, int* tile_count)
+{
+    if (!renderer->threads)
+    {
+        start_workers(renderer);
+    }
+
+    int width = viewport->size[0];
+    int height = viewport->size[1];
+    int columns = (width + HYBRID_TILE_SIZE - 1) / HYBRID_TILE_SIZE;
+    int rows = (height + HYBRID_TILE_SIZE - 1) / HYBRID_TILE_SIZE;
+
+    pthread_mutex_lock(&renderer->mutex);
+
+    if ((columns * rows) > renderer->tile_capacity)
+    {
+        free(renderer->tiles);
+
+        renderer->tile_capacity = columns * rows;
+        renderer->tiles = malloc(renderer->tile_capacity * sizeof(hybrid_tile_t));
+
+        if (!renderer->tiles)
+        {
+            fprintf(stderr, "Failed to allocate memory for %d hybrid tiles\n", renderer->tile_capacity);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // Spread the CPU tiles evenly (a golden ratio sequence), so both sides get their fair share of the expensive parts:
+    size_t cpu_pixel_count = 0;
+
+    renderer->tile_count = 0;
+
+    for (int k = 0; renderer->thread_count && (k < (columns * rows)); k++)
+    {
+        double position = fmod(k * 0.6180339887498949, 1.0);
+
+        if (position < renderer->cpu_share)
+        {
+            hybrid_tile_t tile = { .x = (k % columns) * HYBRID_TILE_SIZE, .y = (k / columns) * HYBRID_TILE_SIZE };
+
+            tile.width = MIN(HYBRID_TILE_SIZE, width - tile.x);
+            tile.height = MIN(HYBRID_TILE_SIZE, height - tile.y);
+
+            renderer->tiles[renderer->tile_count++] = tile;
+            cpu_pixel_count += (size_t)tile.width * tile.height;
+        }
+    }
+
+    renderer->viewport = *viewport;
+    renderer->next_tile = 0;
+    renderer->generation++;
+
+    pthread_cond_broadcast(&renderer->condition);
+    pthread_mutex_unlock(&renderer->mutex);
+
+    renderer->pending_tile_count = renderer->tile_count;
+    renderer->assigned_share = (double)cpu_pixel_count / ((double)width * height);
+    renderer->start_time = get_time();
+    renderer->cpu_end_time = (renderer->tile_count == 0) ? renderer->start_time : 0;
+    renderer->gpu_end_time = 0;
+    renderer->offset[0] = 0;
+    renderer->offset[1] = 0;
+
+    // Only the GL thread changes the tiles, so they stay valid until the next view:
+    *tile_count = renderer->tile_count;
+
+    return renderer->tiles;
+}
+
+void stop_hybrid_view(hybrid_renderer_t* renderer)
+{
+    pthread_mutex_lock(&renderer->mutex);
+
+    renderer->tile_count = 0;
+    renderer->next_tile = 0;
+    renderer->generation++;
+
+    pthread_mutex_unlock(&renderer->mutex);
+
+    renderer->pending_tile_count = 0;
+    renderer->assigned_share = 0;
+
+    // The stale results would pile up otherwise:
+    hybrid_result_t* result = take_hybrid_results(renderer);
+
+    while (result)
+    {
+        hybrid_result_t* next = result->next;
+        free(result);
+        result = next;
+    }
+}
+
+hybrid_result_t* take_hybrid_results(hybrid_renderer_t* renderer)
+{
+    // We are the only one taking, so there's no ABA problem:
+    hybrid_result_t* result = atomic_exchange(&renderer->results, NULL);
+    hybrid_result_t* current_results = NULL;
+
+    while (result)
+    {
+        hybrid_result_t* next = result->next;
+
+        if (result->generation == renderer->generation)
+        {
+            result->next = current_results;
+            current_results = result;
+
+            renderer->pending_tile_count--;
+        }
+        else
+        {
+            free(result);
+        }
+
+        result = next;
+    }
+
+    if (current_results && (renderer->pending_tile_count == 0))
+    {
+        renderer->cpu_end_time = get_time();
+        rebalance(renderer);
+    }
+
+    return current_results;
+}
+
+void finish_hybrid_gpu_tiles(hybrid_renderer_t* renderer)
+{
+    if (renderer->gpu_end_time == 0)
+    {
+        renderer->gpu_end_time = get_time();
+        rebalance(renderer);
+    }
+}
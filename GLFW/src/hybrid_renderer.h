@@ -0,0 +1,91 @@
+#ifndef HYBRID_RENDERER_H
+#define HYBRID_RENDERER_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+
+#include "viewport.h"
+
+// In hybrid mode, the CPU takes a share of the tiles of every new view off the GPU. Its tiles are marked as pending in the escape
+// state (the GPU leaves them alone), rendered by worker threads and handed back through a lock-free stack, so the GL thread never
+// waits for a worker. The share is rebalanced after every view, so the CPU and the GPU finish at the same time.
+
+// Tiles are (at most) this many pixels wide and high:
+#define HYBRID_TILE_SIZE 64
+
+// A rectangle of the escape state (rows from bottom to top, like the textures):
+typedef struct _hybrid_tile_t_
+{
+    int x;
+    int y;
+    int width;
+    int height;
+} hybrid_tile_t;
+
+// A tile the CPU has finished:
+typedef struct _hybrid_result_t_
+{
+    struct _hybrid_result_t_* next;
+
+    // The view it belongs to (older ones are dropped):
+    unsigned int generation;
+
+    hybrid_tile_t tile;
+
+    // width * height values (rows from bottom to top, ready for glTexSubImage2D):
+    uint32_t iteration_state[];
+} hybrid_result_t;
+
+typedef struct _hybrid_renderer_t_
+{
+    // The workers (none until the first view):
+    pthread_t* threads;
+    int thread_count;
+
+    // The view and the tiles the workers take (guarded by the mutex, the condition wakes them up):
+    pthread_mutex_t mutex;
+    pthread_cond_t condition;
+    viewport_t viewport;
+    hybrid_tile_t* tiles;
+    int tile_count;
+    int tile_capacity;
+    int next_tile;
+    unsigned int generation;
+    int is_stopping;
+
+    // Finished tiles, pushed by the workers and taken all at once by the GL thread:
+    _Atomic(hybrid_result_t*) results;
+
+    // The rest belongs to the GL thread.
+    // The fraction of the pixels the CPU gets:
+    double cpu_share;
+
+    // The current view: how many CPU tiles aren't in yet, which share of the pixels they have and when the sides finished (0 if not yet):
+    int pending_tile_count;
+    double assigned_share;
+    double start_time;
+    double cpu_end_time;
+    double gpu_end_time;
+
+    // How far we have panned since the view started (in escape state pixels), the tiles move with it:
+    int offset[2];
+} hybrid_renderer_t;
+
+void init_hybrid_renderer(hybrid_renderer_t* renderer);
+void delete_hybrid_renderer(hybrid_renderer_t* renderer);
+
+// Start a view (of the escape state, rows from top to bottom like every viewport), dropping whatever is left of the last one.
+// Picks the CPU tiles (spread evenly over the view) and returns them (valid until the next view), so the caller can mark them:
+const hybrid_tile_t* start_hybrid_view(hybrid_renderer_t* renderer, const viewport_t* viewport, int* tile_count);
+
+// Drop whatever is left of the current view (when the next one is GPU only):
+void stop_hybrid_view(hybrid_renderer_t* renderer);
+
+// Take the tiles the CPU has finished since the last call (a list, free each one after use). Stale ones are already dropped:
+hybrid_result_t* take_hybrid_results(hybrid_renderer_t* renderer);
+
+// The GPU has finished its tiles of the current view:
+void finish_hybrid_gpu_tiles(hybrid_renderer_t* renderer);
+
+#endif
@@ -3,6 +3,7 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #define GLFW_INCLUDE_NONE
 #include <GLFW/glfw3.h>
@@ -13,182 +14,125 @@
     #include <emscripten.h>
 #endif
 
+#include "cpu_renderer.h"
+#include "double_double.h"
+#include "gl_renderer.h"
+#include "hue_table.h"
+#include "reference_orbit.h"
+#include "tile_cache.h"
+#include "tile_store.h"
+#include "user_info.h"
+#include "viewport.h"
+
 // Limit position and scale:
 #define MIN_POSITION -3.0
 #define MAX_POSITION 3.0
 
 #define MIN_SCALE 75.0
-#define MAX_SCALE 100000000.0
-
-#define MIN_ITERATIONS 2
-#define MAX_ITERATIONS 1000
+#define MAX_SCALE 1e30
 
-// Do we currently debug?
-// Uncomment for OpenGL error checking!
-#define DEBUG
-
-// The vertex data (pretty simple):
-#define VERTEX_DATA_POSITION_ATTRIBUTE 0
+// Palette cycling speed (palettes per second):
+#define PALETTE_CYCLE_SPEED 0.1
 
 // Scale factors:
 #define MOUSE_WHEEL_FACTOR 0.25
 
+// The memory the CPU renderer may keep rendered tiles in:
+#define TILE_CACHE_MEMORY (256 << 20)
+
+// The size of a new tile store (it is sparse, so this is an upper bound):
+#define TILE_STORE_SIZE ((size_t)4 << 30)
+
 // Macros:
 #define MIN(a, b) (((a) < (b)) ? (a) : (b))
 #define MAX(a, b) (((a) > (b)) ? (a) : (b))
 
-#define CLAMPED_POSITION(v) (MIN(MAX((v), MIN_POSITION), MAX_POSITION))
 #define CLAMPED_SCALE(v) (MIN(MAX((v), MIN_SCALE), MAX_SCALE))
 
-typedef struct _vertex_data_t_
-{
-    GLfloat x;
-    GLfloat y;
-} vertex_data_t;
-
-// The shader program:
-typedef struct _shader_program_t_
-{
-    GLuint handle;
-    GLint gaussian_position_uniform;
-    GLint gaussian_half_frame_uniform;
-    GLint iterations_uniform;
-} shader_program_t;
-
-// The user info:
-typedef struct _user_info_t
-{
-    // The shader program and the uniforms:
-    shader_program_t shader_program;
-
-    // The hue texture handles:
-    GLuint hue_texture_handles[4];
-
-    // The current window size:
-    int window_size[2];
-
-    // The current cursor position:
-    double cursor_position[2];
-
-    // Are we panning?
-    int is_panning;
-
-    // The current position in the Gaussian plane:
-    double position[2];
-
-    // The current scale:
-    double scale;
-
-    // The current interations:
-    int iterations;
-} user_info_t;
-
 // Pre-define the callbacks:
 void error_callback(int error, const char* description);
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void window_size_callback(GLFWwindow* window, int width, int height);
+void window_refresh_callback(GLFWwindow* window);
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
 void mouse_button_callback(GLFWwindow* window, int button, int action, int mods);
 void cursor_pos_callback(GLFWwindow* window, double xoffset, double yoffset);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 
-// Read all bytes from a given file path.
-// The resulting pointer must be freed!
-int read_all_bytes(const char* file_path, int insert_trailing_zero, uint8_t** ptr)
+// Clamp a position component into the allowed range:
+double_double_t clamped_position(double_double_t value)
 {
-    // Try to open the file:
-    FILE* file = fopen(file_path, "rb");
-
-    if (!file)
+    if (value.hi < MIN_POSITION)
     {
-        fprintf(stderr, "Failed to open file: %s\n", file_path);
-        exit(EXIT_FAILURE);
-    }
-
-    // Seek the end:
-    if (fseek(file, 0, SEEK_END))
-    {
-        fprintf(stderr, "Failed to seek end of file: %s\n", file_path);
-        exit(EXIT_FAILURE);
+        return dd_from_double(MIN_POSITION);
     }
 
-    // Get the file length:
-    int file_length = ftell(file);
-    int buffer_length;
-
-    // Do we have to insert a trailing zero?
-    if (insert_trailing_zero)
+    if (value.hi > MAX_POSITION)
     {
-        buffer_length = file_length + 1;
-    }
-    else
-    {
-        buffer_length = file_length;
+        return dd_from_double(MAX_POSITION);
     }
 
-    // Rewind the file to the start:
-    rewind(file);
+    return value;
+}
 
-    // Allocate space:
-    *ptr = (uint8_t*)malloc(buffer_length);
+GLFWwindow* create_glfw_window(user_info_t* user_info, int is_desktop_gl_requested)
+{
+    printf("Creating window ...\n");
 
-    if (!*ptr)
-    {
-        fprintf(stderr, "Failed to allocate memory: %d bytes\n", buffer_length);
-        exit(EXIT_FAILURE);
-    }
+    GLFWwindow* window = NULL;
 
-    // Read all the bytes:
-    if (fread(*ptr, 1, file_length, file) != file_length)
+    // On request, we try a desktop OpenGL 4.3 core context first. It runs our ES shaders as well (ARB_ES3_compatibility) and adds native doubles:
+    if (is_desktop_gl_requested)
     {
-        fprintf(stderr, "Failed to read file contents: %s\n", file_path);
-        exit(EXIT_FAILURE);
+        glfwWindowHint(GLFW_CLIENT_API, GLFW_OPENGL_API);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+        // No depth and stencil buffer:
+        glfwWindowHint(GLFW_DEPTH_BITS, 0);
+        glfwWindowHint(GLFW_STENCIL_BITS, 0);
+
+        window = glfwCreateWindow(user_info->window_size[0], user_info->window_size[1], "Mandel-GL", NULL, NULL);
+
+        if (!window)
+        {
+            printf("Falling back to OpenGL ES ...\n");
+            glfwDefaultWindowHints();
+        }
     }
 
-    // Close the file:
-    fclose(file);
-
-    // Set the trailing zero:
-    if (insert_trailing_zero)
+    if (!window)
     {
-        (*ptr)[buffer_length - 1] = 0;
-    }
+        // We want an OpenGL ES 3.1 context:
+        glfwWindowHint(GLFW_CLIENT_API, GLFW_OPENGL_ES_API);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
 
-    return buffer_length;
-}
+        // Always for OpenGL ES:
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_ANY_PROFILE);
 
-// Check for an OpenGL error if we are not debugging:
-void check_error(const char* dbg_domain, const char* error_text)
-{
-#ifdef DEBUG
-    GLenum error = glGetError();
+        // No depth and stencil buffer:
+        glfwWindowHint(GLFW_DEPTH_BITS, 0);
+        glfwWindowHint(GLFW_STENCIL_BITS, 0);
 
-    if (error != GL_NO_ERROR)
-    {
-        printf("[%s] %s: %d\n", dbg_domain, error_text, error);
-        exit(EXIT_FAILURE);
+        // Spawn the window:
+        window = glfwCreateWindow(user_info->window_size[0], user_info->window_size[1], "Mandel-GL", NULL, NULL);
     }
-#endif
-}
 
-GLFWwindow* create_glfw_window(user_info_t* user_info)
-{
-    printf("Creating window ...\n");
-
-    // We want an OpenGL ES 3.1 context:
-    glfwWindowHint(GLFW_CLIENT_API, GLFW_OPENGL_ES_API);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
-
-    // Always for OpenGL ES:
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_ANY_PROFILE);
+    // No OpenGL ES 3? Then we render on the CPU and only need a legacy context to draw the pixels:
+    if (!window)
+    {
+        printf("Falling back to the CPU renderer ...\n");
 
-    // No depth and stencil buffer:
-    glfwWindowHint(GLFW_DEPTH_BITS, 0);
-    glfwWindowHint(GLFW_STENCIL_BITS, 0);
+        glfwDefaultWindowHints();
+        glfwWindowHint(GLFW_CLIENT_API, GLFW_OPENGL_API);
+        glfwWindowHint(GLFW_DEPTH_BITS, 0);
+        glfwWindowHint(GLFW_STENCIL_BITS, 0);
 
-    // Spawn the window:
-    GLFWwindow* window = glfwCreateWindow(user_info->window_size[0], user_info->window_size[1], "Mandel-GL", NULL, NULL);
+        window = glfwCreateWindow(user_info->window_size[0], user_info->window_size[1], "Mandel-GL", NULL, NULL);
+        user_info->is_cpu_rendering = 1;
+    }
 
     if (!window)
     {
@@ -199,6 +143,7 @@ GLFWwindow* create_glfw_window(user_info_t* user_info)
     // Register all the window callbacks:
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
     glfwSetWindowSizeCallback(window, window_size_callback);
+    glfwSetWindowRefreshCallback(window, window_refresh_callback);
     glfwSetKeyCallback(window, key_callback);
     glfwSetMouseButtonCallback(window, mouse_button_callback);
     glfwSetCursorPosCallback(window, cursor_pos_callback);
@@ -207,324 +152,66 @@ GLFWwindow* create_glfw_window(user_info_t* user_info)
     return window;
 }
 
-void init_gl_features()
+void advance_palette(user_info_t* user_info)
 {
-    printf("Initializing some GL features ...\n");
-    const char dbg_domain[] = "Initializing GL features";
-
-    // Disable alpha blending:
-    glDisable(GL_BLEND);
-    check_error(dbg_domain, "Failed to disable alpha blending");
-
-    // Disable the depth test:
-    glDisable(GL_DEPTH_TEST);
-    check_error(dbg_domain, "Failed to disable the depth test");
-
-    glDepthMask(GL_FALSE);
-    check_error(dbg_domain, "Failed to disable the depth mask");
-
-    // Disable the scissor test:
-    glDisable(GL_SCISSOR_TEST);
-    check_error(dbg_domain, "Failed to disable the scissor test");
-
-    // Disable the stencil test:
-    glDisable(GL_STENCIL_TEST);
-    check_error(dbg_domain, "Failed to disable the stencil test");
-
-    // Disable dithering:
-    glDisable(GL_DITHER);
-    check_error(dbg_domain, "Failed to disable dithering");
-}
-
-void init_vertex_data(GLuint* vertex_buffer_object, GLuint* vertex_array_object)
-{
-    printf("Uploading vertex data ...\n");
-    const char dbg_domain[] = "Initializing vertex data";
-
-    // Create and bind a dummy VAO (this is actually needed in desktop GL):
-    glGenVertexArrays(1, vertex_array_object);
-    check_error(dbg_domain, "Failed to generate VAO");
-
-    glBindVertexArray(*vertex_array_object);
-    check_error(dbg_domain, "Failed to bind VAO");
-
-    // Generate a VBO:
-    glGenBuffers(1, vertex_buffer_object);
-    check_error(dbg_domain, "Failed to generate VBO");
-
-    // Bind it:
-    glBindBuffer(GL_ARRAY_BUFFER, *vertex_buffer_object);
-    check_error(dbg_domain, "Failed to bind VBO");
-
-    // Create simple vertex data for the corners:
-    vertex_data_t vertex_data[] =
-    {
-        { .x = -1, .y = -1 },
-        { .x = +1, .y = -1 },
-        { .x = -1, .y = +1 },
-        { .x = +1, .y = +1 }
-    };
-
-    // Upload it:
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertex_data), (const GLvoid*)vertex_data, GL_STATIC_DRAW);
-    check_error(dbg_domain, "Failed to buffer vertex data");
-
-    // Enable the array:
-    glEnableVertexAttribArray(VERTEX_DATA_POSITION_ATTRIBUTE);
-    check_error(dbg_domain, "Failed to enable position attribute");
-
-    // Specify the vertex data:
-    glVertexAttribPointer(VERTEX_DATA_POSITION_ATTRIBUTE, 2, GL_FLOAT, GL_FALSE, sizeof(vertex_data_t), (GLvoid*)offsetof(vertex_data_t, x));
-    check_error(dbg_domain, "Failed to specify position attribute");
-}
-
-GLuint create_shader(GLenum shader_type, const char* file_path)
-{
-    const char dbg_domain[] = "Creating shader";
-
-    // Read all the bytes:
-    uint8_t* shader_source;
-    read_all_bytes(file_path, 1, &shader_source);
-
-    // Create a shader of our type:
-    GLuint shader_handle = glCreateShader(shader_type);
-    check_error(dbg_domain, "Failed to generate shader handle");
-
-    // Pass the shader source down to OpenGL:
-    glShaderSource(shader_handle, 1, (const GLchar**)&shader_source, NULL);
-    check_error(dbg_domain, "Failed to provide shader source code");
-
-    // Free the shader source:
-    free(shader_source);
-
-    // Compile the shader:
-    glCompileShader(shader_handle);
-    check_error(dbg_domain, "Failed to compile shader");
-
-    // Check if we had success:
-    GLint compilation_success;
-
-    glGetShaderiv(shader_handle, GL_COMPILE_STATUS, &compilation_success);
-    check_error(dbg_domain, "Failed to retrieve shader parameter");
-
-    if (compilation_success != (GLint)GL_TRUE)
+    if (user_info->is_palette_cycling)
     {
-        // Retrieve the error message:
-        char error_message[256];
+        double time = glfwGetTime();
 
-        glGetShaderInfoLog(shader_handle, 256, NULL, error_message);
-        check_error(dbg_domain, "Failed to retrieve shader info log");
-
-        // Print it and fail:
-        fprintf(stderr, "[%s] Failed to compile a shader: %s\n", dbg_domain, error_message);
-        exit(EXIT_FAILURE);
+        user_info->hue_offset = fmod(user_info->hue_offset + (PALETTE_CYCLE_SPEED * (time - user_info->palette_cycle_time)), 1.0);
+        user_info->palette_cycle_time = time;
     }
-
-    // Return the shader handle:
-    return shader_handle;
 }
 
-void init_shader_program(shader_program_t* shader_program)
+// Render on the CPU and present the image with glDrawPixels (if we have no OpenGL ES 3 context):
+void render_cpu_frame(user_info_t* user_info)
 {
-    printf("Compiling shaders ...\n");
-    const char dbg_domain[] = "Initializing shaders";
-
-    // Create the vertex shader:
-    GLuint vertex_shader_handle = create_shader(GL_VERTEX_SHADER, "shaders/vertex_shader.glsl");
-
-    // Create the fragment shader:
-    GLuint fragment_shader_handle = create_shader(GL_FRAGMENT_SHADER, "shaders/fragment_shader.glsl");
-
-    // Create the program:
-    shader_program->handle = glCreateProgram();
-    check_error(dbg_domain, "Failed to generate shader program handle");
-
-    // Attach the shaders:
-    glAttachShader(shader_program->handle, vertex_shader_handle);
-    check_error(dbg_domain, "Failed to attach vertex shader");
-
-    glAttachShader(shader_program->handle, fragment_shader_handle);
-    check_error(dbg_domain, "Failed to attach fragment shader");
-
-    // Link the program:
-    glLinkProgram(shader_program->handle);
-    check_error(dbg_domain, "Failed to link shader program");
-
-    // Check if we had success:
-    GLint linking_success;
-
-    glGetProgramiv(shader_program->handle, GL_LINK_STATUS, &linking_success);
-    check_error(dbg_domain, "Failed to retrieve shader program parameter");
-
-    if (linking_success != (GLint)GL_TRUE)
-    {
-        // Retrieve the error message:
-        char error_message[256];
-
-        glGetProgramInfoLog(shader_program->handle, 256, NULL, error_message);
-        check_error(dbg_domain, "Failed to retrieve shader program info log");
-
-        // Print it and fail:
-        fprintf(stderr, "[%s] Failed to link shader program: %s\n", dbg_domain, error_message);
-        exit(EXIT_FAILURE);
-    }
-
-    // After we have linked the program, it's a good idea to detach the shaders from it:
-    glDetachShader(shader_program->handle, vertex_shader_handle);
-    check_error(dbg_domain, "Failed to detach vertex shader");
-
-    glDetachShader(shader_program->handle, fragment_shader_handle);
-    check_error(dbg_domain, "Failed to detach fragment shader");
-
-    // We don't need the shaders anymore, so we can delete them right here:
-    glDeleteShader(vertex_shader_handle);
-    check_error(dbg_domain, "Failed to delete vertex shader");
-
-    glDeleteShader(fragment_shader_handle);
-    check_error(dbg_domain, "Failed to delete fragment shader");
-
-    // Use our program from now on:
-    glUseProgram(shader_program->handle);
-    check_error(dbg_domain, "Failed to enable shader program");
-
-    // Retrieve the uniforms:
-    shader_program->gaussian_position_uniform = glGetUniformLocation(shader_program->handle, "gaussian_position");
-    check_error(dbg_domain, "Failed to retrieve uniform (gaussian_position)");
+    char dbg_domain[] = "Rendering on the CPU";
+    viewport_t viewport = get_viewport(user_info);
 
-    if (shader_program->gaussian_position_uniform < 0)
-    {
-        fprintf(stderr, "[%s] Uniform is not available: gaussian_position\n", dbg_domain);
-        exit(EXIT_FAILURE);
-    }
-
-    shader_program->gaussian_half_frame_uniform = glGetUniformLocation(shader_program->handle, "gaussian_half_frame");
-    check_error(dbg_domain, "Failed to retrieve uniform (gaussian_half_frame)");
+    // Snap the view onto the tile grid (unless it is too deep for it), so we can reuse the tiles of earlier frames:
+    tile_frame_t frame;
+    int is_on_grid = snap_to_tile_grid(&viewport, &frame);
 
-    if (shader_program->gaussian_half_frame_uniform < 0)
+    if (is_on_grid)
     {
-        fprintf(stderr, "[%s] Uniform is not available: gaussian_half_frame\n", dbg_domain);
-        exit(EXIT_FAILURE);
+        viewport = get_tile_frame_viewport(&frame);
     }
 
-    shader_program->iterations_uniform = glGetUniformLocation(shader_program->handle, "iterations");
-    check_error(dbg_domain, "Failed to retrieve uniform (iterations)");
+    int pixel_count = viewport.size[0] * viewport.size[1];
 
-    if (shader_program->iterations_uniform < 0)
+    // Only iterate if the view has changed (otherwise we just recolor):
+    if (!user_info->is_cpu_viewport_valid || !is_same_viewport(&viewport, &user_info->cpu_viewport))
     {
-        fprintf(stderr, "[%s] Uniform is not available: iterations\n", dbg_domain);
-        exit(EXIT_FAILURE);
+        user_info->cpu_iteration_state = realloc(user_info->cpu_iteration_state, pixel_count * sizeof(uint32_t));
+        user_info->cpu_pixels = realloc(user_info->cpu_pixels, 4 * pixel_count);
+
+        if (!user_info->cpu_iteration_state || !user_info->cpu_pixels)
+        {
+            fprintf(stderr, "[%s] Failed to allocate memory for %d pixels\n", dbg_domain, pixel_count);
+            exit(EXIT_FAILURE);
+        }
+
+        if (is_on_grid)
+        {
+            render_escape_cached(&user_info->tile_cache, &frame, user_info->cpu_iteration_state, cpu_thread_count());
+        }
+        else
+        {
+            cpu_render_escape(&viewport, user_info->cpu_iteration_state, cpu_thread_count());
+        }
+
+        user_info->cpu_viewport = viewport;
+        user_info->is_cpu_viewport_valid = 1;
     }
 
-    // Set the texture uniform:
-    GLint hue_texture_uniform = glGetUniformLocation(shader_program->handle, "hue_texture");
-    check_error(dbg_domain, "Failed to retrieve uniform (hueTexture)");
-
-    if (hue_texture_uniform < 0)
-    {
-        fprintf(stderr, "[%s] Uniform is not available: hue_texture_uniform\n", dbg_domain);
-        exit(EXIT_FAILURE);
-    }
-
-    // Assign the value to this uniform (const):
-    glUniform1i(hue_texture_uniform, 0);
-    check_error(dbg_domain, "Failed to assign to constant uniform (hue_texture_uniform)");
-
-    // Release the shader compiler:
-    glReleaseShaderCompiler();
-    check_error(dbg_domain, "Failed to release the shader compiler");
-}
-
-GLuint create_hue_texture(const char* file_path)
-{
-    const char dbg_domain[] = "Creating texture";
-
-    // Read all the bytes:
-    uint8_t* texture_data;
-    int length = read_all_bytes(file_path, 0, &texture_data);
-
-    // How many pixels are there?
-    GLsizei pixels_count = length / 4;
-
-    // TODO: Check PoT
-
-    // Generate a texture handle:
-    GLuint texture_handle;
-
-    glGenTextures(1, &texture_handle);
-    check_error(dbg_domain, "Failed to generate texture handle");
-
-    // Bind our texture:
-    glBindTexture(GL_TEXTURE_2D, texture_handle);
-    check_error(dbg_domain, "Failed to bind texture");
-
-    // Set wrapping mode:
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    check_error(dbg_domain, "Failed to set wrapping for s");
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    check_error(dbg_domain, "Failed to set wrapping for t");
-
-    // Provide the bytes:
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, pixels_count, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, (const GLvoid*)texture_data);
-    check_error(dbg_domain, "Failed to push texture data (2D)");
-
-    // Free the texture data:
-    free(texture_data);
+    cpu_colorize(user_info->cpu_iteration_state, pixel_count, user_info->iterations, &user_info->hue_tables[user_info->palette], user_info->hue_density, user_info->hue_offset, user_info->cpu_pixels);
 
-    // Set min filter:
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    check_error(dbg_domain, "Failed to set texture minification filter");
-
-    // Set mag filter:
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    check_error(dbg_domain, "Failed to set texture magnification filter");
-
-    return texture_handle;
-}
-
-void init_textures(GLuint* hue_texture_handles)
-{
-    printf("Uploading textures ...\n");
-
-    // Activate the texture unit:
-    glActiveTexture(GL_TEXTURE0);
-    check_error("Initializing textures", "Failed to activate texture unit");
-
-    // Create the textures:
-    hue_texture_handles[0] = create_hue_texture("textures/fire.rgba");
-    hue_texture_handles[1] = create_hue_texture("textures/ice.rgba");
-    hue_texture_handles[2] = create_hue_texture("textures/ash.rgba");
-    hue_texture_handles[3] = create_hue_texture("textures/psychedelic.rgba");
-}
-
-void bind_texture(GLuint texture_handle)
-{
-    // Bind the new texture:
-    glBindTexture(GL_TEXTURE_2D, texture_handle);
-    check_error("Binding hue texture", "Failed to bind hue texture");
-}
-
-void render_frame(user_info_t* user_info)
-{
-    char dbg_domain[] = "Rendering frame";
-
-    // Provide Gaussian position and half frame as uniforms:
-    glUniform2f(user_info->shader_program.gaussian_position_uniform, (GLfloat)(user_info->position[0]), (GLfloat)(user_info->position[1]));
-    check_error(dbg_domain, "Failed to provide uniform (gaussian_position)");
-
-    glUniform2f(user_info->shader_program.gaussian_half_frame_uniform, (GLfloat)((0.5 * user_info->window_size[0]) / user_info->scale), (GLfloat)((0.5 * user_info->window_size[1]) / user_info->scale));
-    check_error(dbg_domain, "Failed to provide uniform (gaussian_half_frame)");
-
-    glUniform1ui(user_info->shader_program.iterations_uniform, (GLuint)(user_info->iterations));
-    check_error(dbg_domain, "Failed to provide uniform (iterations)");
-
-    // Clear the renderbuffer with the given clear color:
-    glClear(GL_COLOR_BUFFER_BIT);
-    check_error(dbg_domain, "Failed to clear renderbuffer");
-
-    // Draw a full-screen-quad:
-    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-    check_error(dbg_domain, "Failed to draw");
+    // Draw it (our rows go from top to bottom, so we start at the top and flip):
+    user_info->raster_pos(-1.0f, 1.0f);
+    user_info->pixel_zoom(1.0f, -1.0f);
+    user_info->draw_pixels(viewport.size[0], viewport.size[1], GL_RGBA, GL_UNSIGNED_BYTE, user_info->cpu_pixels);
+    check_error(dbg_domain, "Failed to draw pixels");
 }
 
 void render_loop(void* arg)
@@ -533,20 +220,62 @@ void render_loop(void* arg)
     GLFWwindow* window = arg;
     user_info_t* user_info = glfwGetWindowUserPointer(window);
 
-    // Render a frame:
-    render_frame(user_info);
+    // Only render if something has changed, there are pixels left to iterate or the palette is animated:
+    int has_work = user_info->is_dirty || !is_frame_complete(user_info) || user_info->is_palette_cycling;
 
-    // Swap the buffers:
-    glfwSwapBuffers(window);
+    if (has_work)
+    {
+        user_info->is_dirty = 0;
+
+        // Advance the palette:
+        advance_palette(user_info);
+
+        // Render a frame:
+        if (user_info->is_cpu_rendering)
+        {
+            render_cpu_frame(user_info);
+        }
+        else
+        {
+            render_frame(user_info);
+        }
+
+        // Swap the buffers:
+        glfwSwapBuffers(window);
+    }
 
-    // Poll window events:
+#ifdef __EMSCRIPTEN__
+    // The browser calls us every frame, so we must not block (skipping the draw is enough to idle):
     glfwPollEvents();
+#else
+    // Poll window events while we are busy, sleep until the next event otherwise:
+    if (user_info->is_dirty || !is_frame_complete(user_info) || user_info->is_palette_cycling)
+    {
+        glfwPollEvents();
+    }
+    else
+    {
+        glfwWaitEvents();
+    }
+#endif
 }
 
-int main(void)
+int main(int argc, char** argv)
 {
     printf("Hello Mandel-GL!\n");
 
+    // The arguments are an optional switch to desktop OpenGL (for native doubles) and an optional tile store (the CPU renderer keeps its tiles there across restarts):
+    int is_desktop_gl_requested = (argc > 1) && !strcmp(argv[1], "--desktop-gl");
+    int argument_count = argc - is_desktop_gl_requested;
+
+    if (argument_count > 2)
+    {
+        fprintf(stderr, "Usage: %s [--desktop-gl] [tile store]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    const char* tile_store_path = (argument_count == 2) ? argv[argc - 1] : NULL;
+
     // Set an error callback to print out all problems from GLFW:
     glfwSetErrorCallback(error_callback);
 
@@ -564,15 +293,46 @@ int main(void)
 
     user_info.is_panning = 0;
 
-    user_info.position[0] = 0;
-    user_info.position[1] = 0;
+    user_info.position[0] = dd_from_double(0);
+    user_info.position[1] = dd_from_double(0);
 
     user_info.scale = MIN_SCALE;
 
     user_info.iterations = 500;
 
+    user_info.precision_tier = PRECISION_TIER_FLOAT;
+    user_info.is_precision_tier_forced = 0;
+
+    user_info.is_progressive = 1;
+    user_info.is_hybrid_rendering = 0;
+
+    // Only a GL context can tell (init_gl_renderer sets these), the CPU renderer has neither:
+    user_info.uniform_2d = NULL;
+    user_info.is_fp64_supported = 0;
+    user_info.is_compute_supported = 0;
+    user_info.is_compute_enabled = 0;
+
+    user_info.is_dirty = 1;
+
+    user_info.hue_density = MIN_HUE_DENSITY;
+    user_info.hue_offset = 0;
+    user_info.is_palette_cycling = 0;
+    user_info.palette_cycle_time = 0;
+    user_info.palette = 0;
+
+    user_info.is_cpu_rendering = 0;
+    user_info.cpu_iteration_state = NULL;
+    user_info.cpu_pixels = NULL;
+    user_info.is_cpu_viewport_valid = 0;
+    user_info.is_validation_requested = 0;
+
+    // We draw into the window:
+    user_info.target_framebuffer = 0;
+
+    init_reference_orbit(&user_info.reference_orbit);
+
     // Create a GLFW window:
-    GLFWwindow* window = create_glfw_window(&user_info);
+    GLFWwindow* window = create_glfw_window(&user_info, is_desktop_gl_requested);
 
     // Make the OpenGL context of the window current:
     glfwMakeContextCurrent(window);
@@ -593,20 +353,58 @@ int main(void)
     glViewport(0, 0, initial_width, initial_height);
     check_error("Initializing", "Failed to specify initial viewport");
 
-    // Initialize our vertex data:
-    GLuint vertex_buffer_object;
-    GLuint vertex_array_object;
+    user_info.framebuffer_size[0] = initial_width;
+    user_info.framebuffer_size[1] = initial_height;
+
+    // Initialize the hue tables (the CPU renderer uses them, and so does the validation of the GPU path):
+    for (int i = 0; i < PALETTE_COUNT; i++)
+    {
+        load_hue_table(&user_info.hue_tables[i], palette_file_paths[i]);
+    }
 
-    init_vertex_data(&vertex_buffer_object, &vertex_array_object);
+    if (!user_info.is_cpu_rendering && tile_store_path)
+    {
+        printf("The GPU renderer reuses its escape state instead of tiles, so it ignores the tile store.\n");
+    }
 
-    // Initialize our shader program and retrieve the uniform locations:
-    init_shader_program(&user_info.shader_program);
+    if (user_info.is_cpu_rendering)
+    {
+        printf("Rendering on the CPU (%d threads, %s) ...\n", cpu_thread_count(), cpu_renderer_simd_name());
+
+        init_tile_cache(&user_info.tile_cache, TILE_CACHE_MEMORY);
+
+        // Without the store we just start from scratch:
+        if (tile_store_path && open_tile_store(&user_info.tile_store, tile_store_path, TILE_STORE_SIZE))
+        {
+            user_info.tile_cache.store = &user_info.tile_store;
+        }
+
+        // We only draw pixels:
+        user_info.draw_pixels = (legacy_draw_pixels_proc_t)glfwGetProcAddress("glDrawPixels");
+        user_info.raster_pos = (legacy_raster_pos_proc_t)glfwGetProcAddress("glRasterPos2f");
+        user_info.pixel_zoom = (legacy_pixel_zoom_proc_t)glfwGetProcAddress("glPixelZoom");
+
+        if (!user_info.draw_pixels || !user_info.raster_pos || !user_info.pixel_zoom)
+        {
+            fprintf(stderr, "Failed to load the legacy GL functions to draw pixels.\n");
+            exit(EXIT_FAILURE);
+        }
+
+        // There is no progressive state on the CPU, every frame is complete:
+        user_info.escape_state.is_converged = 1;
+        user_info.escape_state.is_hybrid = 0;
+    }
+    else
+    {
+        // Only desktop GL has double uniforms (NULL otherwise, then we go without the fp64 tier):
+        user_info.uniform_2d = is_desktop_gl_requested ? (uniform_2d_proc_t)glfwGetProcAddress("glUniform2d") : NULL;
 
-    // Initialize the hue textures:
-    init_textures(user_info.hue_texture_handles);
+        // Compile the shaders, create the escape state and upload the textures:
+        init_gl_renderer(&user_info);
 
-    // Bind the fire texture:
-    bind_texture(user_info.hue_texture_handles[0]);
+        printf("Native double precision: %s\n", user_info.is_fp64_supported ? "yes" : "no");
+        printf("Compute kernels: %s\n", user_info.is_compute_supported ? "yes" : "no");
+    }
 
     // Save the user info in the window:
     glfwSetWindowUserPointer(window, (void*)&user_info);
@@ -627,21 +425,30 @@ int main(void)
 
     //  Note: The stuff below will not run if we are on the web.
 
-    // Delete the VAO:
-    glDeleteVertexArrays(1, &vertex_array_object);
-    check_error("Closing", "Failed to delete vertex array object");
+    if (user_info.is_cpu_rendering)
+    {
+        if (user_info.tile_cache.store)
+        {
+            close_tile_store(user_info.tile_cache.store);
+        }
 
-    // Delete the VBO:
-    glDeleteBuffers(1, &vertex_buffer_object);
-    check_error("Closing", "Failed to delete vertex buffer object");
+        delete_tile_cache(&user_info.tile_cache);
+    }
+    else
+    {
+        delete_gl_renderer(&user_info);
+    }
 
-    // Delete the shader program:
-    glDeleteProgram(user_info.shader_program.handle);
-    check_error("Closing", "Failed to delete shader program");
+    // Delete the CPU side:
+    for (int i = 0; i < PALETTE_COUNT; i++)
+    {
+        free_hue_table(&user_info.hue_tables[i]);
+    }
+
+    free(user_info.cpu_iteration_state);
+    free(user_info.cpu_pixels);
 
-    // Delete hue textures:
-    glDeleteTextures(4, user_info.hue_texture_handles);
-    check_error("Closing", "Failed to delete hue textures");
+    free_reference_orbit(&user_info.reference_orbit);
 
     // Destroy the window:
     glfwDestroyWindow(window);
@@ -661,9 +468,18 @@ void error_callback(int error, const char* description)
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
+    // Get the user info:
+    user_info_t* user_info = glfwGetWindowUserPointer(window);
+
+    // Update width and height:
+    user_info->framebuffer_size[0] = width;
+    user_info->framebuffer_size[1] = height;
+
     // Apply as the new viewport:
     glViewport(0, 0, width, height);
     check_error("Changing viewport size", "Failed to specify new viewport");
+
+    user_info->is_dirty = 1;
 }
 
 void window_size_callback(GLFWwindow* window, int width, int height)
@@ -674,6 +490,17 @@ void window_size_callback(GLFWwindow* window, int width, int height)
     // Update width and height:
     user_info->window_size[0] = width;
     user_info->window_size[1] = height;
+
+    user_info->is_dirty = 1;
+}
+
+void window_refresh_callback(GLFWwindow* window)
+{
+    // Get the user info:
+    user_info_t* user_info = glfwGetWindowUserPointer(window);
+
+    // The window contents got damaged (e.g. it was uncovered):
+    user_info->is_dirty = 1;
 }
 
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
@@ -687,12 +514,129 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
     case GLFW_KEY_UP: user_info->iterations = MIN(user_info->iterations + 10, MAX_ITERATIONS); break;
     case GLFW_KEY_DOWN: user_info->iterations = MAX(user_info->iterations - 10, MIN_ITERATIONS); break;
 
-    // Bind different textures:
-    case GLFW_KEY_1: bind_texture(user_info->hue_texture_handles[0]); break;
-    case GLFW_KEY_2: bind_texture(user_info->hue_texture_handles[1]); break;
-    case GLFW_KEY_3: bind_texture(user_info->hue_texture_handles[2]); break;
-    case GLFW_KEY_4: bind_texture(user_info->hue_texture_handles[3]); break;
+    // Double / halve iterations (for deep views that need tens of thousands):
+    case GLFW_KEY_PAGE_UP:
+        if (action == GLFW_PRESS)
+        {
+            user_info->iterations = MIN(2 * user_info->iterations, MAX_ITERATIONS);
+        }
+
+        break;
+
+    case GLFW_KEY_PAGE_DOWN:
+        if (action == GLFW_PRESS)
+        {
+            user_info->iterations = MAX(user_info->iterations / 2, MIN_ITERATIONS);
+        }
+
+        break;
+
+    // Toggle progressive rendering (a slice of iterations per frame instead of everything at once):
+    case GLFW_KEY_I:
+        if (action == GLFW_PRESS)
+        {
+            user_info->is_progressive = !user_info->is_progressive;
+            printf("Progressive: %s\n", user_info->is_progressive ? "on" : "off");
+        }
+
+        break;
+
+    // Toggle hybrid rendering (the CPU takes a share of the tiles off the GPU):
+    case GLFW_KEY_H:
+        if ((action == GLFW_PRESS) && !user_info->is_cpu_rendering)
+        {
+            user_info->is_hybrid_rendering = !user_info->is_hybrid_rendering;
+            printf("Hybrid: %s\n", user_info->is_hybrid_rendering ? "on" : "off");
+        }
+
+        break;
+
+    // Toggle the compute kernels (to compare them with the fragment kernels):
+    case GLFW_KEY_K:
+        if ((action == GLFW_PRESS) && !user_info->is_cpu_rendering && user_info->is_compute_supported)
+        {
+            user_info->is_compute_enabled = !user_info->is_compute_enabled;
+            printf("Compute kernels: %s\n", user_info->is_compute_enabled ? "on" : "off");
+        }
+
+        break;
+
+    // Bind different textures (only the colorize pass runs again):
+    case GLFW_KEY_1: select_palette(user_info, 0); break;
+    case GLFW_KEY_2: select_palette(user_info, 1); break;
+    case GLFW_KEY_3: select_palette(user_info, 2); break;
+    case GLFW_KEY_4: select_palette(user_info, 3); break;
+
+    // Repeat the palette more or less often:
+    case GLFW_KEY_RIGHT:
+        if (action == GLFW_PRESS)
+        {
+            user_info->hue_density = MIN(2 * user_info->hue_density, MAX_HUE_DENSITY);
+        }
+
+        break;
+
+    case GLFW_KEY_LEFT:
+        if (action == GLFW_PRESS)
+        {
+            user_info->hue_density = MAX(0.5 * user_info->hue_density, MIN_HUE_DENSITY);
+        }
+
+        break;
+
+    // Compare the next frame with the CPU renderer:
+    case GLFW_KEY_V:
+        if ((action == GLFW_PRESS) && !user_info->is_cpu_rendering)
+        {
+            user_info->is_validation_requested = 1;
+        }
+
+        break;
+
+    // Start / stop cycling through the palette:
+    case GLFW_KEY_C:
+        if (action == GLFW_PRESS)
+        {
+            user_info->is_palette_cycling = !user_info->is_palette_cycling;
+            user_info->palette_cycle_time = glfwGetTime();
+        }
+
+        break;
+
+    // Cycle through automatic and forced precision tiers (e.g. to compare them):
+    case GLFW_KEY_P:
+        if ((action == GLFW_PRESS) && !user_info->is_cpu_rendering)
+        {
+            if (!user_info->is_precision_tier_forced)
+            {
+                user_info->is_precision_tier_forced = 1;
+                user_info->precision_tier = 0;
+            }
+            else if ((user_info->precision_tier + 1) < PRECISION_TIER_COUNT)
+            {
+                user_info->precision_tier++;
+
+                // Skip the tier we have no program for:
+                if ((user_info->precision_tier == PRECISION_TIER_FP64) && !user_info->is_fp64_supported)
+                {
+                    user_info->precision_tier++;
+                }
+            }
+            else
+            {
+                user_info->is_precision_tier_forced = 0;
+            }
+
+            printf("Precision: %s%s\n", user_info->is_precision_tier_forced ? "forced " : "automatic, ", precision_tier_names[user_info->precision_tier]);
+        }
+
+        break;
+
+    // Nothing to redraw for other keys:
+    default: return;
     }
+
+    user_info->is_dirty = 1;
 }
 
 void mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
@@ -715,8 +659,10 @@ void cursor_pos_callback(GLFWwindow* window, double xoffset, double yoffset)
     // Are we panning?
     if (user_info->is_panning)
     {
-        user_info->position[0] = CLAMPED_POSITION(user_info->position[0] - ((xoffset - user_info->cursor_position[0]) / user_info->scale));
-        user_info->position[1] = CLAMPED_POSITION(user_info->position[1] + ((yoffset - user_info->cursor_position[1]) / user_info->scale));
+        user_info->position[0] = clamped_position(dd_add_double(user_info->position[0], -((xoffset - user_info->cursor_position[0]) / user_info->scale)));
+        user_info->position[1] = clamped_position(dd_add_double(user_info->position[1], (yoffset - user_info->cursor_position[1]) / user_info->scale));
+
+        user_info->is_dirty = 1;
     }
 
     // Save the new position:
@@ -734,13 +680,15 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
     double delta_y = user_info->cursor_position[1] - (0.5 * user_info->window_size[1]);
 
     // Convert the cursor position to Gaussian:
-    double center_x = user_info->position[0] + (delta_x / user_info->scale);
-    double center_y = user_info->position[1] - (delta_y / user_info->scale);
+    double_double_t center_x = dd_add_double(user_info->position[0], delta_x / user_info->scale);
+    double_double_t center_y = dd_add_double(user_info->position[1], -(delta_y / user_info->scale));
 
     // Set the new scale:
     user_info->scale = CLAMPED_SCALE(pow(2, MOUSE_WHEEL_FACTOR * yoffset) * user_info->scale);
 
     // Move the saved Gaussian back to the center point:
-    user_info->position[0] = CLAMPED_POSITION(center_x - (delta_x / user_info->scale));
-    user_info->position[1] = CLAMPED_POSITION(center_y + (delta_y / user_info->scale));
+    user_info->position[0] = clamped_position(dd_add_double(center_x, -(delta_x / user_info->scale)));
+    user_info->position[1] = clamped_position(dd_add_double(center_y, delta_y / user_info->scale));
+
+    user_info->is_dirty = 1;
 }
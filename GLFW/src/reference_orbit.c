@@ -0,0 +1,117 @@
+#include "reference_orbit.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void init_reference_orbit(reference_orbit_t* orbit)
+{
+    orbit->position[0] = dd_from_double(0);
+    orbit->position[1] = dd_from_double(0);
+
+    orbit->points = NULL;
+    orbit->length = 0;
+    orbit->capacity = 0;
+
+    orbit->last_point[0] = dd_from_double(0);
+    orbit->last_point[1] = dd_from_double(0);
+
+    orbit->iterations = 0;
+    orbit->has_escaped = 0;
+}
+
+// Make room for X_0 ... X_iterations, padded to full rows (returns the padded size):
+static int reserve_reference_orbit(reference_orbit_t* orbit, int iterations, int row_length)
+{
+    int needed_capacity = (((iterations + 1) + (row_length - 1)) / row_length) * row_length;
+
+    if (needed_capacity > orbit->capacity)
+    {
+        float* points = (float*)realloc(orbit->points, 2 * sizeof(float) * needed_capacity);
+
+        if (!points)
+        {
+            fprintf(stderr, "Failed to allocate memory: %zu bytes\n", 2 * sizeof(float) * needed_capacity);
+            exit(EXIT_FAILURE);
+        }
+
+        orbit->points = points;
+        orbit->capacity = needed_capacity;
+    }
+
+    return needed_capacity;
+}
+
+// Continue the orbit from its last point up to the given iterations:
+static void iterate_reference_orbit(reference_orbit_t* orbit, int iterations, int row_length)
+{
+    int padded_length = reserve_reference_orbit(orbit, iterations, row_length);
+
+    orbit->iterations = iterations;
+
+    double_double_t x = orbit->last_point[0];
+    double_double_t y = orbit->last_point[1];
+
+    // Iterate X_(n + 1) = X_n^2 + C until the limit or until the reference escapes.
+    // We keep the first escaped point as well, the shader will rebase before it runs off the end.
+    while (!orbit->has_escaped && (orbit->length <= iterations))
+    {
+        double_double_t x_squared = dd_sqr(x);
+        double_double_t y_squared = dd_sqr(y);
+        double_double_t x_times_y = dd_mul(x, y);
+
+        x = dd_add(dd_sub(x_squared, y_squared), orbit->position[0]);
+        y = dd_add(dd_mul_double(x_times_y, 2.0), orbit->position[1]);
+
+        double x_approx = dd_to_double(x);
+        double y_approx = dd_to_double(y);
+
+        orbit->points[(2 * orbit->length) + 0] = (float)x_approx;
+        orbit->points[(2 * orbit->length) + 1] = (float)y_approx;
+        orbit->length++;
+
+        if (((x_approx * x_approx) + (y_approx * y_approx)) > 4.0)
+        {
+            orbit->has_escaped = 1;
+        }
+    }
+
+    orbit->last_point[0] = x;
+    orbit->last_point[1] = y;
+
+    // Zero the padding:
+    memset(orbit->points + (2 * orbit->length), 0, 2 * sizeof(float) * (padded_length - orbit->length));
+}
+
+void compute_reference_orbit(reference_orbit_t* orbit, const double_double_t position[2], int iterations, int row_length)
+{
+    orbit->position[0] = position[0];
+    orbit->position[1] = position[1];
+    orbit->has_escaped = 0;
+
+    // X_0 = 0:
+    orbit->last_point[0] = dd_from_double(0);
+    orbit->last_point[1] = dd_from_double(0);
+
+    reserve_reference_orbit(orbit, iterations, row_length);
+
+    orbit->points[0] = 0;
+    orbit->points[1] = 0;
+    orbit->length = 1;
+
+    iterate_reference_orbit(orbit, iterations, row_length);
+}
+
+void extend_reference_orbit(reference_orbit_t* orbit, int iterations, int row_length)
+{
+    if (iterations > orbit->iterations)
+    {
+        iterate_reference_orbit(orbit, iterations, row_length);
+    }
+}
+
+void free_reference_orbit(reference_orbit_t* orbit)
+{
+    free(orbit->points);
+    init_reference_orbit(orbit);
+}
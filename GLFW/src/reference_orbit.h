@@ -0,0 +1,46 @@
+#ifndef REFERENCE_ORBIT_H
+#define REFERENCE_ORBIT_H
+
+#include "double_double.h"
+
+// A reference orbit for perturbation rendering.
+// It is computed in double-double precision and stored as plain floats, because the GPU only needs X_n to float precision.
+// The orbit always starts with X_0 = 0 (followed by X_1 = C), so a pixel can be rebased onto it at any time.
+typedef struct _reference_orbit_t_
+{
+    // The reference point C in the Gaussian plane:
+    double_double_t position[2];
+
+    // The orbit points X_n as interleaved (x, y) float pairs:
+    float* points;
+
+    // The number of valid points:
+    int length;
+
+    // The number of points we have room for:
+    int capacity;
+
+    // The last point in full precision (so we can extend the orbit later):
+    double_double_t last_point[2];
+
+    // The iteration limit the orbit has been computed for:
+    int iterations;
+
+    // Did the reference point escape before the iteration limit?
+    int has_escaped;
+} reference_orbit_t;
+
+// Initialize an empty orbit:
+void init_reference_orbit(reference_orbit_t* orbit);
+
+// Compute the orbit of the given reference point (at most iterations + 1 points).
+// The points buffer is padded with zeros up to a multiple of row_length.
+void compute_reference_orbit(reference_orbit_t* orbit, const double_double_t position[2], int iterations, int row_length);
+
+// Continue the orbit of the same reference point up to the given iterations (the existing points stay valid):
+void extend_reference_orbit(reference_orbit_t* orbit, int iterations, int row_length);
+
+// Release the orbit's memory:
+void free_reference_orbit(reference_orbit_t* orbit);
+
+#endif
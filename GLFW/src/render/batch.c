@@ -0,0 +1,304 @@
+#include "batch.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "image_io.h"
+
+// How many images may wait between two stages (each one holds its full image in memory):
+#define BATCH_QUEUE_LENGTH 2
+
+// PNG encoding is the slowest stage after compute, so it gets more than one thread:
+#define BATCH_WRITER_COUNT 2
+
+// Macros:
+#define MAX(a, b) (((a) > (b)) ? (a) : (b))
+
+// A job on its way through the pipeline:
+typedef struct _batch_item_t_
+{
+    const batch_job_t* job;
+
+    // The CPU escape pass produces the iteration state, colorizing turns it into pixels (the GPU produces pixels right away):
+    uint32_t* iteration_state;
+    uint8_t* pixels;
+} batch_item_t;
+
+// A bounded queue of items between two stages, closed by the producer when it is done:
+typedef struct _batch_queue_t_
+{
+    batch_item_t* items[BATCH_QUEUE_LENGTH];
+    int first;
+    int count;
+    int is_closed;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t is_not_empty;
+    pthread_cond_t is_not_full;
+} batch_queue_t;
+
+// Everything the stage threads share:
+typedef struct _batch_t_
+{
+    const renderer_t* renderer;
+    int job_count;
+
+    batch_queue_t colorize_queue;
+    batch_queue_t write_queue;
+
+    // Counted by the writers:
+    pthread_mutex_t count_mutex;
+    int written_count;
+    int failed_count;
+} batch_t;
+
+static double get_time(void)
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return time.tv_sec + (1e-9 * time.tv_nsec);
+}
+
+static void init_queue(batch_queue_t* queue)
+{
+    *queue = (batch_queue_t){ .is_closed = 0 };
+
+    pthread_mutex_init(&queue->mutex, NULL);
+    pthread_cond_init(&queue->is_not_empty, NULL);
+    pthread_cond_init(&queue->is_not_full, NULL);
+}
+
+static void delete_queue(batch_queue_t* queue)
+{
+    pthread_cond_destroy(&queue->is_not_full);
+    pthread_cond_destroy(&queue->is_not_empty);
+    pthread_mutex_destroy(&queue->mutex);
+}
+
+// Blocks while the queue is full:
+static void push_item(batch_queue_t* queue, batch_item_t* item)
+{
+    pthread_mutex_lock(&queue->mutex);
+
+    while (queue->count == BATCH_QUEUE_LENGTH)
+    {
+        pthread_cond_wait(&queue->is_not_full, &queue->mutex);
+    }
+
+    queue->items[(queue->first + queue->count) % BATCH_QUEUE_LENGTH] = item;
+    queue->count++;
+
+    pthread_cond_signal(&queue->is_not_empty);
+    pthread_mutex_unlock(&queue->mutex);
+}
+
+// Blocks while the queue is empty, returns NULL once it is empty and closed:
+static batch_item_t* pop_item(batch_queue_t* queue)
+{
+    pthread_mutex_lock(&queue->mutex);
+
+    while (!queue->count && !queue->is_closed)
+    {
+        pthread_cond_wait(&queue->is_not_empty, &queue->mutex);
+    }
+
+    batch_item_t* item = NULL;
+
+    if (queue->count)
+    {
+        item = queue->items[queue->first];
+        queue->first = (queue->first + 1) % BATCH_QUEUE_LENGTH;
+        queue->count--;
+
+        pthread_cond_signal(&queue->is_not_full);
+    }
+
+    pthread_mutex_unlock(&queue->mutex);
+
+    return item;
+}
+
+static void close_queue(batch_queue_t* queue)
+{
+    pthread_mutex_lock(&queue->mutex);
+
+    queue->is_closed = 1;
+
+    pthread_cond_broadcast(&queue->is_not_empty);
+    pthread_mutex_unlock(&queue->mutex);
+}
+
+static void* allocate_pixels(const viewport_t* viewport, size_t pixel_size)
+{
+    void* memory = malloc((size_t)viewport->size[0] * viewport->size[1] * pixel_size);
+
+    if (!memory)
+    {
+        fprintf(stderr, "Failed to allocate memory for %d x %d pixels\n", viewport->size[0], viewport->size[1]);
+        exit(EXIT_FAILURE);
+    }
+
+    return memory;
+}
+
+static void* run_colorize_stage(void* argument)
+{
+    batch_t* batch = argument;
+    batch_item_t* item;
+
+    while ((item = pop_item(&batch->colorize_queue)))
+    {
+        const batch_job_t* job = item->job;
+
+        item->pixels = allocate_pixels(&job->viewport, 4);
+
+        colorize_iteration_state(batch->renderer, item->iteration_state, &job->viewport, job->palette, job->hue_density, job->hue_offset, item->pixels);
+
+        free(item->iteration_state);
+        item->iteration_state = NULL;
+
+        push_item(&batch->write_queue, item);
+    }
+
+    close_queue(&batch->write_queue);
+
+    return NULL;
+}
+
+static void* run_write_stage(void* argument)
+{
+    batch_t* batch = argument;
+    batch_item_t* item;
+
+    while ((item = pop_item(&batch->write_queue)))
+    {
+        const batch_job_t* job = item->job;
+
+        int is_written = write_image(job->output_path, job->viewport.size[0], job->viewport.size[1], item->pixels);
+
+        pthread_mutex_lock(&batch->count_mutex);
+
+        batch->written_count++;
+        batch->failed_count += !is_written;
+
+        if (is_written)
+        {
+            printf("[%d/%d] %s\n", batch->written_count, batch->job_count, job->output_path);
+        }
+
+        pthread_mutex_unlock(&batch->count_mutex);
+
+        free(item->pixels);
+        free(item);
+    }
+
+    return NULL;
+}
+
+int run_batch(const batch_job_t* jobs, int job_count, const renderer_settings_t* settings)
+{
+    // The renderer has to fit the largest image:
+    int max_size[2] = { 1, 1 };
+
+    for (int i = 0; i < job_count; i++)
+    {
+        max_size[0] = MAX(max_size[0], jobs[i].viewport.size[0]);
+        max_size[1] = MAX(max_size[1], jobs[i].viewport.size[1]);
+    }
+
+    renderer_t renderer;
+    init_renderer(&renderer, settings, max_size[0], max_size[1], INT32_MAX);
+
+    batch_t batch = { .renderer = &renderer, .job_count = job_count };
+
+    init_queue(&batch.colorize_queue);
+    init_queue(&batch.write_queue);
+    pthread_mutex_init(&batch.count_mutex, NULL);
+
+    // The colors come from the GPU already, so the GL pipeline skips the colorize stage:
+    int is_colorizing = renderer.settings.backend == BACKEND_CPU;
+
+    pthread_t colorize_thread;
+    pthread_t writer_threads[BATCH_WRITER_COUNT];
+
+    if (is_colorizing && pthread_create(&colorize_thread, NULL, run_colorize_stage, &batch))
+    {
+        fprintf(stderr, "Failed to start the colorize thread\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (int i = 0; i < BATCH_WRITER_COUNT; i++)
+    {
+        if (pthread_create(&writer_threads[i], NULL, run_write_stage, &batch))
+        {
+            fprintf(stderr, "Failed to start a writer thread\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    printf("Rendering %d images (%s) ...\n", job_count, renderer.name);
+
+    double start_time = get_time();
+
+    for (int i = 0; i < job_count; i++)
+    {
+        const batch_job_t* job = &jobs[i];
+        batch_item_t* item = calloc(1, sizeof(batch_item_t));
+
+        if (!item)
+        {
+            fprintf(stderr, "Failed to allocate memory for a job\n");
+            exit(EXIT_FAILURE);
+        }
+
+        item->job = job;
+
+        if (is_colorizing)
+        {
+            item->iteration_state = allocate_pixels(&job->viewport, sizeof(uint32_t));
+            render_escape(&renderer, &job->viewport, item->iteration_state);
+
+            push_item(&batch.colorize_queue, item);
+        }
+        else
+        {
+            renderer.settings.palette = job->palette;
+            renderer.settings.hue_density = job->hue_density;
+            renderer.settings.hue_offset = job->hue_offset;
+
+            item->pixels = allocate_pixels(&job->viewport, 4);
+            render_viewport(&renderer, &job->viewport, item->pixels);
+
+            push_item(&batch.write_queue, item);
+        }
+    }
+
+    // Let the stages drain (the colorize stage closes the write queue when it is done):
+    if (is_colorizing)
+    {
+        close_queue(&batch.colorize_queue);
+        pthread_join(colorize_thread, NULL);
+    }
+    else
+    {
+        close_queue(&batch.write_queue);
+    }
+
+    for (int i = 0; i < BATCH_WRITER_COUNT; i++)
+    {
+        pthread_join(writer_threads[i], NULL);
+    }
+
+    printf("Rendered %d images in %.3f s (%d failed).\n", job_count, get_time() - start_time, batch.failed_count);
+
+    pthread_mutex_destroy(&batch.count_mutex);
+    delete_queue(&batch.write_queue);
+    delete_queue(&batch.colorize_queue);
+    delete_renderer(&renderer);
+
+    return batch.failed_count;
+}
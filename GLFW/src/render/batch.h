@@ -0,0 +1,25 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "renderer.h"
+#include "viewport.h"
+
+// An image to render in a batch:
+typedef struct _batch_job_t_
+{
+    viewport_t viewport;
+
+    int palette;
+    double hue_density;
+    double hue_offset;
+
+    const char* output_path;
+} batch_job_t;
+
+// Render all jobs with one renderer, as a pipeline: this thread computes the escape passes (on the GPU also the colors),
+// a colorize thread maps CPU iteration states to colors and writer threads encode and write the images.
+// The stages are connected by short queues, so compute never waits for the disk (unless the writers fall behind).
+// Returns the number of images that couldn't be written:
+int run_batch(const batch_job_t* jobs, int job_count, const renderer_settings_t* settings);
+
+#endif
@@ -0,0 +1,246 @@
+#include "checkpoint.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// The manifest ends with the progress:
+#define ROWS_DONE_KEY "rows-done = "
+
+static char* concatenate(const char* a, const char* b)
+{
+    char* result = malloc(strlen(a) + strlen(b) + 1);
+
+    if (!result)
+    {
+        fprintf(stderr, "Failed to allocate memory for a path\n");
+        exit(EXIT_FAILURE);
+    }
+
+    strcpy(result, a);
+    strcat(result, b);
+
+    return result;
+}
+
+// Returns -1 if there's no manifest, 0 if it is broken or doesn't fit, the rows done plus one otherwise:
+static int read_manifest(const checkpoint_t* checkpoint)
+{
+    FILE* file = fopen(checkpoint->manifest_path, "rb");
+
+    if (!file)
+    {
+        return -1;
+    }
+
+    char manifest[MAX_MANIFEST_LENGTH + 1];
+    size_t length = fread(manifest, 1, MAX_MANIFEST_LENGTH, file);
+
+    fclose(file);
+    manifest[length] = 0;
+
+    size_t settings_length = strlen(checkpoint->settings);
+
+    if (strncmp(manifest, checkpoint->settings, settings_length))
+    {
+        fprintf(stderr, "The checkpoint %s belongs to a render with different settings, remove it to start over.\n", checkpoint->manifest_path);
+        return 0;
+    }
+
+    const char* progress = manifest + settings_length;
+    char* end;
+
+    if (strncmp(progress, ROWS_DONE_KEY, strlen(ROWS_DONE_KEY)))
+    {
+        fprintf(stderr, "The checkpoint manifest is broken: %s\n", checkpoint->manifest_path);
+        return 0;
+    }
+
+    progress += strlen(ROWS_DONE_KEY);
+
+    long rows_done = strtol(progress, &end, 10);
+
+    if ((end == progress) || strcmp(end, "\n") || (rows_done < 0) || (rows_done >= INT32_MAX))
+    {
+        fprintf(stderr, "The checkpoint manifest is broken: %s\n", checkpoint->manifest_path);
+        return 0;
+    }
+
+    return (int)rows_done + 1;
+}
+
+// Write the manifest next to the old one and swap them, so there's always a complete one:
+static int write_manifest(const checkpoint_t* checkpoint)
+{
+    char* temporary_path = concatenate(checkpoint->manifest_path, ".tmp");
+    FILE* file = fopen(temporary_path, "wb");
+
+    int is_ok = file &&
+        (fprintf(file, "%s" ROWS_DONE_KEY "%d\n", checkpoint->settings, checkpoint->rows_done) > 0) &&
+        !fflush(file) && !fsync(fileno(file));
+
+    if (file)
+    {
+        is_ok = !fclose(file) && is_ok;
+    }
+
+    is_ok = is_ok && !rename(temporary_path, checkpoint->manifest_path);
+
+    if (!is_ok)
+    {
+        fprintf(stderr, "Failed to write the checkpoint manifest: %s\n", checkpoint->manifest_path);
+        remove(temporary_path);
+    }
+
+    free(temporary_path);
+
+    return is_ok;
+}
+
+int open_checkpoint(checkpoint_t* checkpoint, const char* output_path, const char* settings, int width)
+{
+    *checkpoint = (checkpoint_t){ .width = width };
+
+    if (strlen(settings) >= (MAX_MANIFEST_LENGTH - 64))
+    {
+        fprintf(stderr, "The checkpoint settings are too long\n");
+        return 0;
+    }
+
+    strcpy(checkpoint->settings, settings);
+
+    checkpoint->data_path = concatenate(output_path, ".checkpoint");
+    checkpoint->manifest_path = concatenate(output_path, ".manifest");
+    checkpoint->row = malloc(4 * (size_t)width);
+
+    if (!checkpoint->row)
+    {
+        fprintf(stderr, "Failed to allocate memory for a %d pixel row\n", width);
+        exit(EXIT_FAILURE);
+    }
+
+    int manifest_state = read_manifest(checkpoint);
+
+    if (manifest_state == 0)
+    {
+        return 0;
+    }
+
+    size_t row_size = 3 * (size_t)width;
+
+    if (manifest_state > 0)
+    {
+        checkpoint->rows_done = manifest_state - 1;
+        checkpoint->data_file = fopen(checkpoint->data_path, "r+b");
+
+        // The rows behind the recorded progress may be incomplete, so we drop them:
+        off_t data_size = (off_t)row_size * checkpoint->rows_done;
+
+        if (!checkpoint->data_file || fseeko(checkpoint->data_file, 0, SEEK_END) || (ftello(checkpoint->data_file) < data_size) ||
+            ftruncate(fileno(checkpoint->data_file), data_size) || fseeko(checkpoint->data_file, data_size, SEEK_SET))
+        {
+            fprintf(stderr, "The checkpoint data is missing or incomplete: %s\n", checkpoint->data_path);
+            return 0;
+        }
+
+        return 1;
+    }
+
+    // Start over (the manifest goes last, so an old data file is never taken for a new one):
+    checkpoint->data_file = fopen(checkpoint->data_path, "w+b");
+
+    if (!checkpoint->data_file)
+    {
+        fprintf(stderr, "Failed to open file: %s\n", checkpoint->data_path);
+        return 0;
+    }
+
+    return write_manifest(checkpoint);
+}
+
+int read_checkpoint_rows(checkpoint_t* checkpoint, int y, int row_count, uint8_t* pixels)
+{
+    size_t row_size = 3 * (size_t)checkpoint->width;
+
+    if (fseeko(checkpoint->data_file, (off_t)row_size * y, SEEK_SET))
+    {
+        fprintf(stderr, "Failed to seek in file: %s\n", checkpoint->data_path);
+        return 0;
+    }
+
+    for (int row = 0; row < row_count; row++)
+    {
+        uint8_t* target = pixels + (4 * (size_t)row * checkpoint->width);
+
+        if (fread(checkpoint->row, 1, row_size, checkpoint->data_file) != row_size)
+        {
+            fprintf(stderr, "Failed to read file contents: %s\n", checkpoint->data_path);
+            return 0;
+        }
+
+        for (int x = 0; x < checkpoint->width; x++)
+        {
+            memcpy(target + (4 * x), checkpoint->row + (3 * x), 3);
+            target[(4 * x) + 3] = 255;
+        }
+    }
+
+    return 1;
+}
+
+int append_checkpoint_rows(checkpoint_t* checkpoint, const uint8_t* pixels, int row_count)
+{
+    size_t row_size = 3 * (size_t)checkpoint->width;
+
+    if (fseeko(checkpoint->data_file, (off_t)row_size * checkpoint->rows_done, SEEK_SET))
+    {
+        fprintf(stderr, "Failed to seek in file: %s\n", checkpoint->data_path);
+        return 0;
+    }
+
+    for (int row = 0; row < row_count; row++)
+    {
+        const uint8_t* source = pixels + (4 * (size_t)row * checkpoint->width);
+
+        for (int x = 0; x < checkpoint->width; x++)
+        {
+            memcpy(checkpoint->row + (3 * x), source + (4 * x), 3);
+        }
+
+        if (fwrite(checkpoint->row, 1, row_size, checkpoint->data_file) != row_size)
+        {
+            fprintf(stderr, "Failed to write file: %s\n", checkpoint->data_path);
+            return 0;
+        }
+    }
+
+    // The rows have to be on disk before the manifest says so:
+    if (fflush(checkpoint->data_file) || fsync(fileno(checkpoint->data_file)))
+    {
+        fprintf(stderr, "Failed to write file: %s\n", checkpoint->data_path);
+        return 0;
+    }
+
+    checkpoint->rows_done += row_count;
+
+    return write_manifest(checkpoint);
+}
+
+void close_checkpoint(checkpoint_t* checkpoint, int is_complete)
+{
+    if (checkpoint->data_file)
+    {
+        fclose(checkpoint->data_file);
+    }
+
+    // The manifest goes first, so we never leave one without its data:
+    if (is_complete)
+    {
+        remove(checkpoint->manifest_path);
+        remove(checkpoint->data_path);
+    }
+
+    free(checkpoint->row);
+    free(checkpoint->manifest_path);
+    free(checkpoint->data_path);
+}
@@ -0,0 +1,42 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+// The size of the manifest (the settings text and the progress):
+#define MAX_MANIFEST_LENGTH 4096
+
+// Keeps the finished rows of a render on disk, so an interrupted render can pick up where it stopped.
+// The rows go to <output>.checkpoint (RGB8, top to bottom). <output>.manifest describes the render (whatever affects the pixels)
+// and how many rows are done. It is only updated (atomically) once the rows are safely on disk:
+typedef struct _checkpoint_t_
+{
+    char* data_path;
+    char* manifest_path;
+    FILE* data_file;
+
+    // What we render (a manifest for different settings belongs to a different render):
+    char settings[MAX_MANIFEST_LENGTH];
+
+    int width;
+    int rows_done;
+
+    // Converts rows between RGBA8 and RGB8:
+    uint8_t* row;
+} checkpoint_t;
+
+// Open the checkpoint of an output file. If there's one for the same settings, we resume it (see rows_done), otherwise we start over.
+// Returns 0 (after printing why) if there's a checkpoint for different settings or the files are broken:
+int open_checkpoint(checkpoint_t* checkpoint, const char* output_path, const char* settings, int width);
+
+// Read finished rows back as RGBA8 (rows [y, y + row_count) with y + row_count <= rows_done):
+int read_checkpoint_rows(checkpoint_t* checkpoint, int y, int row_count, uint8_t* pixels);
+
+// Add the next finished RGBA8 rows and record the progress:
+int append_checkpoint_rows(checkpoint_t* checkpoint, const uint8_t* pixels, int row_count);
+
+// Close the checkpoint and remove its files if the render is complete:
+void close_checkpoint(checkpoint_t* checkpoint, int is_complete);
+
+#endif
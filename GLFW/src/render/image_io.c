@@ -0,0 +1,267 @@
+#include "image_io.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <zlib.h>
+
+// Does the path end in the given extension (ignoring case)?
+static int has_extension(const char* file_path, const char* extension)
+{
+    size_t path_length = strlen(file_path);
+    size_t extension_length = strlen(extension);
+
+    if (path_length < extension_length)
+    {
+        return 0;
+    }
+
+    for (size_t i = 0; i < extension_length; i++)
+    {
+        char c = file_path[path_length - extension_length + i];
+
+        if ((c >= 'A') && (c <= 'Z'))
+        {
+            c += 'a' - 'A';
+        }
+
+        if (c != extension[i])
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+int is_supported_image_path(const char* file_path)
+{
+    return has_extension(file_path, ".png") || has_extension(file_path, ".ppm");
+}
+
+// The size of the IDAT chunks we write:
+#define PNG_CHUNK_SIZE (1 << 20)
+
+// Write a PNG chunk (length, type, data, CRC over type and data):
+static int write_png_chunk(FILE* file, const char* type, const uint8_t* data, uint32_t length)
+{
+    uint8_t header[8] = { length >> 24, length >> 16, length >> 8, length, type[0], type[1], type[2], type[3] };
+
+    uLong crc = crc32(0, header + 4, 4);
+
+    if (length)
+    {
+        crc = crc32(crc, data, length);
+    }
+
+    uint8_t footer[4] = { crc >> 24, crc >> 16, crc >> 8, crc };
+
+    return (fwrite(header, 1, 8, file) == 8) && (!length || (fwrite(data, 1, length, file) == length)) && (fwrite(footer, 1, 4, file) == 4);
+}
+
+// Feed the deflate stream, writing an IDAT chunk whenever the output buffer is full (or everything is flushed when finishing):
+static int deflate_png_data(image_writer_t* writer, const uint8_t* data, size_t length, int flush)
+{
+    z_stream* stream = &writer->stream;
+
+    stream->next_in = (Bytef*)data;
+    stream->avail_in = (uInt)length;
+
+    for (;;)
+    {
+        int result = deflate(stream, flush);
+
+        if ((result != Z_OK) && (result != Z_STREAM_END) && (result != Z_BUF_ERROR))
+        {
+            return 0;
+        }
+
+        int is_done = (flush == Z_FINISH) ? (result == Z_STREAM_END) : (stream->avail_out != 0);
+
+        if ((stream->avail_out == 0) || (is_done && (flush == Z_FINISH)))
+        {
+            uint32_t chunk_length = PNG_CHUNK_SIZE - stream->avail_out;
+
+            if (chunk_length && !write_png_chunk(writer->file, "IDAT", writer->compressed, chunk_length))
+            {
+                return 0;
+            }
+
+            stream->next_out = writer->compressed;
+            stream->avail_out = PNG_CHUNK_SIZE;
+        }
+
+        if (is_done)
+        {
+            return 1;
+        }
+    }
+}
+
+int open_image_writer(image_writer_t* writer, const char* file_path, int width, int height)
+{
+    if (!is_supported_image_path(file_path))
+    {
+        *writer = (image_writer_t){ .file_path = file_path };
+
+        fprintf(stderr, "Unknown image format (use .png or .ppm): %s\n", file_path);
+        return 0;
+    }
+
+    FILE* file = fopen(file_path, "wb");
+
+    if (!file)
+    {
+        *writer = (image_writer_t){ .file_path = file_path };
+
+        fprintf(stderr, "Failed to open file: %s\n", file_path);
+        return 0;
+    }
+
+    return open_image_stream_writer(writer, file, file_path, has_extension(file_path, ".png"), width, height);
+}
+
+int open_image_stream_writer(image_writer_t* writer, FILE* file, const char* name, int is_png, int width, int height)
+{
+    *writer = (image_writer_t){ .file = file, .file_path = name, .size = { width, height }, .is_png = is_png, .is_ok = 1 };
+
+    writer->row = malloc(1 + (3 * (size_t)width));
+    writer->compressed = is_png ? malloc(PNG_CHUNK_SIZE) : NULL;
+
+    if (!writer->row || (is_png && !writer->compressed))
+    {
+        fprintf(stderr, "Failed to allocate memory for a %d pixel row\n", width);
+        exit(EXIT_FAILURE);
+    }
+
+    if (!writer->is_png)
+    {
+        // Binary RGB:
+        writer->is_ok = fprintf(writer->file, "P6\n%d %d\n255\n", width, height) > 0;
+    }
+    else
+    {
+        if (deflateInit(&writer->stream, Z_DEFAULT_COMPRESSION) != Z_OK)
+        {
+            fprintf(stderr, "Failed to initialize compression: %s\n", name);
+            exit(EXIT_FAILURE);
+        }
+
+        writer->stream.next_out = writer->compressed;
+        writer->stream.avail_out = PNG_CHUNK_SIZE;
+
+        // 8 bits per channel, RGB, default compression / filtering, no interlacing:
+        static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+        uint8_t header[13] = { width >> 24, width >> 16, width >> 8, width, height >> 24, height >> 16, height >> 8, height, 8, 2, 0, 0, 0 };
+
+        writer->is_ok = (fwrite(signature, 1, 8, writer->file) == 8) && write_png_chunk(writer->file, "IHDR", header, sizeof(header));
+    }
+
+    if (!writer->is_ok)
+    {
+        fprintf(stderr, "Failed to write file: %s\n", name);
+    }
+
+    return writer->is_ok;
+}
+
+int write_image_rows(image_writer_t* writer, const uint8_t* pixels, int row_count)
+{
+    int width = writer->size[0];
+
+    if ((writer->rows_written + row_count) > writer->size[1])
+    {
+        fprintf(stderr, "Too many rows for a %d x %d image: %s\n", width, writer->size[1], writer->file_path);
+        writer->is_ok = 0;
+    }
+
+    for (int y = 0; writer->is_ok && (y < row_count); y++)
+    {
+        const uint8_t* source = pixels + (4 * (size_t)y * width);
+
+        if (!writer->is_png)
+        {
+            for (int x = 0; x < width; x++)
+            {
+                memcpy(writer->row + (3 * x), source + (4 * x), 3);
+            }
+
+            writer->is_ok = fwrite(writer->row, 3, width, writer->file) == (size_t)width;
+        }
+        else
+        {
+            // Every row is prefixed with its filter type. We use "sub" (the difference to the left neighbour),
+            // which suits the smooth palette gradients well:
+            uint8_t* target = writer->row;
+
+            target[0] = 1;
+
+            for (int x = 0; x < width; x++)
+            {
+                for (int c = 0; c < 3; c++)
+                {
+                    target[1 + (3 * x) + c] = source[(4 * x) + c] - ((x > 0) ? source[(4 * (x - 1)) + c] : 0);
+                }
+            }
+
+            writer->is_ok = deflate_png_data(writer, writer->row, 1 + (3 * (size_t)width), Z_NO_FLUSH);
+        }
+
+        if (!writer->is_ok)
+        {
+            fprintf(stderr, "Failed to write file: %s\n", writer->file_path);
+        }
+    }
+
+    writer->rows_written += row_count;
+
+    return writer->is_ok;
+}
+
+int close_image_writer(image_writer_t* writer)
+{
+    if (writer->is_ok && (writer->rows_written != writer->size[1]))
+    {
+        fprintf(stderr, "Only %d of %d rows written: %s\n", writer->rows_written, writer->size[1], writer->file_path);
+        writer->is_ok = 0;
+    }
+
+    if (writer->is_png && writer->file)
+    {
+        if (writer->is_ok)
+        {
+            writer->is_ok = deflate_png_data(writer, NULL, 0, Z_FINISH) && write_png_chunk(writer->file, "IEND", NULL, 0);
+
+            if (!writer->is_ok)
+            {
+                fprintf(stderr, "Failed to write file: %s\n", writer->file_path);
+            }
+        }
+
+        deflateEnd(&writer->stream);
+    }
+
+    if (writer->file && fclose(writer->file) && writer->is_ok)
+    {
+        fprintf(stderr, "Failed to write file: %s\n", writer->file_path);
+        writer->is_ok = 0;
+    }
+
+    free(writer->compressed);
+    free(writer->row);
+
+    return writer->is_ok;
+}
+
+int write_image(const char* file_path, int width, int height, const uint8_t* pixels)
+{
+    image_writer_t writer;
+
+    if (open_image_writer(&writer, file_path, width, height))
+    {
+        write_image_rows(&writer, pixels, height);
+    }
+
+    return close_image_writer(&writer);
+}
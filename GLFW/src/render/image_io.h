@@ -0,0 +1,46 @@
+#ifndef IMAGE_IO_H
+#define IMAGE_IO_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <zlib.h>
+
+// Writes an image file row by row, so we never need the whole image in memory.
+// The format is picked by the extension (.png or .ppm), the rows are RGBA8 (alpha is dropped) from top to bottom:
+typedef struct _image_writer_t_
+{
+    FILE* file;
+    const char* file_path;
+
+    int size[2];
+    int rows_written;
+
+    int is_png;
+
+    // Has every write succeeded so far?
+    int is_ok;
+
+    // A converted row (PNG rows start with their filter type):
+    uint8_t* row;
+
+    // PNG only: the deflate stream and its output (flushed as IDAT chunks):
+    z_stream stream;
+    uint8_t* compressed;
+} image_writer_t;
+
+// Is the format (extension) of the path one we can write?
+int is_supported_image_path(const char* file_path);
+
+// The functions below return 0 (after printing why) on failure. Always close an opened writer:
+int open_image_writer(image_writer_t* writer, const char* file_path, int width, int height);
+
+// Write to an open stream instead (e.g. one in memory), which close_image_writer closes as well. The name is for messages:
+int open_image_stream_writer(image_writer_t* writer, FILE* file, const char* name, int is_png, int width, int height);
+int write_image_rows(image_writer_t* writer, const uint8_t* pixels, int row_count);
+int close_image_writer(image_writer_t* writer);
+
+// Write a whole image at once:
+int write_image(const char* file_path, int width, int height, const uint8_t* pixels);
+
+#endif
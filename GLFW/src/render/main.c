@@ -0,0 +1,877 @@
+#include <float.h>
+#include <getopt.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "batch.h"
+#include "checkpoint.h"
+#include "cpu_renderer.h"
+#include "double_double.h"
+#include "file_io.h"
+#include "hue_table.h"
+#include "image_io.h"
+#include "pyramid.h"
+#include "renderer.h"
+#include "tile_server.h"
+#include "user_info.h"
+#include "viewport.h"
+#include "zoom_video.h"
+
+// Defaults:
+#define DEFAULT_WIDTH 1920
+#define DEFAULT_HEIGHT 1080
+#define DEFAULT_ITERATIONS 500
+#define DEFAULT_FRAMES_PER_OCTAVE 60
+#define DEFAULT_SERVER_ADDRESS "127.0.0.1"
+
+// Limits (the others are the same as in the viewer):
+#define MAX_IMAGE_SIZE 65536
+
+// Posters are rendered and written in bands of rows, on the GPU in tiles of at most this width:
+#define POSTER_BAND_HEIGHT 256
+#define POSTER_TILE_WIDTH 4096
+
+// The most options (and the output) on a job line:
+#define MAX_JOB_ARGUMENTS 64
+
+// Macros:
+#define MIN(a, b) (((a) < (b)) ? (a) : (b))
+
+// Everything the command line tells us:
+typedef struct _render_options_t_
+{
+    viewport_t viewport;
+
+    renderer_settings_t renderer;
+
+    // Render (and write) in bands, so memory stays bounded?
+    int is_poster;
+
+    // Keep the finished bands on disk, so we can resume (implies is_poster)?
+    int is_checkpointing;
+
+    // Render a zoom video (from the viewport's scale to this one) instead of an image (0 if not)?
+    double zoom_end_scale;
+    int frames_per_octave;
+
+    // "-" is stdout (videos only):
+    const char* output_path;
+
+    // Render the images of a job list instead (NULL if not)?
+    const char* batch_path;
+
+    // Write a tile pyramid (to output_path) instead?
+    int is_pyramid;
+    pyramid_format_t pyramid_format;
+
+    // Serve tiles over HTTP instead?
+    int is_serving;
+    tile_server_settings_t server;
+} render_options_t;
+
+// Where the options come from (a job line, NULL for the command line), so errors can point there:
+static const char* option_source = NULL;
+
+static void print_usage(FILE* stream)
+{
+    fprintf(stream,
+        "Usage: mandel-render [options] <output.png|output.ppm>\n"
+        "       mandel-render [options] --zoom-to <scale> <output.rgb|->\n"
+        "       mandel-render [options] --pyramid <dzi|xyz> <output.dzi|directory>\n"
+        "       mandel-render [options] --batch <jobs.txt>\n"
+        "       mandel-render [options] --serve [<address>:]<port>\n"
+        "\n"
+        "Renders the Mandelbrot set without a window (no display needed).\n"
+        "\n"
+        "Options:\n"
+        "  --position-x <value>   Real part of the center (default: 0)\n"
+        "  --position-y <value>   Imaginary part of the center (default: 0)\n"
+        "  --scale <value>        Pixels per unit (default: the whole set fits)\n"
+        "  --iterations <count>   Iteration limit (default: %d)\n"
+        "  --palette <name>       fire, ice, ash or psychedelic (default: fire)\n"
+        "  --hue-density <value>  Palette repetitions over the iteration range, %g to %g (default: %g)\n"
+        "  --hue-offset <value>   Palette shift, 0 to 1 (default: 0)\n"
+        "  --width <pixels>       Image width (default: %d)\n"
+        "  --height <pixels>      Image height (default: %d)\n"
+        "  --threads <count>      Render threads (default: one per core)\n"
+        "  --backend <name>       cpu or gl (offscreen OpenGL ES 3, default: cpu)\n"
+        "  --precision <name>     auto, float, fp64, df64 or perturbation (gl only, default: auto, fp64 runs as df64 on ES)\n"
+        "  --validate             Compare the gl image with the CPU renderer\n"
+        "  --poster               Render and write in bands of %d rows (for huge images, memory stays bounded)\n"
+        "  --checkpoint           Keep finished bands in <output>.checkpoint (implies --poster),\n"
+        "                         running the same command again resumes an interrupted render\n"
+        "  --zoom-to <scale>      Render a video zooming into the center until this scale, as raw RGB frames\n"
+        "                         (\"-\" writes them to stdout, e.g. for ffmpeg -f rawvideo -pix_fmt rgb24 -s <width>x<height> -i -)\n"
+        "  --frames-per-octave <count>  Video frames per doubling of the scale (default: %d)\n"
+        "  --pyramid <format>     Write the image as 256 x 256 tiles on every zoom level, for deep zoom viewers:\n"
+        "                         dzi (<output>.dzi and <output>_files/, e.g. OpenSeadragon) or xyz (<directory>/<z>/<x>/<y>.png,\n"
+        "                         e.g. Leaflet). Only the finest level is rendered, the others are halved from it\n"
+        "  --batch <jobs.txt>     Render a list of images, one per line like \"--position-x -0.75 --scale 800 --palette ice out.png\"\n"
+        "                         (view and coloring options only, the command line provides the defaults and everything else)\n"
+        "  --serve [<address>:]<port>  Serve 256 x 256 tiles over HTTP at /<z>/<x>/<y>?iter=<count>&palette=<name>&format=<png|raw>\n"
+        "                         (default address: %s, the iterations and coloring options provide the defaults)\n"
+        "  --tile-store <file>    Keep served tiles in this file across restarts (created if needed)\n"
+        "  --help                 Show this text\n",
+        DEFAULT_ITERATIONS, MIN_HUE_DENSITY, MAX_HUE_DENSITY, MIN_HUE_DENSITY, DEFAULT_WIDTH, DEFAULT_HEIGHT, POSTER_BAND_HEIGHT, DEFAULT_FRAMES_PER_OCTAVE, DEFAULT_SERVER_ADDRESS);
+}
+
+static void print_option_source(void)
+{
+    if (option_source)
+    {
+        fprintf(stderr, "%s: ", option_source);
+    }
+}
+
+static void fail_option(const char* name, const char* value)
+{
+    print_option_source();
+    fprintf(stderr, "Invalid value for --%s: %s\n\n", name, value);
+    print_usage(stderr);
+    exit(EXIT_FAILURE);
+}
+
+static double parse_double_option(const char* name, const char* value, double min, double max)
+{
+    char* end;
+    double result = strtod(value, &end);
+
+    if ((end == value) || *end || !(result >= min) || !(result <= max))
+    {
+        fail_option(name, value);
+    }
+
+    return result;
+}
+
+static int parse_int_option(const char* name, const char* value, int min, int max)
+{
+    char* end;
+    long result = strtol(value, &end, 10);
+
+    if ((end == value) || *end || (result < min) || (result > max))
+    {
+        fail_option(name, value);
+    }
+
+    return (int)result;
+}
+
+// Returns PRECISION_TIER_COUNT if there's no such tier:
+static precision_tier_t find_precision_tier(const char* name)
+{
+    for (int i = 0; i < PRECISION_TIER_COUNT; i++)
+    {
+        if (!strcmp(name, precision_tier_names[i]))
+        {
+            return (precision_tier_t)i;
+        }
+    }
+
+    return PRECISION_TIER_COUNT;
+}
+
+// A scale of 0 means "fit the whole set":
+static void set_default_options(render_options_t* options)
+{
+    options->viewport.position[0] = dd_from_double(0);
+    options->viewport.position[1] = dd_from_double(0);
+    options->viewport.scale = 0;
+    options->viewport.size[0] = DEFAULT_WIDTH;
+    options->viewport.size[1] = DEFAULT_HEIGHT;
+    options->viewport.iterations = DEFAULT_ITERATIONS;
+
+    options->renderer.backend = BACKEND_CPU;
+    options->renderer.precision_tier = PRECISION_TIER_COUNT;
+    options->renderer.is_validating = 0;
+    options->renderer.palette = 0;
+    options->renderer.hue_density = MIN_HUE_DENSITY;
+    options->renderer.hue_offset = 0;
+    options->renderer.thread_count = cpu_thread_count();
+
+    options->is_poster = 0;
+    options->is_checkpointing = 0;
+    options->zoom_end_scale = 0;
+    options->frames_per_octave = DEFAULT_FRAMES_PER_OCTAVE;
+    options->output_path = NULL;
+    options->batch_path = NULL;
+
+    options->is_pyramid = 0;
+    options->pyramid_format = PYRAMID_FORMAT_DEEPZOOM;
+
+    options->is_serving = 0;
+    options->server.address = DEFAULT_SERVER_ADDRESS;
+    options->server.port = 0;
+    options->server.tile_store_path = NULL;
+}
+
+// Job lines start from the command line options (is_job), and only set the view and coloring:
+static void parse_options(int argc, char** argv, render_options_t* options, int is_job)
+{
+    enum
+    {
+        OPTION_POSITION_X = 256,
+        OPTION_POSITION_Y,
+        OPTION_SCALE,
+        OPTION_ITERATIONS,
+        OPTION_PALETTE,
+        OPTION_HUE_DENSITY,
+        OPTION_HUE_OFFSET,
+        OPTION_WIDTH,
+        OPTION_HEIGHT,
+        OPTION_THREADS,
+        OPTION_BACKEND,
+        OPTION_PRECISION,
+        OPTION_VALIDATE,
+        OPTION_POSTER,
+        OPTION_CHECKPOINT,
+        OPTION_ZOOM_TO,
+        OPTION_FRAMES_PER_OCTAVE,
+        OPTION_BATCH,
+        OPTION_PYRAMID,
+        OPTION_SERVE,
+        OPTION_TILE_STORE,
+        OPTION_HELP
+    };
+
+    static const struct option long_options[] =
+    {
+        { "position-x", required_argument, NULL, OPTION_POSITION_X },
+        { "position-y", required_argument, NULL, OPTION_POSITION_Y },
+        { "scale", required_argument, NULL, OPTION_SCALE },
+        { "iterations", required_argument, NULL, OPTION_ITERATIONS },
+        { "palette", required_argument, NULL, OPTION_PALETTE },
+        { "hue-density", required_argument, NULL, OPTION_HUE_DENSITY },
+        { "hue-offset", required_argument, NULL, OPTION_HUE_OFFSET },
+        { "width", required_argument, NULL, OPTION_WIDTH },
+        { "height", required_argument, NULL, OPTION_HEIGHT },
+        { "threads", required_argument, NULL, OPTION_THREADS },
+        { "backend", required_argument, NULL, OPTION_BACKEND },
+        { "precision", required_argument, NULL, OPTION_PRECISION },
+        { "validate", no_argument, NULL, OPTION_VALIDATE },
+        { "poster", no_argument, NULL, OPTION_POSTER },
+        { "checkpoint", no_argument, NULL, OPTION_CHECKPOINT },
+        { "zoom-to", required_argument, NULL, OPTION_ZOOM_TO },
+        { "frames-per-octave", required_argument, NULL, OPTION_FRAMES_PER_OCTAVE },
+        { "batch", required_argument, NULL, OPTION_BATCH },
+        { "pyramid", required_argument, NULL, OPTION_PYRAMID },
+        { "serve", required_argument, NULL, OPTION_SERVE },
+        { "tile-store", required_argument, NULL, OPTION_TILE_STORE },
+        { "help", no_argument, NULL, OPTION_HELP },
+        { NULL, 0, NULL, 0 }
+    };
+
+    option_source = is_job ? argv[0] : NULL;
+
+    if (!is_job)
+    {
+        set_default_options(options);
+    }
+
+    int option;
+    int option_index;
+
+    while ((option = getopt_long(argc, argv, "", long_options, &option_index)) != -1)
+    {
+        // The options after the image size are about how we render, not what:
+        if (is_job && (option >= OPTION_THREADS) && (option <= OPTION_HELP))
+        {
+            print_option_source();
+            fprintf(stderr, "--%s can't be used in a job list\n", long_options[option_index].name);
+            exit(EXIT_FAILURE);
+        }
+
+        switch (option)
+        {
+            case OPTION_POSITION_X:
+                if (!dd_parse(optarg, &options->viewport.position[0]))
+                {
+                    fail_option("position-x", optarg);
+                }
+                break;
+
+            case OPTION_POSITION_Y:
+                if (!dd_parse(optarg, &options->viewport.position[1]))
+                {
+                    fail_option("position-y", optarg);
+                }
+                break;
+
+            case OPTION_SCALE:
+                options->viewport.scale = parse_double_option("scale", optarg, DBL_MIN, DBL_MAX);
+                break;
+
+            case OPTION_ITERATIONS:
+                options->viewport.iterations = parse_int_option("iterations", optarg, MIN_ITERATIONS, MAX_ITERATIONS);
+                break;
+
+            case OPTION_PALETTE:
+                options->renderer.palette = find_palette(optarg);
+
+                if (options->renderer.palette < 0)
+                {
+                    fail_option("palette", optarg);
+                }
+                break;
+
+            case OPTION_HUE_DENSITY:
+                options->renderer.hue_density = parse_double_option("hue-density", optarg, MIN_HUE_DENSITY, MAX_HUE_DENSITY);
+                break;
+
+            case OPTION_HUE_OFFSET:
+                options->renderer.hue_offset = parse_double_option("hue-offset", optarg, 0.0, 1.0);
+                break;
+
+            case OPTION_WIDTH:
+                options->viewport.size[0] = parse_int_option("width", optarg, 1, MAX_IMAGE_SIZE);
+                break;
+
+            case OPTION_HEIGHT:
+                options->viewport.size[1] = parse_int_option("height", optarg, 1, MAX_IMAGE_SIZE);
+                break;
+
+            case OPTION_THREADS:
+                options->renderer.thread_count = parse_int_option("threads", optarg, 1, 4096);
+                break;
+
+            case OPTION_BACKEND:
+                if (!strcmp(optarg, "cpu"))
+                {
+                    options->renderer.backend = BACKEND_CPU;
+                }
+                else if (!strcmp(optarg, "gl"))
+                {
+                    options->renderer.backend = BACKEND_GL;
+                }
+                else
+                {
+                    fail_option("backend", optarg);
+                }
+                break;
+
+            case OPTION_PRECISION:
+                options->renderer.precision_tier = find_precision_tier(optarg);
+
+                if ((options->renderer.precision_tier == PRECISION_TIER_COUNT) && strcmp(optarg, "auto"))
+                {
+                    fail_option("precision", optarg);
+                }
+                break;
+
+            case OPTION_VALIDATE:
+                options->renderer.is_validating = 1;
+                break;
+
+            case OPTION_POSTER:
+                options->is_poster = 1;
+                break;
+
+            case OPTION_CHECKPOINT:
+                options->is_checkpointing = 1;
+                options->is_poster = 1;
+                break;
+
+            case OPTION_ZOOM_TO:
+                options->zoom_end_scale = parse_double_option("zoom-to", optarg, DBL_MIN, DBL_MAX);
+                break;
+
+            case OPTION_FRAMES_PER_OCTAVE:
+                options->frames_per_octave = parse_int_option("frames-per-octave", optarg, 1, 100000);
+                break;
+
+            case OPTION_BATCH:
+                options->batch_path = optarg;
+                break;
+
+            case OPTION_PYRAMID:
+                if (!strcmp(optarg, "dzi"))
+                {
+                    options->pyramid_format = PYRAMID_FORMAT_DEEPZOOM;
+                }
+                else if (!strcmp(optarg, "xyz"))
+                {
+                    options->pyramid_format = PYRAMID_FORMAT_XYZ;
+                }
+                else
+                {
+                    fail_option("pyramid", optarg);
+                }
+
+                options->is_pyramid = 1;
+                break;
+
+            case OPTION_SERVE:
+            {
+                // The address is optional (it is modified in place, like the job lines):
+                char* port = strrchr(optarg, ':');
+
+                if (port)
+                {
+                    *port++ = 0;
+                    options->server.address = optarg;
+                }
+                else
+                {
+                    port = optarg;
+                }
+
+                options->server.port = parse_int_option("serve", port, 0, 65535);
+                options->is_serving = 1;
+                break;
+            }
+
+            case OPTION_TILE_STORE:
+                options->server.tile_store_path = optarg;
+                break;
+
+            case OPTION_HELP:
+                print_usage(stdout);
+                exit(EXIT_SUCCESS);
+
+            default:
+                print_usage(stderr);
+                exit(EXIT_FAILURE);
+        }
+    }
+
+    // Tiles are all about the view, the options only provide the defaults:
+    if (options->is_serving)
+    {
+        if ((optind != argc) || options->batch_path || options->is_poster || (options->zoom_end_scale != 0) || options->is_pyramid)
+        {
+            fprintf(stderr, "The tile server takes no output file (and renders no posters, videos, pyramids or batches).\n");
+            exit(EXIT_FAILURE);
+        }
+
+        options->server.iterations = options->viewport.iterations;
+
+        return;
+    }
+
+    if (options->server.tile_store_path)
+    {
+        fprintf(stderr, "--tile-store only works with --serve.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // The job list has the output files (and the defaults of the jobs aren't resolved yet):
+    if (options->batch_path)
+    {
+        if ((optind != argc) || options->is_poster || (options->zoom_end_scale != 0) || options->is_pyramid)
+        {
+            fprintf(stderr, "Batches take images (no posters, videos or pyramids) and their output files from the job list.\n");
+            exit(EXIT_FAILURE);
+        }
+
+        return;
+    }
+
+    if (optind != (argc - 1))
+    {
+        print_option_source();
+        fprintf(stderr, "Expected exactly one output file.\n\n");
+        print_usage(stderr);
+        exit(EXIT_FAILURE);
+    }
+
+    options->output_path = argv[optind];
+
+    // The set lies within [-2, 2] x [-1.5, 1.5]:
+    if (options->viewport.scale == 0)
+    {
+        options->viewport.scale = MIN(options->viewport.size[0] / 4.0, options->viewport.size[1] / 3.0);
+    }
+
+    // Pyramids are always rendered in bands:
+    if (options->is_pyramid)
+    {
+        if (options->is_poster || (options->zoom_end_scale != 0))
+        {
+            fprintf(stderr, "Pyramids can't be rendered as posters or videos.\n");
+            exit(EXIT_FAILURE);
+        }
+
+        size_t length = strlen(options->output_path);
+
+        if ((options->pyramid_format == PYRAMID_FORMAT_DEEPZOOM) && ((length <= 4) || strcmp(options->output_path + length - 4, ".dzi")))
+        {
+            fprintf(stderr, "DeepZoom pyramids need a .dzi file: %s\n", options->output_path);
+            exit(EXIT_FAILURE);
+        }
+
+        return;
+    }
+
+    if (options->zoom_end_scale != 0)
+    {
+        if (options->is_poster)
+        {
+            fprintf(stderr, "Videos can't be rendered as posters.\n");
+            exit(EXIT_FAILURE);
+        }
+
+        if (options->zoom_end_scale < options->viewport.scale)
+        {
+            fprintf(stderr, "Videos zoom in, --zoom-to has to be at least the scale (%g).\n", options->viewport.scale);
+            exit(EXIT_FAILURE);
+        }
+
+        // The keyframes have twice the frame size:
+        if ((options->viewport.size[0] < 2) || (options->viewport.size[1] < 2) ||
+            ((4 * (int64_t)options->viewport.size[0] * options->viewport.size[1]) > INT32_MAX))
+        {
+            fprintf(stderr, "Invalid video size: %d x %d\n", options->viewport.size[0], options->viewport.size[1]);
+            exit(EXIT_FAILURE);
+        }
+
+        return;
+    }
+
+    if (!is_supported_image_path(options->output_path))
+    {
+        print_option_source();
+        fprintf(stderr, "Unknown image format (use .png or .ppm): %s\n", options->output_path);
+        exit(EXIT_FAILURE);
+    }
+
+    // The pixel count (of a band) has to fit into an int:
+    if (!options->is_poster && (((int64_t)options->viewport.size[0] * options->viewport.size[1]) > INT32_MAX))
+    {
+        print_option_source();
+        fprintf(stderr, "The image is too large: %d x %d (use --poster)\n", options->viewport.size[0], options->viewport.size[1]);
+        exit(EXIT_FAILURE);
+    }
+}
+
+static double get_time(void)
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return time.tv_sec + (1e-9 * time.tv_nsec);
+}
+
+// Everything that affects the pixels, as text for the checkpoint manifest (doubles in hex, so they are exact):
+static void format_settings(const render_options_t* options, char* settings, size_t length)
+{
+    const viewport_t* viewport = &options->viewport;
+
+    snprintf(settings, length,
+        "position-x = %a %a\n"
+        "position-y = %a %a\n"
+        "scale = %a\n"
+        "size = %d %d\n"
+        "iterations = %d\n"
+        "palette = %s\n"
+        "hue-density = %a\n"
+        "hue-offset = %a\n"
+        "backend = %s\n"
+        "precision = %s\n",
+        viewport->position[0].hi, viewport->position[0].lo,
+        viewport->position[1].hi, viewport->position[1].lo,
+        viewport->scale,
+        viewport->size[0], viewport->size[1],
+        viewport->iterations,
+        palette_names[options->renderer.palette],
+        options->renderer.hue_density,
+        options->renderer.hue_offset,
+        (options->renderer.backend == BACKEND_GL) ? "gl" : "cpu",
+        (options->renderer.precision_tier == PRECISION_TIER_COUNT) ? "auto" : precision_tier_names[options->renderer.precision_tier]);
+}
+
+static int render_image(const render_options_t* options)
+{
+    const viewport_t* viewport = &options->viewport;
+    int width = viewport->size[0];
+    int height = viewport->size[1];
+
+    // Pick up the finished rows of an earlier run:
+    checkpoint_t checkpoint;
+    int first_row = 0;
+
+    if (options->is_checkpointing)
+    {
+        char settings[MAX_MANIFEST_LENGTH];
+        format_settings(options, settings, sizeof(settings));
+
+        if (!open_checkpoint(&checkpoint, options->output_path, settings, width) || (checkpoint.rows_done > height))
+        {
+            close_checkpoint(&checkpoint, 0);
+            return 0;
+        }
+
+        first_row = checkpoint.rows_done;
+    }
+
+    // Open the file before rendering, so we don't render for nothing:
+    image_writer_t writer;
+
+    if (!open_image_writer(&writer, options->output_path, width, height))
+    {
+        close_image_writer(&writer);
+
+        if (options->is_checkpointing)
+        {
+            close_checkpoint(&checkpoint, 0);
+        }
+
+        return 0;
+    }
+
+    // Posters go band by band (on the GPU in narrower tiles), everything else in one go:
+    int band_height = options->is_poster ? MIN(POSTER_BAND_HEIGHT, height) : height;
+    int band_count = (height + band_height - 1) / band_height;
+
+    renderer_t renderer;
+    init_renderer(&renderer, &options->renderer, width, band_height, options->is_poster ? POSTER_TILE_WIDTH : INT32_MAX);
+
+    uint8_t* pixels = malloc(4 * (size_t)width * band_height);
+
+    if (!pixels)
+    {
+        fprintf(stderr, "Failed to allocate memory for %d x %d pixels\n", width, band_height);
+        exit(EXIT_FAILURE);
+    }
+
+    printf("Rendering %d x %d pixels, %d iterations (%s) ...\n", width, height, viewport->iterations, renderer.name);
+
+    if (band_count > 1)
+    {
+        printf("Poster: %d bands of %d rows\n", band_count, band_height);
+    }
+
+    int is_ok = 1;
+
+    if (first_row > 0)
+    {
+        printf("Resuming at row %d of %d (from %s)\n", first_row, height, checkpoint.data_path);
+    }
+
+    for (int y = 0; is_ok && (y < first_row); y += band_height)
+    {
+        int row_count = MIN(band_height, first_row - y);
+
+        is_ok = read_checkpoint_rows(&checkpoint, y, row_count, pixels) && write_image_rows(&writer, pixels, row_count);
+    }
+
+    double start_time = get_time();
+    double render_time = 0;
+
+    // Every band goes straight to the file (and the checkpoint):
+    for (int y = first_row; is_ok && (y < height); y += band_height)
+    {
+        int row_count = MIN(band_height, height - y);
+        viewport_t band = get_sub_viewport(viewport, 0, y, width, row_count);
+        double band_start_time = get_time();
+
+        render_viewport(&renderer, &band, pixels);
+
+        render_time += get_time() - band_start_time;
+
+        is_ok = write_image_rows(&writer, pixels, row_count) && (!options->is_checkpointing || append_checkpoint_rows(&checkpoint, pixels, row_count));
+
+        if (is_ok && (band_count > 1))
+        {
+            printf("Rows %d to %d of %d done (%.1f s)\n", y, y + row_count - 1, height, get_time() - start_time);
+        }
+    }
+
+    int is_written = close_image_writer(&writer) && is_ok;
+
+    // Once the image is complete, we don't need the checkpoint anymore:
+    if (options->is_checkpointing)
+    {
+        close_checkpoint(&checkpoint, is_written);
+    }
+
+    printf("Rendered in %.3f s, written to %s in %.3f s.\n", render_time, options->output_path, get_time() - start_time - render_time);
+
+    free(pixels);
+    delete_renderer(&renderer);
+
+    return is_written;
+}
+
+static int render_pyramid(const render_options_t* options)
+{
+    pyramid_t pyramid = { .viewport = options->viewport, .format = options->pyramid_format, .output_path = options->output_path };
+
+    return write_pyramid(&pyramid, &options->renderer);
+}
+
+static int render_video(const render_options_t* options)
+{
+    zoom_video_t video = { .viewport = options->viewport, .end_scale = options->zoom_end_scale, .frames_per_octave = options->frames_per_octave };
+
+    FILE* file;
+
+    if (!strcmp(options->output_path, "-"))
+    {
+        // The frames get stdout to themselves, everything we (and the GL renderer) print goes to stderr:
+        int frame_fd = dup(STDOUT_FILENO);
+
+        if ((frame_fd < 0) || (dup2(STDERR_FILENO, STDOUT_FILENO) < 0) || !(file = fdopen(frame_fd, "wb")))
+        {
+            fprintf(stderr, "Failed to redirect stdout\n");
+            return 0;
+        }
+    }
+    else if (!(file = fopen(options->output_path, "wb")))
+    {
+        fprintf(stderr, "Failed to open file: %s\n", options->output_path);
+        return 0;
+    }
+
+    int is_written = write_zoom_video(&video, &options->renderer, file);
+
+    if (fclose(file) && is_written)
+    {
+        fprintf(stderr, "Failed to write file: %s\n", options->output_path);
+        is_written = 0;
+    }
+
+    if (is_written)
+    {
+        printf("Encode with: ffmpeg -f rawvideo -pix_fmt rgb24 -s %dx%d -r 60 -i <frames> zoom.mp4\n", video.viewport.size[0], video.viewport.size[1]);
+    }
+
+    return is_written;
+}
+
+// Parse the job list (all of it, so mistakes show up before we render anything).
+// The jobs point into the text, which has to be freed after them:
+static batch_job_t* read_jobs(const render_options_t* options, int* job_count, uint8_t** text)
+{
+    read_all_bytes(options->batch_path, 1, text);
+
+    // At most one job per line:
+    int line_count = 1;
+
+    for (const char* c = (const char*)*text; *c; c++)
+    {
+        line_count += (*c == '\n');
+    }
+
+    batch_job_t* jobs = malloc(line_count * sizeof(batch_job_t));
+    char* source = malloc(strlen(options->batch_path) + 16);
+
+    if (!jobs || !source)
+    {
+        fprintf(stderr, "Failed to allocate memory for %d jobs\n", line_count);
+        exit(EXIT_FAILURE);
+    }
+
+    *job_count = 0;
+
+    char* next_line = (char*)*text;
+
+    for (int line_number = 1; next_line; line_number++)
+    {
+        char* line = next_line;
+        next_line = strchr(line, '\n');
+
+        if (next_line)
+        {
+            *next_line++ = 0;
+        }
+
+        char* arguments[MAX_JOB_ARGUMENTS + 2];
+        int argument_count = 1;
+
+        char* argument_context;
+        char* argument = strtok_r(line, " \t\r", &argument_context);
+
+        // Skip empty lines and comments:
+        if (!argument || (argument[0] == '#'))
+        {
+            continue;
+        }
+
+        for (; argument; argument = strtok_r(NULL, " \t\r", &argument_context))
+        {
+            if (argument_count > MAX_JOB_ARGUMENTS)
+            {
+                fprintf(stderr, "%s:%d: Too many arguments\n", options->batch_path, line_number);
+                exit(EXIT_FAILURE);
+            }
+
+            arguments[argument_count++] = argument;
+        }
+
+        arguments[argument_count] = NULL;
+
+        // getopt reports its errors with the "program name":
+        sprintf(source, "%s:%d", options->batch_path, line_number);
+        arguments[0] = source;
+
+        render_options_t job_options = *options;
+        job_options.batch_path = NULL;
+
+        // Start over with the new arguments:
+        optind = 0;
+        parse_options(argument_count, arguments, &job_options, 1);
+
+        jobs[(*job_count)++] = (batch_job_t)
+        {
+            .viewport = job_options.viewport,
+            .palette = job_options.renderer.palette,
+            .hue_density = job_options.renderer.hue_density,
+            .hue_offset = job_options.renderer.hue_offset,
+            .output_path = job_options.output_path
+        };
+    }
+
+    option_source = NULL;
+    free(source);
+
+    return jobs;
+}
+
+static int render_batch(const render_options_t* options)
+{
+    int job_count;
+    uint8_t* text;
+    batch_job_t* jobs = read_jobs(options, &job_count, &text);
+
+    int failed_count = run_batch(jobs, job_count, &options->renderer);
+
+    free(jobs);
+    free(text);
+
+    return !failed_count;
+}
+
+int main(int argc, char** argv)
+{
+    render_options_t options;
+    parse_options(argc, argv, &options, 0);
+
+    int is_written;
+
+    if (options.is_serving)
+    {
+        is_written = run_tile_server(&options.server, &options.renderer);
+    }
+    else if (options.batch_path)
+    {
+        is_written = render_batch(&options);
+    }
+    else if (options.is_pyramid)
+    {
+        is_written = render_pyramid(&options);
+    }
+    else if (options.zoom_end_scale != 0)
+    {
+        is_written = render_video(&options);
+    }
+    else
+    {
+        is_written = render_image(&options);
+    }
+
+    return is_written ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,323 @@
+#include "offscreen_renderer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <EGL/eglext.h>
+
+#include "gl_renderer.h"
+#include "hue_table.h"
+#include "reference_orbit.h"
+
+// Macros:
+#define MIN(a, b) (((a) < (b)) ? (a) : (b))
+
+// Is the extension in the (space separated) list?
+static int has_egl_extension(const char* extensions, const char* name)
+{
+    size_t length = strlen(name);
+
+    while (extensions && *extensions)
+    {
+        const char* end = strchr(extensions, ' ');
+        size_t token_length = end ? (size_t)(end - extensions) : strlen(extensions);
+
+        if ((token_length == length) && !strncmp(extensions, name, length))
+        {
+            return 1;
+        }
+
+        extensions = end ? (end + 1) : NULL;
+    }
+
+    return 0;
+}
+
+static EGLDisplay get_egl_display(void)
+{
+    // Without a display server, Mesa's surfaceless platform is the way to go:
+    const char* client_extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+
+    if (has_egl_extension(client_extensions, "EGL_MESA_platform_surfaceless"))
+    {
+        PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+
+        if (get_platform_display)
+        {
+            EGLDisplay display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+
+            if ((display != EGL_NO_DISPLAY) && eglInitialize(display, NULL, NULL))
+            {
+                return display;
+            }
+        }
+    }
+
+    EGLDisplay display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    if ((display != EGL_NO_DISPLAY) && eglInitialize(display, NULL, NULL))
+    {
+        return display;
+    }
+
+    return EGL_NO_DISPLAY;
+}
+
+static int create_egl_context(offscreen_renderer_t* renderer)
+{
+    renderer->display = get_egl_display();
+
+    if (renderer->display == EGL_NO_DISPLAY)
+    {
+        fprintf(stderr, "Failed to initialize an EGL display.\n");
+        return 0;
+    }
+
+    if (!eglBindAPI(EGL_OPENGL_ES_API))
+    {
+        fprintf(stderr, "Failed to bind the OpenGL ES API.\n");
+        return 0;
+    }
+
+    // We never draw to a surface, but without surfaceless contexts we still need one to make the context current:
+    int is_surfaceless = has_egl_extension(eglQueryString(renderer->display, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context");
+
+    EGLint config_attributes[] =
+    {
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_ES3_BIT,
+        EGL_SURFACE_TYPE, is_surfaceless ? 0 : EGL_PBUFFER_BIT,
+        EGL_NONE
+    };
+
+    EGLConfig config;
+    EGLint config_count;
+
+    if (!eglChooseConfig(renderer->display, config_attributes, &config, 1, &config_count) || (config_count < 1))
+    {
+        fprintf(stderr, "Failed to find an EGL config for OpenGL ES 3.\n");
+        return 0;
+    }
+
+    EGLint context_attributes[] = { EGL_CONTEXT_MAJOR_VERSION, 3, EGL_CONTEXT_MINOR_VERSION, 0, EGL_NONE };
+
+    renderer->context = eglCreateContext(renderer->display, config, EGL_NO_CONTEXT, context_attributes);
+
+    if (renderer->context == EGL_NO_CONTEXT)
+    {
+        fprintf(stderr, "Failed to create an OpenGL ES 3 context.\n");
+        return 0;
+    }
+
+    renderer->surface = EGL_NO_SURFACE;
+
+    if (!is_surfaceless)
+    {
+        EGLint surface_attributes[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+
+        renderer->surface = eglCreatePbufferSurface(renderer->display, config, surface_attributes);
+
+        if (renderer->surface == EGL_NO_SURFACE)
+        {
+            fprintf(stderr, "Failed to create a pbuffer surface.\n");
+            return 0;
+        }
+    }
+
+    if (!eglMakeCurrent(renderer->display, renderer->surface, renderer->surface, renderer->context))
+    {
+        fprintf(stderr, "Failed to make the OpenGL ES 3 context current.\n");
+        return 0;
+    }
+
+    return 1;
+}
+
+// (Re-)allocate the render target:
+static void resize_target(offscreen_renderer_t* renderer, int width, int height)
+{
+    const char dbg_domain[] = "Resizing render target";
+
+    glBindRenderbuffer(GL_RENDERBUFFER, renderer->renderbuffer);
+    check_error(dbg_domain, "Failed to bind renderbuffer");
+
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    check_error(dbg_domain, "Failed to allocate renderbuffer");
+
+    glBindFramebuffer(GL_FRAMEBUFFER, renderer->framebuffer);
+    check_error(dbg_domain, "Failed to bind framebuffer");
+
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderer->renderbuffer);
+    check_error(dbg_domain, "Failed to attach renderbuffer");
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        fprintf(stderr, "[%s] Render target framebuffer is incomplete.\n", dbg_domain);
+        exit(EXIT_FAILURE);
+    }
+
+    glViewport(0, 0, width, height);
+    check_error(dbg_domain, "Failed to specify viewport");
+
+    renderer->size[0] = width;
+    renderer->size[1] = height;
+}
+
+int init_offscreen_renderer(offscreen_renderer_t* renderer)
+{
+    printf("Creating offscreen context ...\n");
+
+    if (!create_egl_context(renderer))
+    {
+        return 0;
+    }
+
+    // Ask GLAD to load all the shiny modern OpenGL stuff for us:
+    if (!gladLoadGLES2Loader((GLADloadproc)eglGetProcAddress))
+    {
+        fprintf(stderr, "Failed to load the OpenGL ES functions.\n");
+        return 0;
+    }
+
+    printf("Renderer: %s\n", (const char*)glGetString(GL_RENDERER));
+
+    // Initialize some GL features:
+    init_gl_features();
+
+    // The renderer state (the view is set per render):
+    user_info_t* user_info = &renderer->user_info;
+
+    *user_info = (user_info_t){ 0 };
+
+    user_info->precision_tier = PRECISION_TIER_FLOAT;
+    user_info->is_precision_tier_forced = 0;
+
+    // Keep every draw call short (long ones can trip GPU watchdogs):
+    user_info->is_progressive = 1;
+
+    user_info->hue_density = MIN_HUE_DENSITY;
+    user_info->palette = 0;
+
+    init_reference_orbit(&user_info->reference_orbit);
+
+    // The hue tables (for validating against the CPU renderer):
+    for (int i = 0; i < PALETTE_COUNT; i++)
+    {
+        load_hue_table(&user_info->hue_tables[i], palette_file_paths[i]);
+    }
+
+    init_gl_renderer(user_info);
+
+    // Our render target (allocated on the first render):
+    glGenFramebuffers(1, &renderer->framebuffer);
+    check_error("Initializing", "Failed to generate framebuffer");
+
+    glGenRenderbuffers(1, &renderer->renderbuffer);
+    check_error("Initializing", "Failed to generate renderbuffer");
+
+    renderer->size[0] = 0;
+    renderer->size[1] = 0;
+
+    user_info->target_framebuffer = renderer->framebuffer;
+
+    // The escape state textures have to fit as well:
+    GLint max_renderbuffer_size, max_texture_size;
+
+    glGetIntegerv(GL_MAX_RENDERBUFFER_SIZE, &max_renderbuffer_size);
+    check_error("Initializing", "Failed to retrieve maximum renderbuffer size");
+
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_texture_size);
+    check_error("Initializing", "Failed to retrieve maximum texture size");
+
+    renderer->max_size = MIN(max_renderbuffer_size, max_texture_size);
+
+    // Set the clear color:
+    glClearColor(0, 0, 0, 1);
+    check_error("Initializing", "Failed to specify clear color");
+
+    return 1;
+}
+
+// Iterate a viewport until all pixels are done (the colors are those of the selected palette):
+static void iterate_offscreen(offscreen_renderer_t* renderer, const viewport_t* viewport)
+{
+    user_info_t* user_info = &renderer->user_info;
+
+    if ((viewport->size[0] > renderer->max_size) || (viewport->size[1] > renderer->max_size))
+    {
+        fprintf(stderr, "The image is too large for the GPU: %d x %d (at most %d x %d)\n", viewport->size[0], viewport->size[1], renderer->max_size, renderer->max_size);
+        exit(EXIT_FAILURE);
+    }
+
+    if ((renderer->size[0] != viewport->size[0]) || (renderer->size[1] != viewport->size[1]))
+    {
+        resize_target(renderer, viewport->size[0], viewport->size[1]);
+    }
+
+    // One framebuffer pixel per window pixel, so the scale is in image pixels:
+    user_info->position[0] = viewport->position[0];
+    user_info->position[1] = viewport->position[1];
+    user_info->scale = viewport->scale;
+    user_info->iterations = viewport->iterations;
+
+    for (int axis = 0; axis < 2; axis++)
+    {
+        user_info->window_size[axis] = viewport->size[axis];
+        user_info->framebuffer_size[axis] = viewport->size[axis];
+    }
+
+    // Iterate slice by slice until the GPU reports that all pixels are done:
+    do
+    {
+        render_frame(user_info);
+    }
+    while (!is_frame_complete(user_info));
+}
+
+void render_offscreen(offscreen_renderer_t* renderer, const viewport_t* viewport, int palette, double hue_density, double hue_offset, uint8_t* pixels)
+{
+    user_info_t* user_info = &renderer->user_info;
+
+    select_palette(user_info, palette);
+    user_info->hue_density = hue_density;
+    user_info->hue_offset = hue_offset;
+
+    iterate_offscreen(renderer, viewport);
+    read_frame_pixels(user_info, pixels);
+}
+
+void render_offscreen_escape(offscreen_renderer_t* renderer, const viewport_t* viewport, uint32_t* iteration_state)
+{
+    iterate_offscreen(renderer, viewport);
+    read_iteration_state(&renderer->user_info, iteration_state);
+}
+
+void delete_offscreen_renderer(offscreen_renderer_t* renderer)
+{
+    user_info_t* user_info = &renderer->user_info;
+
+    glDeleteRenderbuffers(1, &renderer->renderbuffer);
+    check_error("Closing", "Failed to delete renderbuffer");
+
+    glDeleteFramebuffers(1, &renderer->framebuffer);
+    check_error("Closing", "Failed to delete framebuffer");
+
+    delete_gl_renderer(user_info);
+
+    for (int i = 0; i < PALETTE_COUNT; i++)
+    {
+        free_hue_table(&user_info->hue_tables[i]);
+    }
+
+    free_reference_orbit(&user_info->reference_orbit);
+
+    eglMakeCurrent(renderer->display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+
+    if (renderer->surface != EGL_NO_SURFACE)
+    {
+        eglDestroySurface(renderer->display, renderer->surface);
+    }
+
+    eglDestroyContext(renderer->display, renderer->context);
+    eglTerminate(renderer->display);
+}
@@ -0,0 +1,45 @@
+#ifndef OFFSCREEN_RENDERER_H
+#define OFFSCREEN_RENDERER_H
+
+#include <stdint.h>
+
+#include <EGL/egl.h>
+
+#include "user_info.h"
+#include "viewport.h"
+
+// Runs the GL renderer (the same shaders and passes as the viewer) on an offscreen EGL context, so it works without a display.
+// We prefer a surfaceless context (Mesa), otherwise we make do with a tiny pbuffer. Either way, we render into our own FBO.
+typedef struct _offscreen_renderer_t_
+{
+    EGLDisplay display;
+    EGLContext context;
+
+    // EGL_NO_SURFACE if the context is surfaceless:
+    EGLSurface surface;
+
+    // The render target (the user info draws into it) and its size:
+    GLuint framebuffer;
+    GLuint renderbuffer;
+    int size[2];
+
+    // The largest image we can render in one go:
+    int max_size;
+
+    // The renderer state (set precision_tier and is_precision_tier_forced to pick a tier):
+    user_info_t user_info;
+} offscreen_renderer_t;
+
+// Create the context and the GL renderer on it.
+// Returns 0 (after printing why) if there is no offscreen OpenGL ES 3 context:
+int init_offscreen_renderer(offscreen_renderer_t* renderer);
+
+// Render a viewport (iterating until all pixels are done) and read it back as RGBA8 (rows from top to bottom):
+void render_offscreen(offscreen_renderer_t* renderer, const viewport_t* viewport, int palette, double hue_density, double hue_offset, uint8_t* pixels);
+
+// The same, but read back the iteration state (size[0] * size[1] values, rows from top to bottom) instead of the colors:
+void render_offscreen_escape(offscreen_renderer_t* renderer, const viewport_t* viewport, uint32_t* iteration_state);
+
+void delete_offscreen_renderer(offscreen_renderer_t* renderer);
+
+#endif
@@ -0,0 +1,372 @@
+#include "pyramid.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include "image_io.h"
+
+// On the GPU, bands are rendered in tiles of at most this width:
+#define PYRAMID_GPU_TILE_WIDTH 4096
+
+// Enough for the output path plus level, column and row:
+#define PYRAMID_PATH_SLACK 64
+
+// Macros:
+#define MIN(a, b) (((a) < (b)) ? (a) : (b))
+#define MAX(a, b) (((a) > (b)) ? (a) : (b))
+
+// A level collects rows until it has a row of tiles to write, and passes every pair of rows on (halved) to the next coarser level:
+typedef struct _pyramid_level_t_
+{
+    int size[2];
+
+    // The rows of the current row of tiles (RGBA8) and how many we have:
+    uint8_t* rows;
+    int row_count;
+
+    // All rows we have got so far:
+    int rows_received;
+
+    // A row waiting for its partner, and where the halved pair goes:
+    uint8_t* pending_row;
+    int has_pending_row;
+    uint8_t* halved_row;
+} pyramid_level_t;
+
+typedef struct _pyramid_writer_t_
+{
+    const pyramid_t* pyramid;
+
+    pyramid_level_t* levels;
+    int level_count;
+
+    // DeepZoom: "<name>_files", XYZ: the directory:
+    char* tile_directory;
+    char* path;
+
+    // XYZ only (edge tiles are padded to the full size):
+    uint8_t* padded_tile;
+
+    int tile_count;
+    int is_ok;
+} pyramid_writer_t;
+
+static double get_time(void)
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return time.tv_sec + (1e-9 * time.tv_nsec);
+}
+
+static void* allocate(size_t size)
+{
+    void* memory = malloc(size);
+
+    if (!memory)
+    {
+        fprintf(stderr, "Failed to allocate %zu bytes for the pyramid\n", size);
+        exit(EXIT_FAILURE);
+    }
+
+    return memory;
+}
+
+int get_pyramid_level_count(const pyramid_t* pyramid)
+{
+    // DeepZoom goes down to a pixel, XYZ to a tile:
+    int smallest_size = (pyramid->format == PYRAMID_FORMAT_DEEPZOOM) ? 1 : PYRAMID_TILE_SIZE;
+    int size = MAX(pyramid->viewport.size[0], pyramid->viewport.size[1]);
+    int level_count = 1;
+
+    while (size > smallest_size)
+    {
+        size = (size + 1) / 2;
+        level_count++;
+    }
+
+    return level_count;
+}
+
+// Like mkdir -p for the last component (the parent has to exist):
+static int make_directory(const char* path)
+{
+    if (mkdir(path, 0755) && (errno != EEXIST))
+    {
+        fprintf(stderr, "Failed to create directory: %s\n", path);
+        return 0;
+    }
+
+    return 1;
+}
+
+static int make_level_directories(pyramid_writer_t* writer)
+{
+    if (!make_directory(writer->tile_directory))
+    {
+        return 0;
+    }
+
+    for (int level = 0; level < writer->level_count; level++)
+    {
+        sprintf(writer->path, "%s/%d", writer->tile_directory, level);
+
+        if (!make_directory(writer->path))
+        {
+            return 0;
+        }
+
+        // XYZ has a directory per column:
+        if (writer->pyramid->format == PYRAMID_FORMAT_XYZ)
+        {
+            int column_count = (writer->levels[level].size[0] + PYRAMID_TILE_SIZE - 1) / PYRAMID_TILE_SIZE;
+
+            for (int column = 0; column < column_count; column++)
+            {
+                sprintf(writer->path, "%s/%d/%d", writer->tile_directory, level, column);
+
+                if (!make_directory(writer->path))
+                {
+                    return 0;
+                }
+            }
+        }
+    }
+
+    return 1;
+}
+
+// Write the row of tiles a level has collected:
+static void write_tile_row(pyramid_writer_t* writer, int level_index)
+{
+    pyramid_level_t* level = &writer->levels[level_index];
+    int width = level->size[0];
+    int row = (level->rows_received - 1) / PYRAMID_TILE_SIZE;
+    int is_xyz = writer->pyramid->format == PYRAMID_FORMAT_XYZ;
+
+    for (int x = 0; writer->is_ok && (x < width); x += PYRAMID_TILE_SIZE)
+    {
+        int column = x / PYRAMID_TILE_SIZE;
+        int tile_width = MIN(PYRAMID_TILE_SIZE, width - x);
+
+        image_writer_t image_writer;
+
+        if (is_xyz)
+        {
+            sprintf(writer->path, "%s/%d/%d/%d.png", writer->tile_directory, level_index, column, row);
+
+            // The part outside the image stays black:
+            memset(writer->padded_tile, 0, 4 * PYRAMID_TILE_SIZE * PYRAMID_TILE_SIZE);
+
+            for (int y = 0; y < level->row_count; y++)
+            {
+                memcpy(writer->padded_tile + (4 * (size_t)y * PYRAMID_TILE_SIZE), level->rows + (4 * (((size_t)y * width) + x)), 4 * (size_t)tile_width);
+            }
+
+            writer->is_ok = write_image(writer->path, PYRAMID_TILE_SIZE, PYRAMID_TILE_SIZE, writer->padded_tile);
+        }
+        else
+        {
+            sprintf(writer->path, "%s/%d/%d_%d.png", writer->tile_directory, level_index, column, row);
+
+            // The rows of the band are wider than the tile, so they go one by one:
+            if (open_image_writer(&image_writer, writer->path, tile_width, level->row_count))
+            {
+                for (int y = 0; y < level->row_count; y++)
+                {
+                    write_image_rows(&image_writer, level->rows + (4 * (((size_t)y * width) + x)), 1);
+                }
+            }
+
+            writer->is_ok = close_image_writer(&image_writer);
+        }
+
+        writer->tile_count++;
+    }
+
+    level->row_count = 0;
+}
+
+// Average two rows (which may be the same) into one of half the width (rounded up, an odd last pixel only has itself):
+static void halve_rows(const uint8_t* top, const uint8_t* bottom, int width, uint8_t* halved)
+{
+    for (int x = 0; x < width; x += 2)
+    {
+        int right = MIN(x + 1, width - 1);
+
+        for (int c = 0; c < 4; c++)
+        {
+            int sum = top[(4 * x) + c] + top[(4 * right) + c] + bottom[(4 * x) + c] + bottom[(4 * right) + c];
+
+            halved[(2 * x) + c] = (uint8_t)((sum + 2) / 4);
+        }
+    }
+}
+
+static void push_row(pyramid_writer_t* writer, int level_index, const uint8_t* row)
+{
+    pyramid_level_t* level = &writer->levels[level_index];
+    size_t row_length = 4 * (size_t)level->size[0];
+
+    memcpy(level->rows + (level->row_count * row_length), row, row_length);
+    level->row_count++;
+    level->rows_received++;
+
+    int is_last_row = level->rows_received == level->size[1];
+
+    if ((level->row_count == PYRAMID_TILE_SIZE) || is_last_row)
+    {
+        write_tile_row(writer, level_index);
+    }
+
+    if (level_index == 0)
+    {
+        return;
+    }
+
+    // Pairs of rows make a row of the coarser level (an odd last row makes one by itself):
+    if (level->has_pending_row || is_last_row)
+    {
+        halve_rows(level->has_pending_row ? level->pending_row : row, row, level->size[0], level->halved_row);
+        level->has_pending_row = 0;
+
+        push_row(writer, level_index - 1, level->halved_row);
+    }
+    else
+    {
+        memcpy(level->pending_row, row, row_length);
+        level->has_pending_row = 1;
+    }
+}
+
+static int write_deepzoom_descriptor(const pyramid_t* pyramid)
+{
+    FILE* file = fopen(pyramid->output_path, "wb");
+
+    if (!file)
+    {
+        fprintf(stderr, "Failed to open file: %s\n", pyramid->output_path);
+        return 0;
+    }
+
+    int is_ok = fprintf(file,
+        "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+        "<Image xmlns=\"http://schemas.microsoft.com/deepzoom/2008\" Format=\"png\" Overlap=\"0\" TileSize=\"%d\">\n"
+        "  <Size Width=\"%d\" Height=\"%d\"/>\n"
+        "</Image>\n",
+        PYRAMID_TILE_SIZE, pyramid->viewport.size[0], pyramid->viewport.size[1]) > 0;
+
+    if (fclose(file) || !is_ok)
+    {
+        fprintf(stderr, "Failed to write file: %s\n", pyramid->output_path);
+        return 0;
+    }
+
+    return 1;
+}
+
+int write_pyramid(const pyramid_t* pyramid, const renderer_settings_t* settings)
+{
+    const viewport_t* viewport = &pyramid->viewport;
+    int width = viewport->size[0];
+    int height = viewport->size[1];
+
+    pyramid_writer_t writer = { .pyramid = pyramid, .level_count = get_pyramid_level_count(pyramid), .is_ok = 1 };
+
+    // DeepZoom keeps the tiles next to the descriptor:
+    size_t path_length = strlen(pyramid->output_path);
+
+    writer.tile_directory = allocate(path_length + PYRAMID_PATH_SLACK);
+    writer.path = allocate(path_length + (2 * PYRAMID_PATH_SLACK));
+
+    if (pyramid->format == PYRAMID_FORMAT_DEEPZOOM)
+    {
+        sprintf(writer.tile_directory, "%.*s_files", (int)(path_length - strlen(".dzi")), pyramid->output_path);
+    }
+    else
+    {
+        strcpy(writer.tile_directory, pyramid->output_path);
+        writer.padded_tile = allocate(4 * PYRAMID_TILE_SIZE * PYRAMID_TILE_SIZE);
+    }
+
+    // Level sizes halve (rounding up) from the finest one:
+    writer.levels = allocate(writer.level_count * sizeof(pyramid_level_t));
+
+    for (int level_index = writer.level_count - 1; level_index >= 0; level_index--)
+    {
+        pyramid_level_t* level = &writer.levels[level_index];
+        int is_finest = level_index == (writer.level_count - 1);
+
+        *level = (pyramid_level_t){ .size = { width, height } };
+
+        if (!is_finest)
+        {
+            level->size[0] = (writer.levels[level_index + 1].size[0] + 1) / 2;
+            level->size[1] = (writer.levels[level_index + 1].size[1] + 1) / 2;
+        }
+
+        level->rows = allocate(4 * (size_t)level->size[0] * PYRAMID_TILE_SIZE);
+        level->pending_row = allocate(4 * (size_t)level->size[0]);
+        level->halved_row = allocate(4 * (size_t)((level->size[0] + 1) / 2));
+    }
+
+    writer.is_ok = make_level_directories(&writer);
+
+    // The finest level is rendered a row of tiles at a time:
+    renderer_t renderer;
+    init_renderer(&renderer, settings, width, PYRAMID_TILE_SIZE, PYRAMID_GPU_TILE_WIDTH);
+
+    uint8_t* pixels = allocate(4 * (size_t)width * PYRAMID_TILE_SIZE);
+
+    printf("Rendering a %d level pyramid of %d x %d pixels, %d iterations (%s) ...\n", writer.level_count, width, height, viewport->iterations, renderer.name);
+
+    double start_time = get_time();
+
+    for (int y = 0; writer.is_ok && (y < height); y += PYRAMID_TILE_SIZE)
+    {
+        int row_count = MIN(PYRAMID_TILE_SIZE, height - y);
+        viewport_t band = get_sub_viewport(viewport, 0, y, width, row_count);
+
+        render_viewport(&renderer, &band, pixels);
+
+        for (int row = 0; writer.is_ok && (row < row_count); row++)
+        {
+            push_row(&writer, writer.level_count - 1, pixels + (4 * (size_t)row * width));
+        }
+
+        printf("Rows %d to %d of %d done (%d tiles, %.1f s)\n", y, y + row_count - 1, height, writer.tile_count, get_time() - start_time);
+    }
+
+    // The descriptor goes last, so there's none for an incomplete pyramid:
+    if (writer.is_ok && (pyramid->format == PYRAMID_FORMAT_DEEPZOOM))
+    {
+        writer.is_ok = write_deepzoom_descriptor(pyramid);
+    }
+
+    if (writer.is_ok)
+    {
+        printf("Wrote %d tiles to %s in %.3f s.\n", writer.tile_count, writer.tile_directory, get_time() - start_time);
+    }
+
+    free(pixels);
+    delete_renderer(&renderer);
+
+    for (int level_index = 0; level_index < writer.level_count; level_index++)
+    {
+        free(writer.levels[level_index].rows);
+        free(writer.levels[level_index].pending_row);
+        free(writer.levels[level_index].halved_row);
+    }
+
+    free(writer.levels);
+    free(writer.padded_tile);
+    free(writer.path);
+    free(writer.tile_directory);
+
+    return writer.is_ok;
+}
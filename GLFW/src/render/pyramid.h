@@ -0,0 +1,37 @@
+#ifndef PYRAMID_H
+#define PYRAMID_H
+
+#include "renderer.h"
+#include "viewport.h"
+
+// Tiles are (at most) this many pixels wide and high:
+#define PYRAMID_TILE_SIZE 256
+
+// How the tiles are laid out on disk:
+typedef enum _pyramid_format_t_
+{
+    // <name>.dzi and <name>_files/<level>/<column>_<row>.png, down to a single pixel (e.g. for OpenSeadragon):
+    PYRAMID_FORMAT_DEEPZOOM,
+
+    // <directory>/<z>/<x>/<y>.png, down to a single tile, edge tiles padded with black (e.g. for Leaflet or OpenLayers):
+    PYRAMID_FORMAT_XYZ
+} pyramid_format_t;
+
+// A multi-resolution image of a viewport, which is its finest level:
+typedef struct _pyramid_t_
+{
+    viewport_t viewport;
+    pyramid_format_t format;
+
+    // The .dzi file or the XYZ directory:
+    const char* output_path;
+} pyramid_t;
+
+// The number of levels, from the coarsest (0) to the viewport itself:
+int get_pyramid_level_count(const pyramid_t* pyramid);
+
+// Render the finest level band by band and build every coarser level by halving the one below it (as the bands come in),
+// so only the finest level is iterated and memory stays bounded by a band per level. Returns 0 (after printing why) on failure:
+int write_pyramid(const pyramid_t* pyramid, const renderer_settings_t* settings);
+
+#endif
@@ -0,0 +1,242 @@
+#include "renderer.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cpu_renderer.h"
+#include "gl_renderer.h"
+
+// Doubles resolve pixels down to about this many ULPs of the position (beyond that, neighbouring pixels share their c):
+#define DOUBLE_PRECISION_SAFETY_FACTOR 32.0
+
+// Macros:
+#define MIN(a, b) (((a) < (b)) ? (a) : (b))
+#define MAX(a, b) (((a) > (b)) ? (a) : (b))
+
+static void* allocate_pixels(int pixel_count, size_t pixel_size)
+{
+    void* memory = malloc((size_t)pixel_count * pixel_size);
+
+    if (!memory)
+    {
+        fprintf(stderr, "Failed to allocate memory for %d pixels\n", pixel_count);
+        exit(EXIT_FAILURE);
+    }
+
+    return memory;
+}
+
+static void init_cpu_renderer(renderer_t* renderer)
+{
+    renderer->settings.backend = BACKEND_CPU;
+
+    for (int i = 0; i < PALETTE_COUNT; i++)
+    {
+        load_hue_table(&renderer->hue_tables[i], palette_file_paths[i]);
+    }
+
+    snprintf(renderer->name, sizeof(renderer->name), "%d threads, %s", renderer->settings.thread_count, cpu_renderer_simd_name());
+}
+
+// Returns 0 if we didn't get an offscreen context:
+static int init_gl_renderer_backend(renderer_t* renderer, int max_tile_size)
+{
+    if (!init_offscreen_renderer(&renderer->offscreen_renderer))
+    {
+        return 0;
+    }
+
+    renderer->settings.backend = BACKEND_GL;
+
+    // Otherwise render_frame picks the cheapest tier that resolves the pixels:
+    if (renderer->settings.precision_tier != PRECISION_TIER_COUNT)
+    {
+        // Our offscreen context is OpenGL ES, which has no doubles:
+        if ((renderer->settings.precision_tier == PRECISION_TIER_FP64) && !renderer->offscreen_renderer.user_info.is_fp64_supported)
+        {
+            printf("No native double precision here, using df64 instead ...\n");
+            renderer->settings.precision_tier = PRECISION_TIER_DF64;
+        }
+
+        renderer->offscreen_renderer.user_info.precision_tier = renderer->settings.precision_tier;
+        renderer->offscreen_renderer.user_info.is_precision_tier_forced = 1;
+    }
+
+    int tile_size = MIN(max_tile_size, renderer->offscreen_renderer.max_size);
+
+    for (int axis = 0; axis < 2; axis++)
+    {
+        renderer->tile_size[axis] = MIN(renderer->max_size[axis], tile_size);
+    }
+
+    if ((renderer->tile_size[0] < renderer->max_size[0]) || (renderer->tile_size[1] < renderer->max_size[1]))
+    {
+        renderer->tile_pixels = allocate_pixels(renderer->tile_size[0] * renderer->tile_size[1], 4);
+    }
+
+    snprintf(renderer->name, sizeof(renderer->name), "OpenGL ES 3");
+
+    return 1;
+}
+
+void init_renderer(renderer_t* renderer, const renderer_settings_t* settings, int max_width, int max_height, int max_tile_size)
+{
+    *renderer = (renderer_t){ .settings = *settings, .max_size = { max_width, max_height } };
+
+    if ((settings->backend == BACKEND_GL) && !init_gl_renderer_backend(renderer, max_tile_size))
+    {
+        printf("No offscreen OpenGL ES 3 context, rendering on the CPU.\n");
+    }
+
+    if (renderer->settings.backend == BACKEND_CPU)
+    {
+        init_cpu_renderer(renderer);
+    }
+}
+
+static void render_escape_gl(renderer_t* renderer, const viewport_t* viewport, uint32_t* iteration_state)
+{
+    int width = viewport->size[0];
+
+    for (int tile_y = 0; tile_y < viewport->size[1]; tile_y += renderer->tile_size[1])
+    {
+        for (int tile_x = 0; tile_x < width; tile_x += renderer->tile_size[0])
+        {
+            int tile_width = MIN(renderer->tile_size[0], width - tile_x);
+            int tile_height = MIN(renderer->tile_size[1], viewport->size[1] - tile_y);
+            viewport_t tile = get_sub_viewport(viewport, tile_x, tile_y, tile_width, tile_height);
+
+            int is_whole = (tile_width == width) && (tile_height == viewport->size[1]);
+
+            if (!is_whole && !renderer->tile_iteration_state)
+            {
+                renderer->tile_iteration_state = allocate_pixels(renderer->tile_size[0] * renderer->tile_size[1], sizeof(uint32_t));
+            }
+
+            uint32_t* tile_iteration_state = is_whole ? iteration_state : renderer->tile_iteration_state;
+
+            render_offscreen_escape(&renderer->offscreen_renderer, &tile, tile_iteration_state);
+
+            if (!is_whole)
+            {
+                for (int row = 0; row < tile_height; row++)
+                {
+                    memcpy(iteration_state + (((size_t)(tile_y + row) * width) + tile_x), tile_iteration_state + ((size_t)row * tile_width), sizeof(uint32_t) * tile_width);
+                }
+            }
+        }
+    }
+}
+
+void render_escape(renderer_t* renderer, const viewport_t* viewport, uint32_t* iteration_state)
+{
+    if (renderer->settings.backend == BACKEND_GL)
+    {
+        render_escape_gl(renderer, viewport, iteration_state);
+        return;
+    }
+
+    // The CPU renderer iterates in doubles, so there's a limit to how deep we can go:
+    double magnitude = MAX(1.0, MAX(fabs(dd_to_double(viewport->position[0])), fabs(dd_to_double(viewport->position[1]))));
+
+    if (!renderer->is_precision_warned && ((1.0 / viewport->scale) < (DOUBLE_PRECISION_SAFETY_FACTOR * DBL_EPSILON * magnitude)))
+    {
+        fprintf(stderr, "Warning: the scale exceeds double precision, expect blocky results.\n");
+        renderer->is_precision_warned = 1;
+    }
+
+    cpu_render_escape(viewport, iteration_state, renderer->settings.thread_count);
+}
+
+void colorize_iteration_state(const renderer_t* renderer, const uint32_t* iteration_state, const viewport_t* viewport, int palette, double hue_density, double hue_offset, uint8_t* pixels)
+{
+    cpu_colorize(iteration_state, viewport->size[0] * viewport->size[1], viewport->iterations, &renderer->hue_tables[palette], hue_density, hue_offset, pixels);
+}
+
+static void render_viewport_cpu(renderer_t* renderer, const viewport_t* viewport, uint8_t* pixels)
+{
+    const renderer_settings_t* settings = &renderer->settings;
+
+    if (!renderer->iteration_state)
+    {
+        renderer->iteration_state = allocate_pixels(renderer->max_size[0] * renderer->max_size[1], sizeof(uint32_t));
+    }
+
+    render_escape(renderer, viewport, renderer->iteration_state);
+    colorize_iteration_state(renderer, renderer->iteration_state, viewport, settings->palette, settings->hue_density, settings->hue_offset, pixels);
+}
+
+static void render_viewport_gl(renderer_t* renderer, const viewport_t* viewport, uint8_t* pixels)
+{
+    const renderer_settings_t* settings = &renderer->settings;
+    int width = viewport->size[0];
+
+    for (int tile_y = 0; tile_y < viewport->size[1]; tile_y += renderer->tile_size[1])
+    {
+        for (int tile_x = 0; tile_x < width; tile_x += renderer->tile_size[0])
+        {
+            int tile_width = MIN(renderer->tile_size[0], width - tile_x);
+            int tile_height = MIN(renderer->tile_size[1], viewport->size[1] - tile_y);
+            viewport_t tile = get_sub_viewport(viewport, tile_x, tile_y, tile_width, tile_height);
+
+            // A tile spanning the whole viewport goes straight to the pixels:
+            int is_whole = (tile_width == width) && (tile_height == viewport->size[1]);
+            uint8_t* tile_pixels = is_whole ? pixels : renderer->tile_pixels;
+
+            render_offscreen(&renderer->offscreen_renderer, &tile, settings->palette, settings->hue_density, settings->hue_offset, tile_pixels);
+
+            if (settings->is_validating)
+            {
+                validate_frame(&renderer->offscreen_renderer.user_info);
+            }
+
+            if (!is_whole)
+            {
+                for (int row = 0; row < tile_height; row++)
+                {
+                    memcpy(pixels + (4 * (((size_t)(tile_y + row) * width) + tile_x)), tile_pixels + (4 * (size_t)row * tile_width), 4 * (size_t)tile_width);
+                }
+            }
+        }
+    }
+}
+
+void render_viewport(renderer_t* renderer, const viewport_t* viewport, uint8_t* pixels)
+{
+    if ((viewport->size[0] > renderer->max_size[0]) || (viewport->size[1] > renderer->max_size[1]))
+    {
+        fprintf(stderr, "The viewport is larger than the renderer was set up for: %d x %d\n", viewport->size[0], viewport->size[1]);
+        exit(EXIT_FAILURE);
+    }
+
+    if (renderer->settings.backend == BACKEND_CPU)
+    {
+        render_viewport_cpu(renderer, viewport, pixels);
+    }
+    else
+    {
+        render_viewport_gl(renderer, viewport, pixels);
+    }
+}
+
+void delete_renderer(renderer_t* renderer)
+{
+    if (renderer->settings.backend == BACKEND_CPU)
+    {
+        free(renderer->iteration_state);
+
+        for (int i = 0; i < PALETTE_COUNT; i++)
+        {
+            free_hue_table(&renderer->hue_tables[i]);
+        }
+    }
+    else
+    {
+        free(renderer->tile_pixels);
+        free(renderer->tile_iteration_state);
+        delete_offscreen_renderer(&renderer->offscreen_renderer);
+    }
+}
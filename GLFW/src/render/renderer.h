@@ -0,0 +1,81 @@
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include <stdint.h>
+
+#include "hue_table.h"
+#include "offscreen_renderer.h"
+#include "user_info.h"
+#include "viewport.h"
+
+// Where we render:
+typedef enum _backend_t_
+{
+    BACKEND_CPU,
+
+    // The viewer's shaders on an offscreen OpenGL ES 3 context:
+    BACKEND_GL
+} backend_t;
+
+// How we render (everything but the view). The coloring may change between renders:
+typedef struct _renderer_settings_t_
+{
+    backend_t backend;
+
+    // PRECISION_TIER_COUNT picks the cheapest accurate tier (GL only):
+    precision_tier_t precision_tier;
+
+    // Compare the GL images with the CPU renderer?
+    int is_validating;
+
+    int palette;
+    double hue_density;
+    double hue_offset;
+
+    // CPU only:
+    int thread_count;
+} renderer_settings_t;
+
+// Renders viewports into RGBA8 pixels (rows from top to bottom) on the CPU or the GPU.
+// On the GPU, we go tile by tile (tiles are bounded by the GPU limits), so any viewport size works:
+typedef struct _renderer_t_
+{
+    // The settings (the backend is the one we actually got):
+    renderer_settings_t settings;
+
+    // The largest viewport we render (the buffers are sized for it):
+    int max_size[2];
+
+    // A short description like "8 threads, avx512":
+    char name[64];
+
+    // CPU only (the iteration state is allocated on the first render_viewport):
+    hue_table_t hue_tables[PALETTE_COUNT];
+    uint32_t* iteration_state;
+
+    // Have we warned that the views go beyond double precision?
+    int is_precision_warned;
+
+    // GL only (tile_pixels is NULL if a tile always covers the whole viewport, tile_iteration_state is allocated when render_escape needs it):
+    offscreen_renderer_t offscreen_renderer;
+    int tile_size[2];
+    uint8_t* tile_pixels;
+    uint32_t* tile_iteration_state;
+} renderer_t;
+
+// Set up the renderer for viewports of up to max_width x max_height pixels, GPU tiles are at most max_tile_size wide and high.
+// Like the viewer, we fall back to the CPU (with a message) if there's no OpenGL ES 3:
+void init_renderer(renderer_t* renderer, const renderer_settings_t* settings, int max_width, int max_height, int max_tile_size);
+
+void render_viewport(renderer_t* renderer, const viewport_t* viewport, uint8_t* pixels);
+
+// Only the iteration state of a viewport (CPU or GPU), e.g. for caching it:
+void render_escape(renderer_t* renderer, const viewport_t* viewport, uint32_t* iteration_state);
+
+// CPU only: with render_escape, the two passes of render_viewport on their own, so they can overlap in different threads
+// (colorize_iteration_state only reads the hue tables, so it may run alongside the next escape pass):
+void colorize_iteration_state(const renderer_t* renderer, const uint32_t* iteration_state, const viewport_t* viewport, int palette, double hue_density, double hue_offset, uint8_t* pixels);
+
+void delete_renderer(renderer_t* renderer);
+
+#endif
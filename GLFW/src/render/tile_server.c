@@ -0,0 +1,866 @@
+#include "tile_server.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "cpu_renderer.h"
+#include "image_io.h"
+#include "tile_cache.h"
+#include "tile_store.h"
+#include "user_info.h"
+
+// Zoom 0 is the level where a tile spans 4 units (64 pixels per unit):
+#define ZOOM_0_LEVEL (6 * TILE_LEVELS_PER_OCTAVE)
+
+// The deepest zoom (doubles hold the pixel positions exactly well beyond that):
+#define MAX_ZOOM 40
+
+// The memory for tiles (the colors are cheap to compute, so we only cache the iteration state):
+#define TILE_SERVER_CACHE_MEMORY ((size_t)512 << 20)
+
+// The size of a new tile store (it is sparse, so this is an upper bound):
+#define TILE_STORE_SIZE ((size_t)4 << 30)
+
+// Connections waiting for a worker (beyond that, they wait in the listen backlog):
+#define CONNECTION_QUEUE_LENGTH 64
+#define LISTEN_BACKLOG 128
+
+// Requests are small, and a client that takes too long to send one (or to take the response) loses its connection:
+#define MAX_REQUEST_LENGTH 8192
+#define REQUEST_TIMEOUT 10
+
+#define TILE_PIXEL_COUNT (TILE_CACHE_TILE_SIZE * TILE_CACHE_TILE_SIZE)
+
+// Macros:
+#define MAX(a, b) (((a) > (b)) ? (a) : (b))
+
+// A tile that is being rendered (the requests for it wait until it is done):
+typedef struct _pending_tile_t_
+{
+    tile_key_t key;
+    uint32_t* iteration_state;
+
+    int is_done;
+
+    // The requests holding on to it (the last one frees it):
+    int waiter_count;
+
+    // The list of pending tiles and the render queue:
+    struct _pending_tile_t_* next_pending;
+    struct _pending_tile_t_* next_to_render;
+} pending_tile_t;
+
+// What a request asks for:
+typedef struct _tile_request_t_
+{
+    tile_key_t key;
+
+    int palette;
+    double hue_density;
+    double hue_offset;
+
+    int is_raw;
+} tile_request_t;
+
+typedef struct _tile_server_t_
+{
+    const tile_server_settings_t* server_settings;
+    const renderer_settings_t* settings;
+
+    // The renderers color on the CPU, whatever the backend:
+    hue_table_t hue_tables[PALETTE_COUNT];
+
+    int listen_socket;
+
+    // Accepted connections waiting for a worker (closed once we stop accepting):
+    int connections[CONNECTION_QUEUE_LENGTH];
+    int first_connection;
+    int connection_count;
+    int is_accepting;
+
+    pthread_mutex_t connection_mutex;
+    pthread_cond_t has_connections;
+    pthread_cond_t has_connection_room;
+
+    // The tiles we have, the ones being rendered and the render queue (all under tile_mutex):
+    tile_cache_t tile_cache;
+    tile_store_t tile_store;
+
+    pending_tile_t* pending_tiles;
+    pending_tile_t* first_to_render;
+    pending_tile_t* last_to_render;
+    int is_rendering;
+
+    pthread_mutex_t tile_mutex;
+    pthread_cond_t has_tiles_to_render;
+    pthread_cond_t is_tile_done;
+
+    // Statistics (under tile_mutex):
+    long request_count;
+    long rendered_count;
+    long coalesced_count;
+} tile_server_t;
+
+// Set by the signal handler:
+static volatile sig_atomic_t is_stop_requested = 0;
+
+static void handle_stop_signal(int signal_number)
+{
+    is_stop_requested = 1;
+}
+
+static void* allocate_tile(size_t pixel_size)
+{
+    void* memory = malloc(TILE_PIXEL_COUNT * pixel_size);
+
+    if (!memory)
+    {
+        fprintf(stderr, "Failed to allocate memory for a tile\n");
+        exit(EXIT_FAILURE);
+    }
+
+    return memory;
+}
+
+// The viewport of a tile on the grid:
+static viewport_t get_tile_viewport(const tile_key_t* key)
+{
+    tile_frame_t frame = { key->level, key->iterations, { key->x * TILE_CACHE_TILE_SIZE, key->y * TILE_CACHE_TILE_SIZE }, { TILE_CACHE_TILE_SIZE, TILE_CACHE_TILE_SIZE } };
+
+    return get_tile_frame_viewport(&frame);
+}
+
+static void* run_render_thread(void* argument)
+{
+    tile_server_t* server = argument;
+    renderer_settings_t settings = *server->settings;
+
+    // On the CPU, every render thread renders its own tiles:
+    if (settings.backend == BACKEND_CPU)
+    {
+        settings.thread_count = 1;
+    }
+
+    // The GL context belongs to this thread:
+    renderer_t renderer;
+    init_renderer(&renderer, &settings, TILE_CACHE_TILE_SIZE, TILE_CACHE_TILE_SIZE, TILE_CACHE_TILE_SIZE);
+
+    pthread_mutex_lock(&server->tile_mutex);
+
+    while (1)
+    {
+        while (!server->first_to_render && server->is_rendering)
+        {
+            pthread_cond_wait(&server->has_tiles_to_render, &server->tile_mutex);
+        }
+
+        pending_tile_t* tile = server->first_to_render;
+
+        if (!tile)
+        {
+            break;
+        }
+
+        server->first_to_render = tile->next_to_render;
+
+        if (!server->first_to_render)
+        {
+            server->last_to_render = NULL;
+        }
+
+        pthread_mutex_unlock(&server->tile_mutex);
+
+        viewport_t viewport = get_tile_viewport(&tile->key);
+        render_escape(&renderer, &viewport, tile->iteration_state);
+
+        pthread_mutex_lock(&server->tile_mutex);
+
+        memcpy(add_cached_tile(&server->tile_cache, &tile->key), tile->iteration_state, TILE_PIXEL_COUNT * sizeof(uint32_t));
+
+        if (server->tile_cache.store)
+        {
+            store_tile(server->tile_cache.store, &tile->key, tile->iteration_state);
+        }
+
+        // From now on, requests find it in the cache:
+        pending_tile_t** link = &server->pending_tiles;
+
+        while (*link != tile)
+        {
+            link = &(*link)->next_pending;
+        }
+
+        *link = tile->next_pending;
+
+        tile->is_done = 1;
+        server->rendered_count++;
+
+        pthread_cond_broadcast(&server->is_tile_done);
+    }
+
+    pthread_mutex_unlock(&server->tile_mutex);
+
+    delete_renderer(&renderer);
+
+    return NULL;
+}
+
+// Get the iteration state of a tile from the cache, the store or (after waiting for it) a render thread:
+static void get_tile(tile_server_t* server, const tile_key_t* key, uint32_t* iteration_state)
+{
+    pthread_mutex_lock(&server->tile_mutex);
+
+    server->request_count++;
+
+    const uint32_t* cached_state = find_cached_tile(&server->tile_cache, key);
+
+    if (!cached_state && server->tile_cache.store)
+    {
+        cached_state = find_stored_tile(server->tile_cache.store, key);
+    }
+
+    if (cached_state)
+    {
+        memcpy(iteration_state, cached_state, TILE_PIXEL_COUNT * sizeof(uint32_t));
+        pthread_mutex_unlock(&server->tile_mutex);
+
+        return;
+    }
+
+    // Is somebody rendering it already?
+    pending_tile_t* tile = server->pending_tiles;
+
+    while (tile && !is_same_tile_key(&tile->key, key))
+    {
+        tile = tile->next_pending;
+    }
+
+    if (tile)
+    {
+        server->coalesced_count++;
+    }
+    else
+    {
+        tile = calloc(1, sizeof(pending_tile_t));
+
+        if (!tile)
+        {
+            fprintf(stderr, "Failed to allocate memory for a tile\n");
+            exit(EXIT_FAILURE);
+        }
+
+        tile->key = *key;
+        tile->iteration_state = allocate_tile(sizeof(uint32_t));
+
+        tile->next_pending = server->pending_tiles;
+        server->pending_tiles = tile;
+
+        if (server->last_to_render)
+        {
+            server->last_to_render->next_to_render = tile;
+        }
+        else
+        {
+            server->first_to_render = tile;
+        }
+
+        server->last_to_render = tile;
+
+        pthread_cond_signal(&server->has_tiles_to_render);
+    }
+
+    tile->waiter_count++;
+
+    while (!tile->is_done)
+    {
+        pthread_cond_wait(&server->is_tile_done, &server->tile_mutex);
+    }
+
+    memcpy(iteration_state, tile->iteration_state, TILE_PIXEL_COUNT * sizeof(uint32_t));
+
+    if (--tile->waiter_count == 0)
+    {
+        free(tile->iteration_state);
+        free(tile);
+    }
+
+    pthread_mutex_unlock(&server->tile_mutex);
+}
+
+static int send_all(int connection, const void* data, size_t length)
+{
+    const uint8_t* next = data;
+
+    while (length > 0)
+    {
+        ssize_t sent = send(connection, next, length, MSG_NOSIGNAL);
+
+        if (sent < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            return 0;
+        }
+
+        next += sent;
+        length -= (size_t)sent;
+    }
+
+    return 1;
+}
+
+static void send_response(int connection, const char* status, const char* content_type, const void* body, size_t length)
+{
+    char header[512];
+
+    // Tiles never change, so clients may keep them:
+    int header_length = snprintf(header, sizeof(header),
+        "HTTP/1.1 %s\r\n"
+        "Content-Type: %s\r\n"
+        "Content-Length: %zu\r\n"
+        "%s"
+        "Access-Control-Allow-Origin: *\r\n"
+        "Connection: close\r\n"
+        "\r\n",
+        status, content_type, length, strncmp(status, "200", 3) ? "" : "Cache-Control: public, max-age=31536000, immutable\r\n");
+
+    if (send_all(connection, header, header_length))
+    {
+        send_all(connection, body, length);
+    }
+}
+
+static void send_error(int connection, const char* status, const char* message)
+{
+    char body[256];
+    int length = snprintf(body, sizeof(body), "%s\n", message);
+
+    send_response(connection, status, "text/plain", body, length);
+}
+
+// Parse a decimal integer that has to span the whole text:
+static int parse_integer(const char* text, long long min, long long max, long long* value)
+{
+    char* end;
+
+    errno = 0;
+    *value = strtoll(text, &end, 10);
+
+    return (end != text) && !*end && !errno && (*value >= min) && (*value <= max);
+}
+
+static int parse_real(const char* text, double min, double max, double* value)
+{
+    char* end;
+    *value = strtod(text, &end);
+
+    return (end != text) && !*end && (*value >= min) && (*value <= max);
+}
+
+// Parse the request target (modified in place). Returns the HTTP status on failure (with a message) or NULL:
+static const char* parse_tile_request(const tile_server_t* server, char* target, tile_request_t* request, const char** message)
+{
+    const renderer_settings_t* settings = server->settings;
+
+    *request = (tile_request_t)
+    {
+        .key = { .iterations = server->server_settings->iterations },
+        .palette = settings->palette,
+        .hue_density = settings->hue_density,
+        .hue_offset = settings->hue_offset,
+        .is_raw = 0
+    };
+
+    char* query = strchr(target, '?');
+
+    if (query)
+    {
+        *query++ = 0;
+    }
+
+    // The path is /<z>/<x>/<y>:
+    if (target[0] != '/')
+    {
+        *message = "Tiles are at /<z>/<x>/<y> (zoom 0 to 40)";
+        return "404 Not Found";
+    }
+
+    char* segments[4];
+    int segment_count = 0;
+    char* context;
+
+    for (char* segment = strtok_r(target, "/", &context); segment; segment = strtok_r(NULL, "/", &context))
+    {
+        if (segment_count == 3)
+        {
+            segment_count++;
+            break;
+        }
+
+        segments[segment_count++] = segment;
+    }
+
+    long long zoom, x, y;
+
+    if ((segment_count != 3) || !parse_integer(segments[0], 0, MAX_ZOOM, &zoom))
+    {
+        *message = "Tiles are at /<z>/<x>/<y> (zoom 0 to 40)";
+        return "404 Not Found";
+    }
+
+    // The tiles within [-4, 4) x [-4, 4):
+    long long tile_limit = 1LL << zoom;
+
+    if (!parse_integer(segments[1], -tile_limit, tile_limit - 1, &x) || !parse_integer(segments[2], -tile_limit, tile_limit - 1, &y))
+    {
+        *message = "There is no such tile (at zoom z, x and y go from -2^z to 2^z - 1)";
+        return "404 Not Found";
+    }
+
+    request->key.level = ZOOM_0_LEVEL + ((int)zoom * TILE_LEVELS_PER_OCTAVE);
+    request->key.x = x;
+    request->key.y = y;
+
+    for (char* parameter = query ? strtok_r(query, "&", &context) : NULL; parameter; parameter = strtok_r(NULL, "&", &context))
+    {
+        char* value = strchr(parameter, '=');
+
+        if (!value)
+        {
+            continue;
+        }
+
+        *value++ = 0;
+
+        long long iterations;
+        int is_valid = 1;
+
+        // Other parameters (e.g. cache busters) don't matter to us:
+        if (!strcmp(parameter, "iter"))
+        {
+            is_valid = parse_integer(value, MIN_ITERATIONS, MAX_ITERATIONS, &iterations);
+            request->key.iterations = (int)iterations;
+        }
+        else if (!strcmp(parameter, "palette"))
+        {
+            request->palette = find_palette(value);
+            is_valid = request->palette >= 0;
+        }
+        else if (!strcmp(parameter, "density"))
+        {
+            is_valid = parse_real(value, MIN_HUE_DENSITY, MAX_HUE_DENSITY, &request->hue_density);
+        }
+        else if (!strcmp(parameter, "offset"))
+        {
+            is_valid = parse_real(value, 0.0, 1.0, &request->hue_offset);
+        }
+        else if (!strcmp(parameter, "format"))
+        {
+            is_valid = !strcmp(value, "png") || !strcmp(value, "raw");
+            request->is_raw = !strcmp(value, "raw");
+        }
+
+        if (!is_valid)
+        {
+            *message = "Invalid parameter (iter, palette, density, offset or format)";
+            return "400 Bad Request";
+        }
+    }
+
+    return NULL;
+}
+
+// Encode the tile as PNG (the result has to be freed):
+static int encode_png(const uint8_t* pixels, char** data, size_t* length)
+{
+    FILE* file = open_memstream(data, length);
+
+    if (!file)
+    {
+        return 0;
+    }
+
+    image_writer_t writer;
+
+    if (open_image_stream_writer(&writer, file, "tile", 1, TILE_CACHE_TILE_SIZE, TILE_CACHE_TILE_SIZE))
+    {
+        write_image_rows(&writer, pixels, TILE_CACHE_TILE_SIZE);
+    }
+
+    // Closing the stream gives us the data (if there is any, it has to be freed either way):
+    int is_ok = close_image_writer(&writer);
+
+    if (!is_ok)
+    {
+        free(*data);
+    }
+
+    return is_ok;
+}
+
+static void handle_connection(tile_server_t* server, int connection, uint32_t* iteration_state, uint8_t* pixels)
+{
+    struct timeval timeout = { REQUEST_TIMEOUT, 0 };
+
+    setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(connection, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    // Read up to the end of the header (we don't take bodies):
+    char request_text[MAX_REQUEST_LENGTH + 1];
+    size_t length = 0;
+
+    while (1)
+    {
+        ssize_t received = recv(connection, request_text + length, MAX_REQUEST_LENGTH - length, 0);
+
+        if ((received < 0) && (errno == EINTR))
+        {
+            continue;
+        }
+
+        if (received <= 0)
+        {
+            return;
+        }
+
+        length += (size_t)received;
+        request_text[length] = 0;
+
+        if (strstr(request_text, "\r\n\r\n") || strstr(request_text, "\n\n"))
+        {
+            break;
+        }
+
+        if (length == MAX_REQUEST_LENGTH)
+        {
+            send_error(connection, "431 Request Header Fields Too Large", "The request is too large");
+            return;
+        }
+    }
+
+    // The request line is "<method> <target> <version>":
+    char* context;
+    char* method = strtok_r(request_text, " ", &context);
+    char* target = strtok_r(NULL, " \r\n", &context);
+
+    if (!method || !target)
+    {
+        send_error(connection, "400 Bad Request", "Invalid request");
+        return;
+    }
+
+    if (strcmp(method, "GET"))
+    {
+        send_error(connection, "405 Method Not Allowed", "Only GET is supported");
+        return;
+    }
+
+    tile_request_t request;
+    const char* message;
+    const char* status = parse_tile_request(server, target, &request, &message);
+
+    if (status)
+    {
+        send_error(connection, status, message);
+        return;
+    }
+
+    get_tile(server, &request.key, iteration_state);
+
+    if (request.is_raw)
+    {
+        send_response(connection, "200 OK", "application/octet-stream", iteration_state, TILE_PIXEL_COUNT * sizeof(uint32_t));
+        return;
+    }
+
+    cpu_colorize(iteration_state, TILE_PIXEL_COUNT, request.key.iterations, &server->hue_tables[request.palette], request.hue_density, request.hue_offset, pixels);
+
+    char* png;
+    size_t png_length;
+
+    if (!encode_png(pixels, &png, &png_length))
+    {
+        send_error(connection, "500 Internal Server Error", "Failed to encode the tile");
+        return;
+    }
+
+    send_response(connection, "200 OK", "image/png", png, png_length);
+    free(png);
+}
+
+// Returns -1 once we have stopped accepting and all connections are taken:
+static int pop_connection(tile_server_t* server)
+{
+    pthread_mutex_lock(&server->connection_mutex);
+
+    while (!server->connection_count && server->is_accepting)
+    {
+        pthread_cond_wait(&server->has_connections, &server->connection_mutex);
+    }
+
+    int connection = -1;
+
+    if (server->connection_count)
+    {
+        connection = server->connections[server->first_connection];
+        server->first_connection = (server->first_connection + 1) % CONNECTION_QUEUE_LENGTH;
+        server->connection_count--;
+
+        pthread_cond_signal(&server->has_connection_room);
+    }
+
+    pthread_mutex_unlock(&server->connection_mutex);
+
+    return connection;
+}
+
+static void push_connection(tile_server_t* server, int connection)
+{
+    pthread_mutex_lock(&server->connection_mutex);
+
+    while (server->connection_count == CONNECTION_QUEUE_LENGTH)
+    {
+        pthread_cond_wait(&server->has_connection_room, &server->connection_mutex);
+    }
+
+    server->connections[(server->first_connection + server->connection_count) % CONNECTION_QUEUE_LENGTH] = connection;
+    server->connection_count++;
+
+    pthread_cond_signal(&server->has_connections);
+    pthread_mutex_unlock(&server->connection_mutex);
+}
+
+static void* run_worker(void* argument)
+{
+    tile_server_t* server = argument;
+
+    uint32_t* iteration_state = allocate_tile(sizeof(uint32_t));
+    uint8_t* pixels = allocate_tile(4);
+    int connection;
+
+    while ((connection = pop_connection(server)) >= 0)
+    {
+        handle_connection(server, connection, iteration_state, pixels);
+        close(connection);
+    }
+
+    free(pixels);
+    free(iteration_state);
+
+    return NULL;
+}
+
+// Returns the listening socket (-1 after printing why if we can't):
+static int open_listen_socket(const tile_server_settings_t* server_settings, int* port)
+{
+    struct sockaddr_in address = { .sin_family = AF_INET, .sin_port = htons(server_settings->port) };
+
+    if (inet_pton(AF_INET, server_settings->address, &address.sin_addr) != 1)
+    {
+        fprintf(stderr, "Invalid IPv4 address: %s\n", server_settings->address);
+        return -1;
+    }
+
+    int listen_socket = socket(AF_INET, SOCK_STREAM, 0);
+    int is_reusing = 1;
+
+    if ((listen_socket < 0) ||
+        setsockopt(listen_socket, SOL_SOCKET, SO_REUSEADDR, &is_reusing, sizeof(is_reusing)) ||
+        bind(listen_socket, (struct sockaddr*)&address, sizeof(address)) ||
+        listen(listen_socket, LISTEN_BACKLOG))
+    {
+        fprintf(stderr, "Failed to listen on %s:%d (%s)\n", server_settings->address, server_settings->port, strerror(errno));
+
+        if (listen_socket >= 0)
+        {
+            close(listen_socket);
+        }
+
+        return -1;
+    }
+
+    // The port we actually got (if we asked for any):
+    socklen_t address_length = sizeof(address);
+    getsockname(listen_socket, (struct sockaddr*)&address, &address_length);
+    *port = ntohs(address.sin_port);
+
+    return listen_socket;
+}
+
+int run_tile_server(const tile_server_settings_t* server_settings, const renderer_settings_t* settings)
+{
+    tile_server_t server = { .server_settings = server_settings, .settings = settings, .is_accepting = 1, .is_rendering = 1 };
+    int port;
+
+    server.listen_socket = open_listen_socket(server_settings, &port);
+
+    if (server.listen_socket < 0)
+    {
+        return 0;
+    }
+
+    init_tile_cache(&server.tile_cache, TILE_SERVER_CACHE_MEMORY);
+
+    if (server_settings->tile_store_path)
+    {
+        if (!open_tile_store(&server.tile_store, server_settings->tile_store_path, TILE_STORE_SIZE))
+        {
+            delete_tile_cache(&server.tile_cache);
+            close(server.listen_socket);
+            return 0;
+        }
+
+        server.tile_cache.store = &server.tile_store;
+    }
+
+    for (int i = 0; i < PALETTE_COUNT; i++)
+    {
+        load_hue_table(&server.hue_tables[i], palette_file_paths[i]);
+    }
+
+    pthread_mutex_init(&server.connection_mutex, NULL);
+    pthread_cond_init(&server.has_connections, NULL);
+    pthread_cond_init(&server.has_connection_room, NULL);
+    pthread_mutex_init(&server.tile_mutex, NULL);
+    pthread_cond_init(&server.has_tiles_to_render, NULL);
+    pthread_cond_init(&server.is_tile_done, NULL);
+
+    // Only this thread handles the stop signals (and only while it waits for connections, so none slips through):
+    sigset_t stop_signals, previous_signals;
+
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    sigaddset(&stop_signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stop_signals, &previous_signals);
+
+    struct sigaction action = { .sa_handler = handle_stop_signal };
+    struct sigaction previous_actions[2];
+
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, &previous_actions[0]);
+    sigaction(SIGTERM, &action, &previous_actions[1]);
+
+    // The GPU has one context, the CPU one render thread per core. Workers mostly wait (for clients or tiles), so there are more of them:
+    int render_thread_count = (settings->backend == BACKEND_GL) ? 1 : settings->thread_count;
+    int worker_count = MAX(4, 2 * settings->thread_count);
+
+    pthread_t* render_threads = malloc(render_thread_count * sizeof(pthread_t));
+    pthread_t* workers = malloc(worker_count * sizeof(pthread_t));
+
+    if (!render_threads || !workers)
+    {
+        fprintf(stderr, "Failed to allocate memory for %d threads\n", render_thread_count + worker_count);
+        exit(EXIT_FAILURE);
+    }
+
+    for (int i = 0; i < render_thread_count; i++)
+    {
+        pthread_create(&render_threads[i], NULL, run_render_thread, &server);
+    }
+
+    for (int i = 0; i < worker_count; i++)
+    {
+        pthread_create(&workers[i], NULL, run_worker, &server);
+    }
+
+    printf("Serving tiles on http://%s:%d/<z>/<x>/<y>?iter=%d&palette=%s (%d workers, %d render threads)\n",
+        server_settings->address, port, server_settings->iterations, palette_names[settings->palette], worker_count, render_thread_count);
+    printf("Press Ctrl+C to stop.\n");
+    fflush(stdout);
+
+    sigset_t wait_signals = previous_signals;
+
+    sigdelset(&wait_signals, SIGINT);
+    sigdelset(&wait_signals, SIGTERM);
+
+    while (!is_stop_requested)
+    {
+        fd_set sockets;
+
+        FD_ZERO(&sockets);
+        FD_SET(server.listen_socket, &sockets);
+
+        // The stop signals only get through while we wait here:
+        if (pselect(server.listen_socket + 1, &sockets, NULL, NULL, NULL, &wait_signals) <= 0)
+        {
+            continue;
+        }
+
+        int connection = accept(server.listen_socket, NULL, NULL);
+
+        if (connection >= 0)
+        {
+            push_connection(&server, connection);
+        }
+    }
+
+    printf("Stopping ...\n");
+
+    close(server.listen_socket);
+
+    // The workers finish the connections we have accepted, then the render threads the tiles they wait for:
+    pthread_mutex_lock(&server.connection_mutex);
+    server.is_accepting = 0;
+    pthread_cond_broadcast(&server.has_connections);
+    pthread_mutex_unlock(&server.connection_mutex);
+
+    for (int i = 0; i < worker_count; i++)
+    {
+        pthread_join(workers[i], NULL);
+    }
+
+    pthread_mutex_lock(&server.tile_mutex);
+    server.is_rendering = 0;
+    pthread_cond_broadcast(&server.has_tiles_to_render);
+    pthread_mutex_unlock(&server.tile_mutex);
+
+    for (int i = 0; i < render_thread_count; i++)
+    {
+        pthread_join(render_threads[i], NULL);
+    }
+
+    printf("Served %ld tiles: %ld rendered, %ld shared with concurrent requests, the others cached.\n",
+        server.request_count, server.rendered_count, server.coalesced_count);
+
+    sigaction(SIGINT, &previous_actions[0], NULL);
+    sigaction(SIGTERM, &previous_actions[1], NULL);
+    pthread_sigmask(SIG_SETMASK, &previous_signals, NULL);
+
+    free(workers);
+    free(render_threads);
+
+    pthread_cond_destroy(&server.is_tile_done);
+    pthread_cond_destroy(&server.has_tiles_to_render);
+    pthread_mutex_destroy(&server.tile_mutex);
+    pthread_cond_destroy(&server.has_connection_room);
+    pthread_cond_destroy(&server.has_connections);
+    pthread_mutex_destroy(&server.connection_mutex);
+
+    for (int i = 0; i < PALETTE_COUNT; i++)
+    {
+        free_hue_table(&server.hue_tables[i]);
+    }
+
+    if (server.tile_cache.store)
+    {
+        close_tile_store(server.tile_cache.store);
+    }
+
+    delete_tile_cache(&server.tile_cache);
+
+    return 1;
+}
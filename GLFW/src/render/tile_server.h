@@ -0,0 +1,34 @@
+#ifndef TILE_SERVER_H
+#define TILE_SERVER_H
+
+#include "renderer.h"
+
+// Serves tiles over HTTP (one request per connection):
+//
+//   GET /<z>/<x>/<y>?iter=<count>&palette=<name>&density=<value>&offset=<value>&format=<png|raw>
+//
+// Tiles are TILE_CACHE_TILE_SIZE pixels wide and high. At zoom 0 a tile spans 4 units, and every zoom level halves that.
+// Tile (0, 0) has its top left corner at the origin, x grows to the right and y downwards (so the set covers the tiles -1 and 0 at zoom 0).
+// "raw" is the iteration state as it is cached (native byte order, see viewport.h), everything but iter is optional.
+//
+// Tiles are cached in memory (and in a tile store, if there is one) and colored per request. Requests for a tile that is being
+// rendered wait for it instead of rendering it again. Connections are served by a pool of workers, the rendering is done by
+// render threads (one per core on the CPU, one for the GPU), so throughput scales with the cores, not with the connections.
+typedef struct _tile_server_settings_t_
+{
+    // The IPv4 address to listen on (e.g. 127.0.0.1 for this machine only) and the port (0 picks a free one):
+    const char* address;
+    int port;
+
+    // The iteration limit if a request has none:
+    int iterations;
+
+    // A tile store to keep the tiles in across restarts (NULL if none):
+    const char* tile_store_path;
+} tile_server_settings_t;
+
+// Serve until we get SIGINT or SIGTERM. The renderer settings provide the backend and the default coloring.
+// Returns 0 (after printing why) if we couldn't start:
+int run_tile_server(const tile_server_settings_t* server_settings, const renderer_settings_t* settings);
+
+#endif
@@ -0,0 +1,178 @@
+#include "zoom_video.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// A frame pixel covers 1 to 2 keyframe pixels per axis, so it overlaps at most 3 of them:
+#define MAX_RESAMPLING_TAPS 3
+
+// Macros:
+#define MIN(a, b) (((a) < (b)) ? (a) : (b))
+#define MAX(a, b) (((a) > (b)) ? (a) : (b))
+
+// Which keyframe pixels a frame pixel covers along an axis, and by how much:
+typedef struct _resampling_taps_t_
+{
+    int first;
+    float weights[MAX_RESAMPLING_TAPS];
+} resampling_taps_t;
+
+static double get_time(void)
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return time.tv_sec + (1e-9 * time.tv_nsec);
+}
+
+int get_zoom_video_frame_count(const zoom_video_t* video)
+{
+    double octaves = log2(video->end_scale / video->viewport.scale);
+
+    return (int)floor((octaves * video->frames_per_octave) + 0.5) + 1;
+}
+
+// The box filter footprints of the frame pixels along an axis. The keyframe has twice the frame size (both are centered),
+// and a frame pixel covers "factor" keyframe pixels (1 to 2). The size has to be at least 2:
+static void compute_resampling_taps(int size, double factor, resampling_taps_t* taps)
+{
+    for (int i = 0; i < size; i++)
+    {
+        double start = size + ((i - (0.5 * size)) * factor);
+        double end = start + factor;
+
+        // Guard against rounding at the keyframe edges:
+        start = MAX(start, 0.0);
+        end = MIN(end, 2.0 * size);
+
+        // Never read past the keyframe (the extra taps get a weight of 0):
+        taps[i].first = MIN((int)floor(start), (2 * size) - MAX_RESAMPLING_TAPS);
+
+        for (int tap = 0; tap < MAX_RESAMPLING_TAPS; tap++)
+        {
+            double pixel_start = taps[i].first + tap;
+            double overlap = MIN(end, pixel_start + 1.0) - MAX(start, pixel_start);
+
+            taps[i].weights[tap] = (overlap > 0) ? (float)(overlap / (end - start)) : 0.0f;
+        }
+    }
+}
+
+// Resample a frame (RGB8) from a keyframe (RGBA8):
+static void resample_frame(const uint8_t* keyframe, int width, int height, double factor, resampling_taps_t* column_taps, resampling_taps_t* row_taps, uint8_t* frame)
+{
+    compute_resampling_taps(width, factor, column_taps);
+    compute_resampling_taps(height, factor, row_taps);
+
+    size_t keyframe_stride = 4 * 2 * (size_t)width;
+
+    for (int y = 0; y < height; y++)
+    {
+        const resampling_taps_t* row = &row_taps[y];
+
+        for (int x = 0; x < width; x++)
+        {
+            const resampling_taps_t* column = &column_taps[x];
+            float color[3] = { 0, 0, 0 };
+
+            for (int row_tap = 0; row_tap < MAX_RESAMPLING_TAPS; row_tap++)
+            {
+                const uint8_t* source = keyframe + ((row->first + row_tap) * keyframe_stride) + (4 * (size_t)column->first);
+
+                for (int column_tap = 0; column_tap < MAX_RESAMPLING_TAPS; column_tap++)
+                {
+                    float weight = row->weights[row_tap] * column->weights[column_tap];
+
+                    for (int c = 0; c < 3; c++)
+                    {
+                        color[c] += weight * source[(4 * column_tap) + c];
+                    }
+                }
+            }
+
+            for (int c = 0; c < 3; c++)
+            {
+                frame[(3 * (((size_t)y * width) + x)) + c] = (uint8_t)MIN(255.0f, color[c] + 0.5f);
+            }
+        }
+    }
+}
+
+int write_zoom_video(const zoom_video_t* video, const renderer_settings_t* settings, FILE* file)
+{
+    int width = video->viewport.size[0];
+    int height = video->viewport.size[1];
+
+    int frame_count = get_zoom_video_frame_count(video);
+    int keyframe_count = MAX(1, (int)ceil((double)(frame_count - 1) / video->frames_per_octave));
+
+    renderer_t renderer;
+    init_renderer(&renderer, settings, 2 * width, 2 * height, INT32_MAX);
+
+    uint8_t* keyframe = malloc(4 * (size_t)(2 * width) * (2 * height));
+    uint8_t* frame = malloc(3 * (size_t)width * height);
+    resampling_taps_t* column_taps = malloc(width * sizeof(resampling_taps_t));
+    resampling_taps_t* row_taps = malloc(height * sizeof(resampling_taps_t));
+
+    if (!keyframe || !frame || !column_taps || !row_taps)
+    {
+        fprintf(stderr, "Failed to allocate memory for a %d x %d video\n", width, height);
+        exit(EXIT_FAILURE);
+    }
+
+    printf("Rendering %d frames of %d x %d pixels from %d keyframes, %d iterations (%s) ...\n", frame_count, width, height, keyframe_count, video->viewport.iterations, renderer.name);
+
+    double start_time = get_time();
+    int current_keyframe = -1;
+    int is_ok = 1;
+
+    for (int i = 0; is_ok && (i < frame_count); i++)
+    {
+        // The frames of an octave come from its keyframe (the last frame may end the last octave):
+        double octave = (double)i / video->frames_per_octave;
+        int keyframe_index = MIN((int)floor(octave), keyframe_count - 1);
+
+        double keyframe_scale = video->viewport.scale * exp2(keyframe_index + 1);
+
+        if (keyframe_index != current_keyframe)
+        {
+            viewport_t keyframe_viewport = video->viewport;
+
+            keyframe_viewport.scale = keyframe_scale;
+            keyframe_viewport.size[0] = 2 * width;
+            keyframe_viewport.size[1] = 2 * height;
+
+            printf("Keyframe %d of %d (scale %g, %.1f s)\n", keyframe_index + 1, keyframe_count, keyframe_scale, get_time() - start_time);
+
+            render_viewport(&renderer, &keyframe_viewport, keyframe);
+            current_keyframe = keyframe_index;
+        }
+
+        // The frame scale is viewport.scale * 2^octave, so a frame pixel covers 2^(keyframe_index + 1 - octave) keyframe pixels:
+        resample_frame(keyframe, width, height, exp2((keyframe_index + 1) - octave), column_taps, row_taps, frame);
+
+        is_ok = fwrite(frame, 3, (size_t)width * height, file) == ((size_t)width * height);
+    }
+
+    is_ok = !fflush(file) && is_ok;
+
+    if (is_ok)
+    {
+        printf("Rendered %d frames in %.3f s.\n", frame_count, get_time() - start_time);
+    }
+    else
+    {
+        fprintf(stderr, "Failed to write the video frames\n");
+    }
+
+    free(row_taps);
+    free(column_taps);
+    free(frame);
+    free(keyframe);
+    delete_renderer(&renderer);
+
+    return is_ok;
+}
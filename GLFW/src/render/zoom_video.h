@@ -0,0 +1,30 @@
+#ifndef ZOOM_VIDEO_H
+#define ZOOM_VIDEO_H
+
+#include <stdio.h>
+
+#include "renderer.h"
+#include "viewport.h"
+
+// A zoom into the center of a viewport, with the scale growing exponentially from frame to frame:
+typedef struct _zoom_video_t_
+{
+    // The first frame (its size is the frame size):
+    viewport_t viewport;
+
+    // The scale of the last frame:
+    double end_scale;
+
+    // The scale doubles every this many frames:
+    int frames_per_octave;
+} zoom_video_t;
+
+// The number of frames in the video:
+int get_zoom_video_frame_count(const zoom_video_t* video);
+
+// Render the video and write it as raw RGB8 frames (rows from top to bottom), e.g. for "ffmpeg -f rawvideo -pix_fmt rgb24".
+// Instead of rendering every frame, we render one keyframe per octave at twice the frame size (and the largest scale of the octave)
+// and resample all frames of the octave from it. Returns 0 (after printing why) on failure:
+int write_zoom_video(const zoom_video_t* video, const renderer_settings_t* settings, FILE* file);
+
+#endif
@@ -0,0 +1,279 @@
+#include "tile_cache.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cpu_renderer.h"
+#include "tile_store.h"
+
+// Grid pixel coordinates have to stay exact in a double (with room to spare for the centers):
+#define TILE_GRID_LIMIT 0x1p50
+
+// Macros:
+#define MIN(a, b) (((a) < (b)) ? (a) : (b))
+#define MAX(a, b) (((a) > (b)) ? (a) : (b))
+
+static double get_level_scale(int level)
+{
+    return exp2((double)level / TILE_LEVELS_PER_OCTAVE);
+}
+
+// Round towards negative infinity (tiles left of / above the origin have negative indices):
+static int64_t floor_div(int64_t value, int64_t divisor)
+{
+    int64_t quotient = value / divisor;
+
+    return ((value % divisor) < 0) ? (quotient - 1) : quotient;
+}
+
+static int get_bucket(const tile_cache_t* cache, const tile_key_t* key)
+{
+    return (int)(hash_tile_key(key) & (uint64_t)(cache->bucket_count - 1));
+}
+
+static void unlink_recent(tile_cache_t* cache, cached_tile_t* tile)
+{
+    if (tile->newer)
+    {
+        tile->newer->older = tile->older;
+    }
+    else
+    {
+        cache->newest = tile->older;
+    }
+
+    if (tile->older)
+    {
+        tile->older->newer = tile->newer;
+    }
+    else
+    {
+        cache->oldest = tile->newer;
+    }
+}
+
+static void link_newest(tile_cache_t* cache, cached_tile_t* tile)
+{
+    tile->newer = NULL;
+    tile->older = cache->newest;
+
+    if (cache->newest)
+    {
+        cache->newest->newer = tile;
+    }
+    else
+    {
+        cache->oldest = tile;
+    }
+
+    cache->newest = tile;
+}
+
+static void remove_from_bucket(tile_cache_t* cache, cached_tile_t* tile)
+{
+    cached_tile_t** link = &cache->buckets[get_bucket(cache, &tile->key)];
+
+    while (*link != tile)
+    {
+        link = &(*link)->next_in_bucket;
+    }
+
+    *link = tile->next_in_bucket;
+}
+
+void init_tile_cache(tile_cache_t* cache, size_t max_bytes)
+{
+    size_t tile_bytes = TILE_CACHE_TILE_SIZE * TILE_CACHE_TILE_SIZE * sizeof(uint32_t);
+
+    cache->capacity = (int)MAX(MIN(max_bytes / tile_bytes, 1 << 24), 1);
+    cache->count = 0;
+
+    // Keep the buckets at most half full:
+    cache->bucket_count = 1;
+
+    while (cache->bucket_count < 2 * cache->capacity)
+    {
+        cache->bucket_count *= 2;
+    }
+
+    cache->tiles = calloc(cache->capacity, sizeof(cached_tile_t));
+    cache->buckets = calloc(cache->bucket_count, sizeof(cached_tile_t*));
+
+    if (!cache->tiles || !cache->buckets)
+    {
+        fprintf(stderr, "Failed to allocate a tile cache of %d tiles\n", cache->capacity);
+        exit(EXIT_FAILURE);
+    }
+
+    cache->newest = NULL;
+    cache->oldest = NULL;
+
+    cache->store = NULL;
+}
+
+void delete_tile_cache(tile_cache_t* cache)
+{
+    for (int i = 0; i < cache->count; i++)
+    {
+        free(cache->tiles[i].iteration_state);
+    }
+
+    free(cache->tiles);
+    free(cache->buckets);
+}
+
+const uint32_t* find_cached_tile(tile_cache_t* cache, const tile_key_t* key)
+{
+    for (cached_tile_t* tile = cache->buckets[get_bucket(cache, key)]; tile; tile = tile->next_in_bucket)
+    {
+        if (is_same_tile_key(&tile->key, key))
+        {
+            unlink_recent(cache, tile);
+            link_newest(cache, tile);
+
+            return tile->iteration_state;
+        }
+    }
+
+    return NULL;
+}
+
+uint32_t* add_cached_tile(tile_cache_t* cache, const tile_key_t* key)
+{
+    cached_tile_t* tile;
+
+    if (cache->count < cache->capacity)
+    {
+        tile = &cache->tiles[cache->count];
+        tile->iteration_state = malloc(TILE_CACHE_TILE_SIZE * TILE_CACHE_TILE_SIZE * sizeof(uint32_t));
+
+        if (!tile->iteration_state)
+        {
+            fprintf(stderr, "Failed to allocate a cached tile\n");
+            exit(EXIT_FAILURE);
+        }
+
+        cache->count++;
+    }
+    else
+    {
+        // Reuse the least recently used tile:
+        tile = cache->oldest;
+
+        remove_from_bucket(cache, tile);
+        unlink_recent(cache, tile);
+    }
+
+    tile->key = *key;
+
+    int bucket = get_bucket(cache, key);
+
+    tile->next_in_bucket = cache->buckets[bucket];
+    cache->buckets[bucket] = tile;
+
+    link_newest(cache, tile);
+
+    return tile->iteration_state;
+}
+
+int snap_to_tile_grid(const viewport_t* viewport, tile_frame_t* frame)
+{
+    frame->level = (int)lround(log2(viewport->scale) * TILE_LEVELS_PER_OCTAVE);
+    frame->iterations = viewport->iterations;
+
+    double scale = get_level_scale(frame->level);
+
+    for (int axis = 0; axis < 2; axis++)
+    {
+        // The grid pixel in the corner (the imaginary axis points up, the rows go down):
+        double_double_t center = dd_mul_double(viewport->position[axis], (axis == 0) ? scale : -scale);
+        double corner = round(dd_to_double(dd_add_double(center, -0.5 * viewport->size[axis])));
+
+        if (!(fabs(corner) < TILE_GRID_LIMIT))
+        {
+            return 0;
+        }
+
+        frame->origin[axis] = (int64_t)corner;
+        frame->size[axis] = viewport->size[axis];
+    }
+
+    return 1;
+}
+
+viewport_t get_tile_frame_viewport(const tile_frame_t* frame)
+{
+    viewport_t viewport;
+    double scale = get_level_scale(frame->level);
+
+    // Pixel x of the grid is centered on (x + 0.5) / scale (the sums are exact below the grid limit):
+    viewport.position[0] = dd_div_double(dd_from_double((double)frame->origin[0] + (0.5 * frame->size[0])), scale);
+    viewport.position[1] = dd_neg(dd_div_double(dd_from_double((double)frame->origin[1] + (0.5 * frame->size[1])), scale));
+    viewport.scale = scale;
+    viewport.size[0] = frame->size[0];
+    viewport.size[1] = frame->size[1];
+    viewport.iterations = frame->iterations;
+
+    return viewport;
+}
+
+void render_escape_cached(tile_cache_t* cache, const tile_frame_t* frame, uint32_t* iteration_state, int thread_count)
+{
+    int64_t first_tile[2];
+    int64_t last_tile[2];
+
+    for (int axis = 0; axis < 2; axis++)
+    {
+        first_tile[axis] = floor_div(frame->origin[axis], TILE_CACHE_TILE_SIZE);
+        last_tile[axis] = floor_div(frame->origin[axis] + frame->size[axis] - 1, TILE_CACHE_TILE_SIZE);
+    }
+
+    for (int64_t tile_y = first_tile[1]; tile_y <= last_tile[1]; tile_y++)
+    {
+        for (int64_t tile_x = first_tile[0]; tile_x <= last_tile[0]; tile_x++)
+        {
+            tile_key_t key = { frame->level, frame->iterations, tile_x, tile_y };
+            const uint32_t* tile_state = find_cached_tile(cache, &key);
+
+            // Stored tiles are read straight from the mapping (no need to keep them in memory as well):
+            if (!tile_state && cache->store)
+            {
+                tile_state = find_stored_tile(cache->store, &key);
+            }
+
+            if (!tile_state)
+            {
+                tile_frame_t tile_frame = { frame->level, frame->iterations, { tile_x * TILE_CACHE_TILE_SIZE, tile_y * TILE_CACHE_TILE_SIZE }, { TILE_CACHE_TILE_SIZE, TILE_CACHE_TILE_SIZE } };
+                viewport_t tile_viewport = get_tile_frame_viewport(&tile_frame);
+                uint32_t* new_tile_state = add_cached_tile(cache, &key);
+
+                cpu_render_escape(&tile_viewport, new_tile_state, thread_count);
+
+                if (cache->store)
+                {
+                    store_tile(cache->store, &key, new_tile_state);
+                }
+
+                tile_state = new_tile_state;
+            }
+
+            // Copy the part of the tile inside the frame:
+            int64_t tile_origin_x = tile_x * TILE_CACHE_TILE_SIZE;
+            int64_t tile_origin_y = tile_y * TILE_CACHE_TILE_SIZE;
+
+            int x_start = (int)(MAX(tile_origin_x, frame->origin[0]) - frame->origin[0]);
+            int x_end = (int)(MIN(tile_origin_x + TILE_CACHE_TILE_SIZE, frame->origin[0] + frame->size[0]) - frame->origin[0]);
+            int y_start = (int)(MAX(tile_origin_y, frame->origin[1]) - frame->origin[1]);
+            int y_end = (int)(MIN(tile_origin_y + TILE_CACHE_TILE_SIZE, frame->origin[1] + frame->size[1]) - frame->origin[1]);
+
+            for (int y = y_start; y < y_end; y++)
+            {
+                const uint32_t* source = &tile_state[(frame->origin[1] + y - tile_origin_y) * TILE_CACHE_TILE_SIZE + (frame->origin[0] + x_start - tile_origin_x)];
+
+                memcpy(&iteration_state[(size_t)y * frame->size[0] + x_start], source, (x_end - x_start) * sizeof(uint32_t));
+            }
+        }
+    }
+}
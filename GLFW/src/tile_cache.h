@@ -0,0 +1,109 @@
+#ifndef TILE_CACHE_H
+#define TILE_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "viewport.h"
+
+// A memory bounded LRU cache of iteration state tiles, so views we have been to before (or that overlap them) cost nothing.
+// Tiles live on a fixed grid per zoom level: level L has a scale of 2^(L / TILE_LEVELS_PER_OCTAVE) pixels per unit and its
+// pixels are aligned to the origin, so a pixel of a level is the same pixel in every view (every TILE_LEVELS_PER_OCTAVE-th
+// level splits each tile into four, like a quadtree). Views are snapped onto the grid before they are rendered.
+
+// Tiles are this many pixels wide and high:
+#define TILE_CACHE_TILE_SIZE 256
+
+// Zoom levels per doubling of the scale (a mouse wheel step is 4 levels):
+#define TILE_LEVELS_PER_OCTAVE 16
+
+// Identifies a tile (x and y count tiles from the origin, y grows downwards):
+typedef struct _tile_key_t_
+{
+    int level;
+    int iterations;
+    int64_t x;
+    int64_t y;
+} tile_key_t;
+
+// Mix all fields of a key (neighbouring tiles should not collide):
+static inline uint64_t hash_tile_key(const tile_key_t* key)
+{
+    uint64_t hash = (uint64_t)key->x * 0x9E3779B97F4A7C15u;
+
+    hash ^= (uint64_t)key->y * 0xC2B2AE3D27D4EB4Fu;
+    hash ^= (uint64_t)(uint32_t)key->level * 0x165667B19E3779F9u;
+    hash ^= (uint64_t)(uint32_t)key->iterations * 0x27D4EB2F165667C5u;
+
+    return hash ^ (hash >> 29);
+}
+
+static inline int is_same_tile_key(const tile_key_t* a, const tile_key_t* b)
+{
+    return (a->level == b->level) && (a->iterations == b->iterations) && (a->x == b->x) && (a->y == b->y);
+}
+
+typedef struct _cached_tile_t_
+{
+    tile_key_t key;
+
+    // TILE_CACHE_TILE_SIZE^2 values (rows from top to bottom):
+    uint32_t* iteration_state;
+
+    // The next tile in the same hash bucket:
+    struct _cached_tile_t_* next_in_bucket;
+
+    // The recently used list:
+    struct _cached_tile_t_* newer;
+    struct _cached_tile_t_* older;
+} cached_tile_t;
+
+typedef struct _tile_cache_t_
+{
+    // All tiles (count of them are in use):
+    cached_tile_t* tiles;
+    int capacity;
+    int count;
+
+    // The hash table (bucket_count is a power of 2):
+    cached_tile_t** buckets;
+    int bucket_count;
+
+    // Both ends of the recently used list:
+    cached_tile_t* newest;
+    cached_tile_t* oldest;
+
+    // The tiles on disk behind the cache (NULL if there are none, see tile_store.h):
+    struct _tile_store_t_* store;
+} tile_cache_t;
+
+// A view snapped onto the tile grid: the level, the grid pixel in its top left corner and its size:
+typedef struct _tile_frame_t_
+{
+    int level;
+    int iterations;
+    int64_t origin[2];
+    int size[2];
+} tile_frame_t;
+
+// Create a cache holding as many tiles as fit into max_bytes (at least one, exits on failure):
+void init_tile_cache(tile_cache_t* cache, size_t max_bytes);
+void delete_tile_cache(tile_cache_t* cache);
+
+// Look up a tile and mark it as the most recently used one (NULL if it is not cached):
+const uint32_t* find_cached_tile(tile_cache_t* cache, const tile_key_t* key);
+
+// Make room for a tile (evicting the least recently used one if the cache is full) and return its iteration state to fill in:
+uint32_t* add_cached_tile(tile_cache_t* cache, const tile_key_t* key);
+
+// Snap a viewport onto the nearest level and grid pixel (moving it by less than half a pixel).
+// Returns 0 if the view is zoomed in too far for the grid:
+int snap_to_tile_grid(const viewport_t* viewport, tile_frame_t* frame);
+
+// The viewport of a frame on the grid:
+viewport_t get_tile_frame_viewport(const tile_frame_t* frame);
+
+// Assemble the iteration state of a frame from cached (or stored) tiles, rendering (and caching and storing) only the missing ones:
+void render_escape_cached(tile_cache_t* cache, const tile_frame_t* frame, uint32_t* iteration_state, int thread_count);
+
+#endif
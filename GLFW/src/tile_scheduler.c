@@ -0,0 +1,266 @@
+#include "tile_scheduler.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Every deque gets its own cache line (owners and thieves hammer on them):
+#define CACHE_LINE_SIZE 64
+
+// Macros:
+#define MIN(a, b) (((a) < (b)) ? (a) : (b))
+#define MAX(a, b) (((a) > (b)) ? (a) : (b))
+
+// The tiles of a thread. Thread t owns the tiles t, t + n, t + 2n, ... of the centre-first order (n threads).
+// Nothing is pushed once the threads run, so a deque is just the range [front, back) of those, packed into one atomic word:
+// the owner takes from the front (its most central tiles), thieves take from the back.
+typedef struct _tile_deque_t_
+{
+    _Alignas(CACHE_LINE_SIZE) _Atomic uint64_t range;
+} tile_deque_t;
+
+typedef struct _tile_scheduler_t_
+{
+    // All tiles, centre first:
+    tile_t* tiles;
+
+    tile_deque_t* deques;
+    int thread_count;
+
+    tile_function_t function;
+    void* context;
+} tile_scheduler_t;
+
+typedef struct _tile_worker_t_
+{
+    tile_scheduler_t* scheduler;
+    int index;
+
+    // Picks the victims to steal from:
+    uint32_t random;
+} tile_worker_t;
+
+// For sorting the tiles centre first:
+typedef struct _ordered_tile_t_
+{
+    // The squared distance from the image centre (in half pixels, so it stays integral):
+    int64_t distance;
+    tile_t tile;
+} ordered_tile_t;
+
+static int compare_ordered_tiles(const void* a, const void* b)
+{
+    const ordered_tile_t* tile_a = a;
+    const ordered_tile_t* tile_b = b;
+
+    if (tile_a->distance != tile_b->distance)
+    {
+        return (tile_a->distance < tile_b->distance) ? -1 : 1;
+    }
+
+    // Break ties by position (qsort isn't stable):
+    if (tile_a->tile.y != tile_b->tile.y)
+    {
+        return tile_a->tile.y - tile_b->tile.y;
+    }
+
+    return tile_a->tile.x - tile_b->tile.x;
+}
+
+static uint64_t pack_range(uint32_t front, uint32_t back)
+{
+    return ((uint64_t)front << 32) | back;
+}
+
+static int pop_front(tile_deque_t* deque, uint32_t* k)
+{
+    uint64_t range = atomic_load(&deque->range);
+
+    for (;;)
+    {
+        uint32_t front = (uint32_t)(range >> 32);
+        uint32_t back = (uint32_t)range;
+
+        if (front >= back)
+        {
+            return 0;
+        }
+
+        // On failure, range is reloaded and we try again:
+        if (atomic_compare_exchange_weak(&deque->range, &range, pack_range(front + 1, back)))
+        {
+            *k = front;
+            return 1;
+        }
+    }
+}
+
+static int pop_back(tile_deque_t* deque, uint32_t* k)
+{
+    uint64_t range = atomic_load(&deque->range);
+
+    for (;;)
+    {
+        uint32_t front = (uint32_t)(range >> 32);
+        uint32_t back = (uint32_t)range;
+
+        if (front >= back)
+        {
+            return 0;
+        }
+
+        if (atomic_compare_exchange_weak(&deque->range, &range, pack_range(front, back - 1)))
+        {
+            *k = back - 1;
+            return 1;
+        }
+    }
+}
+
+static uint32_t next_random(uint32_t* state)
+{
+    // Xorshift:
+    uint32_t x = *state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+
+    return *state = x;
+}
+
+static void run_tile(tile_scheduler_t* scheduler, int owner, uint32_t k)
+{
+    scheduler->function(&scheduler->tiles[owner + ((size_t)k * scheduler->thread_count)], scheduler->context);
+}
+
+static void* run_worker(void* arg)
+{
+    tile_worker_t* worker = arg;
+    tile_scheduler_t* scheduler = worker->scheduler;
+    uint32_t k;
+
+    // Our own tiles first:
+    while (pop_front(&scheduler->deques[worker->index], &k))
+    {
+        run_tile(scheduler, worker->index, k);
+    }
+
+    // Then steal from the others (starting at a random one, so thieves spread out) until everybody is out of tiles.
+    // No tiles are ever added, so once all deques were empty, we're done:
+    for (;;)
+    {
+        int is_stolen = 0;
+        int start = next_random(&worker->random) % scheduler->thread_count;
+
+        for (int v = 0; (v < scheduler->thread_count) && !is_stolen; v++)
+        {
+            int victim = (start + v) % scheduler->thread_count;
+
+            if ((victim != worker->index) && pop_back(&scheduler->deques[victim], &k))
+            {
+                run_tile(scheduler, victim, k);
+                is_stolen = 1;
+            }
+        }
+
+        if (!is_stolen)
+        {
+            return NULL;
+        }
+    }
+}
+
+void run_tiles(int width, int height, int thread_count, tile_function_t function, void* context)
+{
+    int columns = (width + TILE_SIZE - 1) / TILE_SIZE;
+    int rows = (height + TILE_SIZE - 1) / TILE_SIZE;
+    int tile_count = columns * rows;
+
+    if (tile_count <= 0)
+    {
+        return;
+    }
+
+    // Sort the tiles centre first (that's where the detail usually is, and partial results look sensible):
+    ordered_tile_t* ordered_tiles = malloc(tile_count * sizeof(ordered_tile_t));
+    tile_t* tiles = malloc(tile_count * sizeof(tile_t));
+
+    if (!ordered_tiles || !tiles)
+    {
+        fprintf(stderr, "Failed to allocate memory for %d tiles\n", tile_count);
+        exit(EXIT_FAILURE);
+    }
+
+    for (int row = 0; row < rows; row++)
+    {
+        for (int column = 0; column < columns; column++)
+        {
+            tile_t tile = { .x = column * TILE_SIZE, .y = row * TILE_SIZE };
+
+            tile.width = MIN(TILE_SIZE, width - tile.x);
+            tile.height = MIN(TILE_SIZE, height - tile.y);
+
+            int64_t dx = (2 * tile.x) + tile.width - width;
+            int64_t dy = (2 * tile.y) + tile.height - height;
+
+            ordered_tiles[(row * columns) + column] = (ordered_tile_t){ .distance = (dx * dx) + (dy * dy), .tile = tile };
+        }
+    }
+
+    qsort(ordered_tiles, tile_count, sizeof(ordered_tile_t), compare_ordered_tiles);
+
+    for (int i = 0; i < tile_count; i++)
+    {
+        tiles[i] = ordered_tiles[i].tile;
+    }
+
+    free(ordered_tiles);
+
+    // Deal the tiles round robin, so every thread starts near the centre:
+    thread_count = MAX(1, MIN(thread_count, tile_count));
+
+    tile_deque_t* deques = aligned_alloc(CACHE_LINE_SIZE, thread_count * sizeof(tile_deque_t));
+    tile_worker_t* workers = malloc(thread_count * sizeof(tile_worker_t));
+    pthread_t* threads = malloc(thread_count * sizeof(pthread_t));
+    int* is_started = calloc(thread_count, sizeof(int));
+
+    if (!deques || !workers || !threads || !is_started)
+    {
+        fprintf(stderr, "Failed to allocate memory for %d render threads\n", thread_count);
+        exit(EXIT_FAILURE);
+    }
+
+    tile_scheduler_t scheduler = { .tiles = tiles, .deques = deques, .thread_count = thread_count, .function = function, .context = context };
+
+    for (int t = 0; t < thread_count; t++)
+    {
+        atomic_init(&deques[t].range, pack_range(0, (uint32_t)((tile_count - t + thread_count - 1) / thread_count)));
+        workers[t] = (tile_worker_t){ .scheduler = &scheduler, .index = t, .random = (2654435761u * (uint32_t)t) | 1u };
+    }
+
+    // The calling thread works as well.
+    // If we can't get more threads (e.g. on the web), the others' tiles just get stolen:
+    for (int t = 1; t < thread_count; t++)
+    {
+        is_started[t] = !pthread_create(&threads[t], NULL, run_worker, &workers[t]);
+    }
+
+    run_worker(&workers[0]);
+
+    for (int t = 1; t < thread_count; t++)
+    {
+        if (is_started[t])
+        {
+            pthread_join(threads[t], NULL);
+        }
+    }
+
+    free(is_started);
+    free(threads);
+    free(workers);
+    free(deques);
+    free(tiles);
+}
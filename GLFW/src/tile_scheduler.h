@@ -0,0 +1,26 @@
+#ifndef TILE_SCHEDULER_H
+#define TILE_SCHEDULER_H
+
+// Escape-time cost varies wildly over an image (interior vs. exterior), so splitting it statically leaves most threads waiting
+// for the slowest one. The scheduler cuts the image into small tiles, deals them (centre first) to a deque per thread and lets
+// threads that run dry steal from the others.
+
+// Tiles are (at most) this many pixels wide and high:
+#define TILE_SIZE 32
+
+// A rectangle of the image (rows from top to bottom):
+typedef struct _tile_t_
+{
+    int x;
+    int y;
+    int width;
+    int height;
+} tile_t;
+
+// Renders one tile. It is called from several threads at once (never twice for the same tile):
+typedef void (*tile_function_t)(const tile_t* tile, void* context);
+
+// Run the function for all tiles of a width x height image on thread_count threads (including the calling one) and wait for them:
+void run_tiles(int width, int height, int thread_count, tile_function_t function, void* context);
+
+#endif
@@ -0,0 +1,262 @@
+#include "tile_store.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// The tiles start on a page boundary:
+#define TILE_STORE_ALIGNMENT 4096
+
+#define TILE_BYTES (TILE_CACHE_TILE_SIZE * TILE_CACHE_TILE_SIZE * sizeof(uint32_t))
+
+// Macros:
+#define MIN(a, b) (((a) < (b)) ? (a) : (b))
+#define MAX(a, b) (((a) > (b)) ? (a) : (b))
+
+static size_t get_tiles_offset(uint32_t slot_count)
+{
+    size_t keys_end = sizeof(tile_store_header_t) + (slot_count * sizeof(stored_tile_key_t));
+
+    return (keys_end + TILE_STORE_ALIGNMENT - 1) / TILE_STORE_ALIGNMENT * TILE_STORE_ALIGNMENT;
+}
+
+static size_t get_store_size(uint32_t slot_count)
+{
+    return get_tiles_offset(slot_count) + (slot_count * TILE_BYTES);
+}
+
+static int get_bucket(const tile_store_t* store, const tile_key_t* key)
+{
+    return (int)(hash_tile_key(key) & (uint64_t)(store->bucket_count - 1));
+}
+
+static void add_to_index(tile_store_t* store, int slot)
+{
+    int bucket = get_bucket(store, &store->keys[slot].key);
+
+    store->next_in_bucket[slot] = store->buckets[bucket];
+    store->buckets[bucket] = slot;
+}
+
+static void remove_from_index(tile_store_t* store, int slot)
+{
+    int* link = &store->buckets[get_bucket(store, &store->keys[slot].key)];
+
+    while (*link != slot)
+    {
+        link = &store->next_in_bucket[*link];
+    }
+
+    *link = store->next_in_bucket[slot];
+}
+
+// Check the header of an existing store (returns the slot count, 0 if the file is no store of ours):
+static uint32_t read_header(int file, const char* path, off_t file_size)
+{
+    tile_store_header_t header;
+
+    if ((file_size < (off_t)sizeof(header)) || (pread(file, &header, sizeof(header), 0) != sizeof(header)) ||
+        memcmp(header.magic, TILE_STORE_MAGIC, sizeof(header.magic)))
+    {
+        fprintf(stderr, "%s is not a tile store.\n", path);
+        return 0;
+    }
+
+    if ((header.version != TILE_STORE_VERSION) || (header.tile_size != TILE_CACHE_TILE_SIZE) || (header.levels_per_octave != TILE_LEVELS_PER_OCTAVE))
+    {
+        fprintf(stderr, "The tile store %s has a different format, remove it to start over.\n", path);
+        return 0;
+    }
+
+    if ((header.slot_count == 0) || (header.next_slot >= header.slot_count) || (file_size != (off_t)get_store_size(header.slot_count)))
+    {
+        fprintf(stderr, "The tile store %s is broken, remove it to start over.\n", path);
+        return 0;
+    }
+
+    return header.slot_count;
+}
+
+int open_tile_store(tile_store_t* store, const char* path, size_t max_bytes)
+{
+    store->file = open(path, O_RDWR | O_CREAT, 0644);
+
+    if (store->file < 0)
+    {
+        fprintf(stderr, "Failed to open the tile store %s\n", path);
+        return 0;
+    }
+
+    if (flock(store->file, LOCK_EX | LOCK_NB))
+    {
+        fprintf(stderr, "The tile store %s is in use by another process.\n", path);
+        close(store->file);
+        return 0;
+    }
+
+    struct stat status;
+
+    if (fstat(store->file, &status))
+    {
+        fprintf(stderr, "Failed to query the tile store %s\n", path);
+        close(store->file);
+        return 0;
+    }
+
+    int is_new = (status.st_size == 0);
+    uint32_t slot_count;
+
+    if (is_new)
+    {
+        // A new file is sparse, so unused slots cost nothing:
+        slot_count = (uint32_t)MAX(MIN(max_bytes / TILE_BYTES, 1 << 24), 1);
+
+        if (ftruncate(store->file, (off_t)get_store_size(slot_count)))
+        {
+            fprintf(stderr, "Failed to size the tile store %s\n", path);
+            close(store->file);
+            return 0;
+        }
+    }
+    else
+    {
+        slot_count = read_header(store->file, path, status.st_size);
+
+        if (!slot_count)
+        {
+            close(store->file);
+            return 0;
+        }
+    }
+
+    store->mapping_size = get_store_size(slot_count);
+    store->mapping = mmap(NULL, store->mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, store->file, 0);
+
+    if (store->mapping == MAP_FAILED)
+    {
+        fprintf(stderr, "Failed to map the tile store %s\n", path);
+        close(store->file);
+        return 0;
+    }
+
+    store->header = (tile_store_header_t*)store->mapping;
+    store->keys = (stored_tile_key_t*)(store->mapping + sizeof(tile_store_header_t));
+    store->tiles = (uint32_t*)(store->mapping + get_tiles_offset(slot_count));
+
+    if (is_new)
+    {
+        memcpy(store->header->magic, TILE_STORE_MAGIC, sizeof(store->header->magic));
+        store->header->version = TILE_STORE_VERSION;
+        store->header->tile_size = TILE_CACHE_TILE_SIZE;
+        store->header->levels_per_octave = TILE_LEVELS_PER_OCTAVE;
+        store->header->slot_count = slot_count;
+        store->header->next_slot = 0;
+        store->header->reserved = 0;
+    }
+
+    // Index the tiles we have (keeping the buckets at most half full):
+    store->bucket_count = 1;
+
+    while (store->bucket_count < 2 * (int)slot_count)
+    {
+        store->bucket_count *= 2;
+    }
+
+    store->buckets = malloc(store->bucket_count * sizeof(int));
+    store->next_in_bucket = malloc(slot_count * sizeof(int));
+
+    if (!store->buckets || !store->next_in_bucket)
+    {
+        fprintf(stderr, "Failed to allocate the index of the tile store %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+
+    for (int i = 0; i < store->bucket_count; i++)
+    {
+        store->buckets[i] = -1;
+    }
+
+    int tile_count = 0;
+
+    for (uint32_t slot = 0; slot < slot_count; slot++)
+    {
+        if (store->keys[slot].flags & STORED_TILE_USED)
+        {
+            add_to_index(store, (int)slot);
+            tile_count++;
+        }
+    }
+
+    printf("Opened the tile store %s (%d of %u tiles used)\n", path, tile_count, slot_count);
+
+    return 1;
+}
+
+void close_tile_store(tile_store_t* store)
+{
+    msync(store->mapping, store->mapping_size, MS_SYNC);
+    munmap(store->mapping, store->mapping_size);
+
+    // Closing the file releases the lock:
+    close(store->file);
+
+    free(store->buckets);
+    free(store->next_in_bucket);
+}
+
+const uint32_t* find_stored_tile(tile_store_t* store, const tile_key_t* key)
+{
+    for (int slot = store->buckets[get_bucket(store, key)]; slot >= 0; slot = store->next_in_bucket[slot])
+    {
+        if (is_same_tile_key(&store->keys[slot].key, key))
+        {
+            store->keys[slot].flags |= STORED_TILE_REFERENCED;
+
+            return &store->tiles[(size_t)slot * TILE_CACHE_TILE_SIZE * TILE_CACHE_TILE_SIZE];
+        }
+    }
+
+    return NULL;
+}
+
+void store_tile(tile_store_t* store, const tile_key_t* key, const uint32_t* iteration_state)
+{
+    tile_store_header_t* header = store->header;
+    int slot;
+
+    // Advance the clock hand to a slot that hasn't been read since we last came by (this ends within two rounds):
+    while (1)
+    {
+        slot = (int)header->next_slot;
+        header->next_slot = (header->next_slot + 1) % header->slot_count;
+
+        if (!(store->keys[slot].flags & STORED_TILE_REFERENCED))
+        {
+            break;
+        }
+
+        store->keys[slot].flags &= ~STORED_TILE_REFERENCED;
+    }
+
+    stored_tile_key_t* stored_key = &store->keys[slot];
+
+    // Drop the old tile before we overwrite it, so an interrupted write never leaves a wrong tile behind:
+    if (stored_key->flags & STORED_TILE_USED)
+    {
+        remove_from_index(store, slot);
+        stored_key->flags = 0;
+    }
+
+    memcpy(&store->tiles[(size_t)slot * TILE_CACHE_TILE_SIZE * TILE_CACHE_TILE_SIZE], iteration_state, TILE_BYTES);
+
+    stored_key->key = *key;
+    stored_key->reserved = 0;
+    stored_key->flags = STORED_TILE_USED;
+
+    add_to_index(store, slot);
+}
@@ -0,0 +1,78 @@
+#ifndef TILE_STORE_H
+#define TILE_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "tile_cache.h"
+
+// A tile cache on disk, so tiles survive restarts. The file is a fixed number of tile slots and is mapped into memory,
+// so stored tiles are read straight from the page cache. When it is full, new tiles replace old ones in clock order:
+// a tile that has been read since the clock hand last passed it gets a second chance.
+// The file is in native byte order and only one process can use it at a time.
+
+#define TILE_STORE_MAGIC "MANDTILE"
+#define TILE_STORE_VERSION 1
+
+// The file starts with this (the keys follow, then the tiles on the next page):
+typedef struct _tile_store_header_t_
+{
+    char magic[8];
+    uint32_t version;
+
+    // The grid the tiles are on:
+    uint32_t tile_size;
+    uint32_t levels_per_octave;
+
+    uint32_t slot_count;
+
+    // The clock hand (the next slot we consider replacing):
+    uint32_t next_slot;
+
+    uint32_t reserved;
+} tile_store_header_t;
+
+// The flags of a slot:
+#define STORED_TILE_USED 0x1u
+#define STORED_TILE_REFERENCED 0x2u
+
+typedef struct _stored_tile_key_t_
+{
+    tile_key_t key;
+    uint32_t flags;
+    uint32_t reserved;
+} stored_tile_key_t;
+
+typedef struct _tile_store_t_
+{
+    int file;
+
+    // The whole file:
+    uint8_t* mapping;
+    size_t mapping_size;
+
+    // Its parts:
+    tile_store_header_t* header;
+    stored_tile_key_t* keys;
+    uint32_t* tiles;
+
+    // The index of the used slots (built when we open the store, -1 ends a chain):
+    int* buckets;
+    int bucket_count;
+    int* next_in_bucket;
+} tile_store_t;
+
+// Open a store or create one of about max_bytes (an existing store keeps its size).
+// Returns 0 (after printing why) if we can't use the file:
+int open_tile_store(tile_store_t* store, const char* path, size_t max_bytes);
+
+// Write everything back and close the file:
+void close_tile_store(tile_store_t* store);
+
+// Look up a tile (NULL if it is not stored). The pointer goes straight into the mapping and stays valid until the next store_tile():
+const uint32_t* find_stored_tile(tile_store_t* store, const tile_key_t* key);
+
+// Store a tile (TILE_CACHE_TILE_SIZE^2 values), replacing an old one if the store is full:
+void store_tile(tile_store_t* store, const tile_key_t* key, const uint32_t* iteration_state);
+
+#endif
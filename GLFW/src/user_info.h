@@ -0,0 +1,257 @@
+#ifndef USER_INFO_H
+#define USER_INFO_H
+
+#include <stdint.h>
+
+#include <glad/glad.h>
+
+#include "double_double.h"
+#include "hue_table.h"
+#include "hybrid_renderer.h"
+#include "reference_orbit.h"
+#include "tile_cache.h"
+#include "tile_store.h"
+#include "viewport.h"
+
+// The iteration count shares its 32 bits with some flags in the escape state:
+#define MIN_ITERATIONS 2
+#define MAX_ITERATIONS 0x3FFFFFFF
+
+// The range of the hue density:
+#define MIN_HUE_DENSITY 1.0
+#define MAX_HUE_DENSITY 256.0
+
+// The precision tiers (each one has its own shader program):
+typedef enum _precision_tier_t_
+{
+    // Plain float:
+    PRECISION_TIER_FLOAT,
+
+    // Native double (desktop GL 4 contexts only):
+    PRECISION_TIER_FP64,
+
+    // Emulated double (double-float):
+    PRECISION_TIER_DF64,
+
+    // Float deltas to a double-double reference orbit:
+    PRECISION_TIER_PERTURBATION,
+
+    PRECISION_TIER_COUNT
+} precision_tier_t;
+
+extern const char* precision_tier_names[PRECISION_TIER_COUNT];
+
+// The relative precision of each tier (perturbation only iterates relative deltas, so it is never limited here):
+extern const double precision_tier_epsilons[PRECISION_TIER_COUNT];
+
+// Legacy GL entry points we need to present CPU images (glad only loads the ES API):
+typedef void (*legacy_draw_pixels_proc_t)(GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels);
+typedef void (*legacy_raster_pos_proc_t)(GLfloat x, GLfloat y);
+typedef void (*legacy_pixel_zoom_proc_t)(GLfloat x_factor, GLfloat y_factor);
+
+// Desktop GL 4 entry point for the double uniforms of the fp64 tier (not in the ES API either):
+typedef void (*uniform_2d_proc_t)(GLint location, GLdouble x, GLdouble y);
+
+// The shader program (escape pass of a precision tier):
+typedef struct _shader_program_t_
+{
+    GLuint handle;
+    GLint gaussian_position_uniform;
+    GLint gaussian_half_frame_uniform;
+    GLint iterations_uniform;
+    GLint iteration_slice_uniform;
+    GLint reset_uniform;
+    GLint pixel_shift_uniform;
+    GLint periodicity_epsilon_uniform;
+
+    // Only available in double-float programs (-1 otherwise):
+    GLint gaussian_position_lo_uniform;
+
+    // Only available in perturbation programs (-1 otherwise):
+    GLint reference_orbit_length_uniform;
+} shader_program_t;
+
+// The compute path (ES 3.1): a kernel per tier that only runs the active pixels, plus the passes that maintain their list:
+typedef struct _compute_programs_t_
+{
+    // The escape kernels (no reset or pixel shift, those stay with the fragment kernels, 0 if a tier has none):
+    shader_program_t escape_programs[PRECISION_TIER_COUNT];
+
+    // Lists the active pixels of the whole escape state:
+    GLuint gather_program;
+    GLint gather_iterations_uniform;
+
+    // Turns the length of a new list into the size of the next dispatch:
+    GLuint dispatch_program;
+} compute_programs_t;
+
+// A program that only reads the escape state (colorize and probe passes):
+typedef struct _state_program_t_
+{
+    GLuint handle;
+    GLint iterations_uniform;
+
+    // Only available in the colorize program (-1 otherwise):
+    GLint hue_density_uniform;
+    GLint hue_offset_uniform;
+} state_program_t;
+
+// The per-pixel escape state, persistent across frames.
+// We ping-pong between two framebuffers, each with an iteration state (R32UI: count and flags), an orbit state (RGBA32UI: z as float or double bits)
+// and a checkpoint state (RGBA32UI: an earlier z for the periodicity check).
+// Integer targets are color-renderable in plain ES 3.0 / WebGL 2 and keep the bits exact.
+typedef struct _escape_state_t_
+{
+    GLuint framebuffers[2];
+    GLuint iteration_state_textures[2];
+    GLuint orbit_state_textures[2];
+    GLuint checkpoint_state_textures[2];
+
+    // The side holding the latest state:
+    int current;
+
+    // The size of the state textures:
+    int size[2];
+
+    // The view the state belongs to (if it changes, we have to start over):
+    int is_valid;
+    double_double_t position[2];
+    double scale;
+    int iterations;
+    precision_tier_t precision_tier;
+
+    // Is every pixel done (escaped or at the iteration limit)? In hybrid mode, this is only about the GPU's pixels:
+    int is_converged;
+
+    // Did the CPU take some tiles of the view (marked as pending until they come in)?
+    int is_hybrid;
+
+    // Counts the resets (and raised iteration limits), so we can ignore stale query results:
+    unsigned int generation;
+
+    // The compute path keeps the active pixels (x | (y << 16)) in a list and only iterates those, updating the state in place.
+    // Every pass reads one list and appends the pixels that are still active to the other one (counted by an atomic counter).
+    // The dispatch buffer holds the size of the next dispatch and the length of the list it reads (0 without compute shaders):
+    GLuint active_pixel_buffers[2];
+    GLuint active_pixel_counter;
+    GLuint dispatch_buffer;
+
+    // The list the next pass reads, and does it still hold every active pixel (the fragment kernels don't maintain it)?
+    int active_pixel_list;
+    int is_active_pixel_list_valid;
+
+    // Asks the GPU whether any pixels are still active (read back a frame later, so we never stall):
+    GLuint convergence_query;
+    int is_convergence_query_pending;
+    unsigned int convergence_query_generation;
+} escape_state_t;
+
+// The user info:
+typedef struct _user_info_t
+{
+    // The shader programs (one per precision tier) and their uniforms:
+    shader_program_t shader_programs[PRECISION_TIER_COUNT];
+
+    // The current precision tier:
+    precision_tier_t precision_tier;
+
+    // Has the user forced the tier (instead of letting us pick the cheapest accurate one)?
+    int is_precision_tier_forced;
+
+    // The compute path, do we have it (ES 3.1) and do we use it?
+    compute_programs_t compute_programs;
+    int is_compute_supported;
+    int is_compute_enabled;
+
+    // Sets the double uniforms of the fp64 tier (NULL unless we have a desktop GL context, set before init_gl_renderer):
+    uniform_2d_proc_t uniform_2d;
+
+    // Do we have native double shaders (desktop GL 4)? Otherwise the fp64 tier has no program and is skipped:
+    int is_fp64_supported;
+
+    // The passes that map the escape state to colors and check for convergence:
+    state_program_t colorize_program;
+    state_program_t probe_program;
+
+    // The escape state:
+    escape_state_t escape_state;
+
+    // The full-screen quad every pass draws:
+    GLuint vertex_buffer_object;
+    GLuint vertex_array_object;
+
+    // Where the colorize pass draws (0 for the window, an FBO when rendering offscreen):
+    GLuint target_framebuffer;
+
+    // Do we only iterate a slice per frame (instead of everything at once)?
+    int is_progressive;
+
+    // Has anything changed since the last frame (the callbacks set this)?
+    int is_dirty;
+
+    // Coloring (only the colorize pass depends on this, so changing it never iterates):
+    double hue_density;
+    double hue_offset;
+
+    // Are we cycling through the palette (and since when was the offset advanced)?
+    int is_palette_cycling;
+    double palette_cycle_time;
+
+    // The reference orbit (CPU and GPU side):
+    reference_orbit_t reference_orbit;
+    GLuint reference_orbit_texture_handle;
+    int max_reference_orbit_length;
+
+    // The palettes (as hue textures for the GPU and hue tables for the CPU) and the selected one:
+    GLuint hue_texture_handles[PALETTE_COUNT];
+    hue_table_t hue_tables[PALETTE_COUNT];
+    int palette;
+
+    // Does the CPU take a share of the tiles off the GPU (and who does what)?
+    int is_hybrid_rendering;
+    hybrid_renderer_t hybrid_renderer;
+
+    // Do we render on the CPU (because we didn't get an OpenGL ES 3 context)?
+    int is_cpu_rendering;
+
+    // The CPU image, the iteration state behind it and the viewport it shows:
+    uint32_t* cpu_iteration_state;
+    uint8_t* cpu_pixels;
+    viewport_t cpu_viewport;
+    int is_cpu_viewport_valid;
+
+    // The tiles we have rendered on the CPU so far (frames are assembled from them):
+    tile_cache_t tile_cache;
+    tile_store_t tile_store;
+
+    // Presents the CPU image:
+    legacy_draw_pixels_proc_t draw_pixels;
+    legacy_raster_pos_proc_t raster_pos;
+    legacy_pixel_zoom_proc_t pixel_zoom;
+
+    // Has the user asked us to compare the next frame with the CPU renderer?
+    int is_validation_requested;
+
+    // The current window size:
+    int window_size[2];
+
+    // The current framebuffer size (differs from the window size on HiDPI screens):
+    int framebuffer_size[2];
+
+    // The current cursor position:
+    double cursor_position[2];
+
+    // Are we panning?
+    int is_panning;
+
+    // The current position in the Gaussian plane (double-double, so we can zoom past double precision):
+    double_double_t position[2];
+
+    // The current scale:
+    double scale;
+
+    // The current interations:
+    int iterations;
+} user_info_t;
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef VIEWPORT_H
+#define VIEWPORT_H
+
+#include "double_double.h"
+
+// Layout of the per-pixel iteration state (shared by the shaders and the CPU renderer).
+// The count lives in the low bits, the flags tell us why a pixel has stopped:
+#define ESCAPED_FLAG 0x80000000u
+#define INTERIOR_FLAG 0x40000000u
+#define ITERATION_MASK 0x3FFFFFFFu
+
+// Both flags (never set by iterating) mark pixels that somebody else (the CPU in hybrid mode) iterates, the GPU leaves them alone:
+#define PENDING_STATE 0xFFFFFFFFu
+
+// Orbits that come back within this fraction of a pixel are considered periodic (i.e. inside):
+#define PERIODICITY_EPSILON_FACTOR (1.0 / 1024.0)
+
+// A view onto the Gaussian plane, sampled at the centers of size[0] x size[1] pixels:
+typedef struct _viewport_t_
+{
+    // The center (double-double, like the interactive position):
+    double_double_t position[2];
+
+    // Pixels per unit:
+    double scale;
+
+    // The size in pixels:
+    int size[2];
+
+    // The iteration limit:
+    int iterations;
+} viewport_t;
+
+static inline int is_same_viewport(const viewport_t* a, const viewport_t* b)
+{
+    return (a->position[0].hi == b->position[0].hi) && (a->position[0].lo == b->position[0].lo) &&
+        (a->position[1].hi == b->position[1].hi) && (a->position[1].lo == b->position[1].lo) &&
+        (a->scale == b->scale) &&
+        (a->size[0] == b->size[0]) && (a->size[1] == b->size[1]) &&
+        (a->iterations == b->iterations);
+}
+
+// The part of a viewport covering the pixels [x, x + width) x [y, y + height), sampled at the same points (up to rounding):
+static inline viewport_t get_sub_viewport(const viewport_t* viewport, int x, int y, int width, int height)
+{
+    // How far the centers are apart in pixels (exact, these are multiples of 1/2):
+    double offset_x = (x + (0.5 * width)) - (0.5 * viewport->size[0]);
+    double offset_y = (y + (0.5 * height)) - (0.5 * viewport->size[1]);
+
+    viewport_t sub_viewport = *viewport;
+
+    // Rows go from top to bottom, the imaginary axis from bottom to top:
+    sub_viewport.position[0] = dd_add(viewport->position[0], dd_div_double(dd_from_double(offset_x), viewport->scale));
+    sub_viewport.position[1] = dd_sub(viewport->position[1], dd_div_double(dd_from_double(offset_y), viewport->scale));
+    sub_viewport.size[0] = width;
+    sub_viewport.size[1] = height;
+
+    return sub_viewport;
+}
+
+#endif
@@ -13,13 +13,32 @@ uniform mediump uint iterations;
 //Hue texture:
 uniform mediump sampler2D hueTexture;
 
+//Is c inside the main cardioid or the period-2 bulb (then it never escapes)?
+//The margin keeps the test conservative despite rounding:
+const highp float interiorMargin = 1e-5;
+
+bool isInMainBulbs(highp vec2 c)
+{
+    //Main cardioid:
+    highp float x = c.x - 0.25;
+    highp float q = (x * x) + (c.y * c.y);
+    
+    if ((q * (q + x)) < ((0.25 * c.y * c.y) - interiorMargin))
+        return true;
+    
+    //Period-2 bulb (the disk of radius 1/4 around -1):
+    x = c.x + 1.0;
+    
+    return ((x * x) + (c.y * c.y)) < (0.0625 - interiorMargin);
+}
+
 void main()
 {
-    //Iterate:
+    //Iterate (skip the loop for points we already know to be inside):
     highp vec2 z = c;
-    mediump uint i;
+    mediump uint i = isInMainBulbs(c) ? iterations : 0u;
     
-    for (i = 0u; i < iterations; i++)
+    for (; i < iterations; i++)
     {
         //Condition:
         if (dot(z, z) > 4.0)